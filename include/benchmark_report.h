@@ -0,0 +1,47 @@
+#ifndef BENCHMARK_REPORT_H
+#define BENCHMARK_REPORT_H
+
+#include <chrono>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "render_stats.h"
+
+// What a headless run measured: startup split into phases, every counted
+// frame's time and render work, written out as one JSON object for
+// scripts to compare between builds.
+class BenchmarkReport {
+public:
+    BenchmarkReport();
+
+    // Charges the time since the previous mark (or construction) to name
+    void markPhase(const char* name);
+    void setTarget(const char* renderer, int width, int height);
+    void addFrame(float frameMs, const FrameWork& work);
+    // Bytes handed to the GL while loading, roughly what stays resident on the GPU
+    void setStartupUploads(unsigned long long bufferBytes, unsigned long long textureBytes);
+
+    size_t frameCount() const { return frameTimes.size(); }
+    // p in [0, 100], nearest rank over the counted frames
+    float framePercentile(float p) const;
+
+    void writeJson(std::ostream& out) const;
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    struct Phase {
+        const char* name;
+        float ms;
+    };
+
+    Clock::time_point lastMark;
+    std::vector<Phase> phases;
+    std::string rendererName;
+    int width, height;
+    std::vector<float> frameTimes;
+    std::vector<FrameWork> frames;
+    unsigned long long startupBufferBytes, startupTextureBytes;
+};
+
+#endif
@@ -0,0 +1,71 @@
+#ifndef BVH_H
+#define BVH_H
+
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <vector>
+
+// Four rays traced together, stored by component so each SIMD register
+// holds one value for all four. Box tests are shared by the packet, so
+// rays with nearby origins and similar directions trace fastest.
+struct alignas(16) RayPacket {
+    float originX[4], originY[4], originZ[4];
+    float directionX[4], directionY[4], directionZ[4];
+    float tMax[4];       // in: ray length; out: distance to the closest hit
+    int triangle[4];     // out: index of the hit triangle, -1 for a miss
+    unsigned int mask;   // only triangles sharing a bit with this are hit
+    int active;          // bit i set if ray i is traced
+
+    RayPacket() : mask(~0u), active(0) {}
+    void setRay(int lane, const glm::vec3& origin, const glm::vec3& direction, float length);
+};
+
+struct BVHTriangle {
+    glm::vec3 v0, v1, v2;
+    unsigned int mask; // see RayPacket::mask
+};
+
+// Bounding volume hierarchy over a fixed set of triangles, built with a
+// binned surface area heuristic. Triangles are double sided.
+class TriangleBVH {
+public:
+    TriangleBVH() {}
+
+    void build(const std::vector<BVHTriangle>& triangles);
+
+    // Closest hit for each active ray; triangle indices are those given to build()
+    void intersect(RayPacket& packet) const;
+    // Bits of the active rays that hit anything closer than their tMax
+    int occluded(const RayPacket& packet) const;
+
+    size_t nodeCount() const { return nodes.size(); }
+
+private:
+    struct Node {
+        glm::vec3 boundsMin;
+        uint32_t offset;     // interior: right child (left is the next node); leaf: first triangle
+        glm::vec3 boundsMax;
+        uint16_t count;      // triangles in a leaf, 0 for an interior node
+        uint16_t axis;       // split axis, for near-first traversal
+    };
+
+    // Vertex and edges ready for Moller-Trumbore
+    struct PackedTriangle {
+        glm::vec3 v0, edge1, edge2;
+        unsigned int mask;
+    };
+
+    struct BuildItem {
+        glm::vec3 boundsMin, boundsMax, centroid;
+        uint32_t index;
+    };
+
+    std::vector<Node> nodes;
+    std::vector<PackedTriangle> packed; // in leaf order
+    std::vector<uint32_t> order;        // build() index of each packed triangle
+
+    uint32_t buildNode(std::vector<BuildItem>& items, size_t begin, size_t end);
+    template <bool ANY_HIT> int trace(RayPacket& packet) const;
+};
+
+#endif
@@ -3,7 +3,8 @@
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
-#include <GLFW/glfw3.h>
+#include <functional>
+#include "input.h"
 
 class Camera {
 public:
@@ -21,10 +22,15 @@ public:
     float lastX, lastY;  // Last mouse position
     bool firstMouse;      // Flag to detect first mouse movement
 
+    // Movement limits: a box, optionally refined by a constraint such as room walls
+    glm::vec3 boundsMin, boundsMax;
+    std::function<glm::vec3(const glm::vec3& from, const glm::vec3& to)> constrain;
+
     Camera(glm::vec3 startPos, glm::vec3 startUp, float startYaw, float startPitch);
     glm::mat4 getViewMatrix();
-    void processKeyboardInput(GLFWwindow* window, float deltaTime);
+    void processKeyboardInput(const Input& input, float deltaTime);
     void processMouseMovement(float xpos, float ypos);
+    void setBounds(const glm::vec3& minCorner, const glm::vec3& maxCorner);
 };
 
 #endif
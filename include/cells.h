@@ -0,0 +1,82 @@
+#ifndef CELLS_H
+#define CELLS_H
+
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <vector>
+#include "culling.h"
+#include "painting.h"
+#include "static_mesh.h"
+
+// A doorway seen from one side
+struct Portal {
+    int target;                   // cell on the other side
+    glm::vec3 corners[4];         // opening polygon, in the middle of the wall
+    glm::vec3 passMin, passMax;   // walkable box through the wall opening
+};
+
+// A room: its box, its doorways and what is drawn inside it
+struct Cell {
+    glm::vec3 boundsMin, boundsMax;
+    std::vector<Portal> portals;
+    std::vector<uint32_t> surfaces;  // StaticMesh submesh indices
+    std::vector<uint32_t> paintings; // PaintingRenderer indices
+    BoundingBoxes surfaceBounds;
+    BoundingSpheres paintingBounds;
+};
+
+// Result of one traversal, in the order cells were reached
+struct CellVisibility {
+    std::vector<int> cells;
+    std::vector<uint32_t> surfaces;
+    std::vector<uint32_t> paintings;
+    unsigned int portalsTested = 0;
+};
+
+// Cells connected by portals. Visibility starts in the camera's cell with
+// the whole screen and walks through each portal whose projected
+// rectangle overlaps what is still visible, narrowing the rectangle as it
+// goes; contents of each reached cell are tested against the frustum
+// built from its rectangle.
+class CellGraph {
+public:
+    int addCell(const glm::vec3& boundsMin, const glm::vec3& boundsMax);
+    // Connects both ways; 'depth' is the wall thickness the opening passes through
+    void addPortal(int a, int b, const glm::vec3 corners[4], float depth);
+    void addSurface(int cell, uint32_t subMesh);
+    void addPainting(int cell, uint32_t painting);
+    void clear();
+
+    // Fills the per-cell bounds findVisible() tests; call once geometry and paintings are final
+    void buildBounds(const std::vector<SubMesh>& subMeshes, const glm::mat4& model, const std::vector<Painting>& paintings);
+
+    size_t size() const { return cells.size(); }
+    const Cell& getCell(int cell) const { return cells[cell]; }
+
+    // Cell containing the point, or -1 (e.g. inside a doorway)
+    int findCell(const glm::vec3& point) const;
+
+    // Movement constraint: keeps a sphere of 'radius' inside cells and doorways,
+    // sliding along walls one axis at a time
+    bool isWalkable(const glm::vec3& point, float radius) const;
+    glm::vec3 constrainMove(const glm::vec3& from, const glm::vec3& to, float radius) const;
+
+    void findVisible(const glm::mat4& viewProjection, const glm::vec3& eye, CellVisibility& out) const;
+
+private:
+    static const int MAX_DEPTH = 16;
+
+    std::vector<Cell> cells;
+
+    // Traversal scratch, reused between frames
+    mutable std::vector<glm::vec4> reached; // union of rectangles per cell; empty when x > z
+    mutable std::vector<char> onPath;
+    mutable std::vector<uint32_t> scratch;
+
+    void visit(int cell, const glm::vec4& rect, int depth, const glm::mat4& viewProjection,
+               const glm::vec3& eye, CellVisibility& out) const;
+    bool portalRect(const Portal& portal, const glm::mat4& viewProjection, const glm::vec3& eye, glm::vec4& rect) const;
+    void collect(int cell, const glm::vec4& rect, const glm::mat4& viewProjection, CellVisibility& out) const;
+};
+
+#endif
@@ -0,0 +1,90 @@
+#ifndef CLUSTERED_LIGHTING_H
+#define CLUSTERED_LIGHTING_H
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <vector>
+#include "lighting.h"
+#include "shader.h"
+#include "worker_pool.h"
+
+// Clustered forward shading for spot lights. The view frustum is cut into
+// GRID_X x GRID_Y screen tiles and GRID_Z exponential depth slices. Each
+// frame every light's bounding sphere is binned into the clusters it
+// touches, with depth slices split across worker threads. Lights, a
+// per-cluster (first index, count) grid and the flattened index lists
+// live in texture buffers, so a fragment only loops over its own
+// cluster's lights and cost follows local light density.
+class ClusteredLighting {
+public:
+    // Must match the CLUSTER_* constants in lighting.glsl
+    enum { GRID_X = 16, GRID_Y = 9, GRID_Z = 24 };
+    enum { CLUSTER_COUNT = GRID_X * GRID_Y * GRID_Z };
+    // Texture units the buffers stay bound to, clear of material textures
+    enum { LIGHT_UNIT = 8, GRID_UNIT = 9, INDEX_UNIT = 10 };
+
+    struct Stats {
+        unsigned int lightsInView;
+        unsigned int lightIndices;     // entries over all clusters
+        unsigned int maxClusterLights;
+    };
+
+    ClusteredLighting();
+    ~ClusteredLighting();
+
+    // Creates the buffers; needs a current context
+    void init();
+
+    void setLights(const std::vector<SpotLight>& spotLights);
+    const std::vector<SpotLight>& getLights() const { return lights; }
+
+    // Bins the lights for this camera and uploads the grid; once per frame, before drawing
+    void update(const glm::mat4& view, const glm::mat4& projection, float nearPlane, float farPlane,
+                int width, int height);
+
+    // Binds the buffers and sets the cluster uniforms on a program that includes lighting.glsl
+    void apply(Shader& shader) const;
+
+    const Stats& getStats() const { return stats; }
+
+private:
+    struct Box {
+        glm::vec3 min;
+        glm::vec3 max;
+    };
+
+    // A light's view-space bounding sphere and the clusters its box covers
+    struct LightBounds {
+        glm::vec3 center;
+        float radius;
+        int x0, x1, y0, y1, z0, z1;
+    };
+
+    std::vector<SpotLight> lights;
+    std::vector<LightBounds> inView;
+    std::vector<uint32_t> inViewIndices;
+    std::vector<Box> clusterBoxes;
+    std::vector<std::vector<uint32_t> > clusterLights;
+    std::vector<uint32_t> grid;    // first index, count per cluster
+    std::vector<uint32_t> indices;
+
+    GLuint buffers[3];  // lights, grid, indices
+    GLuint textures[3];
+
+    glm::mat4 boxesProjection;
+    float nearPlane, farPlane;
+    float sliceScale, sliceBias;
+    glm::vec2 tilesPerPixel;
+
+    WorkerPool workers;
+    Stats stats;
+
+    int sliceOf(float depth) const;
+    void buildClusterBoxes(const glm::mat4& projection);
+    bool boundLight(const SpotLight& light, const glm::mat4& view, const glm::mat4& projection,
+                    LightBounds& bounds) const;
+    void binSlices(size_t begin, size_t end);
+};
+
+#endif
@@ -0,0 +1,60 @@
+#ifndef CULLING_H
+#define CULLING_H
+
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Six planes (left, right, bottom, top, near, far) pointing inward,
+// extracted from a combined projection * view matrix
+struct Frustum {
+    glm::vec4 planes[6];
+
+    void extract(const glm::mat4& viewProjection);
+    // Narrowed to a screen rectangle (x0, y0, x1, y1 in NDC), e.g. seen through a portal
+    void extract(const glm::mat4& viewProjection, const glm::vec4& ndcRect);
+
+    // Scalar test for a single box; use the batch functions below for many
+    bool intersectsBox(const glm::vec3& minCorner, const glm::vec3& maxCorner) const;
+};
+
+// Bounding volumes in structure-of-arrays form, padded to a multiple of
+// 8 so the SIMD kernels never need a scalar tail
+class BoundingSpheres {
+public:
+    BoundingSpheres() : count(0) {}
+
+    void clear();
+    size_t add(const glm::vec3& center, float radius);
+    size_t size() const { return count; }
+
+private:
+    friend size_t frustumCullSpheres(const Frustum&, const BoundingSpheres&, std::vector<uint32_t>&);
+    std::vector<float> x, y, z, radius;
+    size_t count;
+};
+
+class BoundingBoxes {
+public:
+    BoundingBoxes() : count(0) {}
+
+    void clear();
+    size_t add(const glm::vec3& minCorner, const glm::vec3& maxCorner);
+    // Object-space box, stored as the world-space box enclosing it
+    size_t add(const glm::vec3& minCorner, const glm::vec3& maxCorner, const glm::mat4& model);
+    size_t size() const { return count; }
+
+private:
+    friend size_t frustumCullBoxes(const Frustum&, const BoundingBoxes&, std::vector<uint32_t>&);
+    std::vector<float> cx, cy, cz, ex, ey, ez; // centers and half extents
+    size_t count;
+};
+
+// Write the indices of volumes intersecting the frustum into 'visible'
+// (cleared first) and return how many there are. Uses AVX (8 per
+// iteration) when the CPU has it, SSE otherwise, scalar off x86.
+size_t frustumCullSpheres(const Frustum& frustum, const BoundingSpheres& spheres, std::vector<uint32_t>& visible);
+size_t frustumCullBoxes(const Frustum& frustum, const BoundingBoxes& boxes, std::vector<uint32_t>& visible);
+
+#endif
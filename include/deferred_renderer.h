@@ -0,0 +1,47 @@
+#ifndef DEFERRED_RENDERER_H
+#define DEFERRED_RENDERER_H
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <memory>
+#include "shader.h"
+
+// Deferred shading: geometry is drawn once into a G-buffer (sRGB albedo,
+// RGB10_A2 normal, 24-bit depth) with the GBUFFER variants of the lit
+// shaders, then one full-screen pass lights each covered pixel exactly
+// once. That pass walks the same clustered spot-light lists as forward
+// shading, so it is a tiled deferred resolve rather than light volumes.
+class DeferredRenderer {
+public:
+    enum { ALBEDO = 0, NORMAL, DEPTH, TARGET_COUNT };
+
+    DeferredRenderer();
+    ~DeferredRenderer();
+
+    // Creates the lighting program and full-screen VAO; needs a current context
+    void init();
+
+    // Binds and clears the G-buffer, (re)creating it if the size changed
+    void beginGeometry(int width, int height);
+    // Back to target for the resolve: the default framebuffer, or an offscreen one
+    void endGeometry(GLuint target = 0);
+
+    // Program for the resolve; give it the usual per-frame lighting uniforms first
+    Shader& lightingShader() { return *lighting; }
+    // Lights every pixel the geometry pass covered into the default framebuffer
+    void resolve(const glm::mat4& view, const glm::mat4& projection);
+
+    bool isReady() const { return framebuffer != 0; }
+
+private:
+    std::unique_ptr<Shader> lighting;
+    GLuint framebuffer;
+    GLuint targets[TARGET_COUNT];
+    GLuint emptyVAO;
+    int width, height;
+
+    void createTargets();
+    void releaseTargets();
+};
+
+#endif
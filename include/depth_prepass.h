@@ -0,0 +1,67 @@
+#ifndef DEPTH_PREPASS_H
+#define DEPTH_PREPASS_H
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <memory>
+#include "shader.h"
+
+// Optional depth-only pass ahead of the opaque geometry. Everything opaque
+// is drawn first with position-only programs and no fragment stage, then
+// the lit pass runs with GL_EQUAL and depth writes off, so each pixel is
+// lit once however many surfaces overlap it. It costs a second vertex pass,
+// which pays off once per-fragment lighting (more spot lights per cluster)
+// outweighs it; samples-passed queries around the lit pass count the
+// fragments actually shaded, with the pre-pass on or off, read back a few
+// frames late so they never stall.
+class DepthPrepass {
+public:
+    DepthPrepass();
+    ~DepthPrepass();
+
+    // Builds the depth programs; the multi-draw variant only with multiDraw (GL 4.3)
+    void init(bool multiDraw);
+
+    Shader& meshShader() { return *programs[MESH]; }
+    Shader& paintingShader() { return *programs[PAINTING]; }
+    Shader& frameShader() { return *programs[FRAME]; }
+    Shader& multiDrawShader() { return *programs[MULTI_DRAW]; }
+    void setMatrices(const glm::mat4& view, const glm::mat4& projection);
+
+    // Colour writes off, depth written as usual
+    void begin();
+    // Colour back on, depth read-only and GL_EQUAL, for the lit pass
+    void end();
+    // Ordinary depth testing for whatever draws after the lit pass
+    void restore();
+
+    // Counts the samples the lit pass shades into a viewport of pixels
+    void beginCount(int pixels);
+    void endCount();
+    // The newest count read back, and the same per viewport pixel
+    bool hasCount() const { return counted; }
+    unsigned long long shadedSamples() const { return samples; }
+    float samplesPerPixel() const { return samplesPixels > 0 ? (float)samples / samplesPixels : 0.0f; }
+
+private:
+    enum { MESH, PAINTING, FRAME, MULTI_DRAW, PROGRAM_COUNT };
+    enum { QUERY_COUNT = 4 };
+
+    std::unique_ptr<Shader> programs[PROGRAM_COUNT];
+    GLuint queries[QUERY_COUNT];
+    int queryPixels[QUERY_COUNT];
+    bool pending[QUERY_COUNT];
+    int next;
+    int oldest;
+    bool counting;
+    bool counted;
+    unsigned long long samples;
+    int samplesPixels;
+
+    void collect();
+
+    DepthPrepass(const DepthPrepass&);
+    DepthPrepass& operator=(const DepthPrepass&);
+};
+
+#endif
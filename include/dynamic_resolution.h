@@ -0,0 +1,79 @@
+#ifndef DYNAMIC_RESOLUTION_H
+#define DYNAMIC_RESOLUTION_H
+
+#include <GL/glew.h>
+#include <memory>
+#include "shader.h"
+
+// Renders the scene offscreen at a fraction of the window size and scales
+// it up with a sharpening blit. The fraction follows a PID controller that
+// steers GPU frame time, measured with GL_TIME_ELAPSED queries read back a
+// few frames late, towards a budget. The scale moves in steps so the
+// offscreen targets (and the G-buffer) are only reallocated when it
+// settles on a new step, not every frame.
+class DynamicResolution {
+public:
+    struct Settings {
+        float budgetMs = 16.6f;
+        float minScale = 0.5f;  // per axis
+        float maxScale = 1.0f;
+        float step = 0.05f;
+        // Gains on the budget error as a fraction of the budget; the output moves the scale
+        float kp = 0.1f;
+        float ki = 0.05f;
+        float kd = 0.02f;
+        float sharpness = 0.6f; // at minScale; none at full size
+    };
+
+    DynamicResolution();
+    ~DynamicResolution();
+
+    // Creates the blit program and timer queries; needs a current context
+    void init(const Settings& settings);
+
+    // Starts timing the frame and picks this frame's render size for a window
+    // of width x height; everything up to endFrame() counts against the budget
+    void beginFrame(int width, int height);
+    int renderWidth() const { return targetWidth; }
+    int renderHeight() const { return targetHeight; }
+    // Binds and clears the offscreen target at the render size
+    void bindTarget();
+    GLuint framebuffer() const { return targetFramebuffer; }
+    // Upscales into the window's framebuffer and stops the timer
+    void endFrame();
+
+    float scale() const { return appliedScale; }
+    // Newest GPU frame time read back, in milliseconds; negative until the first one
+    float gpuMs() const { return lastGpuMs; }
+
+private:
+    enum { QUERY_COUNT = 4 };
+
+    Settings settings;
+    std::unique_ptr<Shader> upscale;
+    GLuint emptyVAO;
+    GLuint targetFramebuffer, colorTexture, depthBuffer;
+    int targetWidth, targetHeight;  // allocated size, the render size
+    int windowWidth, windowHeight;
+
+    GLuint queries[QUERY_COUNT];
+    bool pending[QUERY_COUNT];
+    int next, oldest;
+    bool timing;
+
+    // Controller state; scale is continuous, appliedScale is snapped to a step
+    float controlScale, appliedScale;
+    float previousError, olderError; // the last two errors, for the incremental PID
+    bool hasError;
+    float lastGpuMs;
+
+    void collect();
+    void control(float gpuMs);
+    void resize(int width, int height);
+    void releaseTarget();
+
+    DynamicResolution(const DynamicResolution&);
+    DynamicResolution& operator=(const DynamicResolution&);
+};
+
+#endif
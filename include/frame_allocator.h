@@ -0,0 +1,74 @@
+#ifndef FRAME_ALLOCATOR_H
+#define FRAME_ALLOCATOR_H
+
+#include <GL/glew.h>
+#include <vector>
+
+// Linear allocator for data that lives one frame: per-object transforms,
+// instance data, debug geometry. The buffer is split into a region per
+// frame in flight; a frame bumps a pointer through its region, writes
+// with plain memcpy and binds the results by offset. A fence at the end of
+// each frame guards the region until the GPU has read it, so the CPU only
+// waits if it gets a whole ring ahead.
+//
+// With ARB_buffer_storage the buffer is mapped once, persistent and
+// coherent, and writes land in it directly. On plain 3.3 writes go to a
+// CPU copy, and flush() orphans the buffer and uploads the frame's bytes
+// in one call, which the driver can do without waiting on earlier draws.
+class FrameAllocator {
+public:
+    struct Allocation {
+        void* data;      // write-only; NULL if the region is full
+        GLintptr offset; // into buffer()
+    };
+
+    FrameAllocator();
+    ~FrameAllocator();
+
+    // target is GL_UNIFORM_BUFFER or GL_ARRAY_BUFFER (it is only bound to
+    // create and upload); regionSize is bytes per frame
+    void init(GLenum target, GLsizeiptr regionSize, bool allowPersistent, int regionCount = 3);
+    bool isPersistent() const { return persistent; }
+    GLuint buffer() const { return name; }
+    // Allocations start on multiples of this, e.g. the uniform buffer offset alignment
+    GLsizeiptr alignment() const { return align; }
+
+    // Moves to the next region, waiting for its fence if the GPU still reads it
+    void beginFrame();
+    // Grows every region to hold at least size bytes, after waiting for the
+    // GPU to finish with them; only before the frame's first allocate()
+    void reserve(GLsizeiptr size);
+    Allocation allocate(GLsizeiptr size);
+    // Makes the frame's writes visible to GL; call once, after the last
+    // write and before the first draw that reads them
+    void flush();
+    // Fences the region; call after the last draw that reads it
+    void endFrame();
+
+    GLsizeiptr frameBytes() const { return head; }
+    // Frames that had to wait for the GPU to release their region
+    unsigned int stalls() const { return stallCount; }
+
+private:
+    enum { MAX_REGIONS = 4 };
+
+    GLenum target;
+    GLuint name;
+    bool persistent;
+    bool allowPersistent;
+    char* mapped;               // persistent: the whole buffer
+    std::vector<char> staging;  // otherwise: this frame's bytes
+    GLsizeiptr regionSize, align, head;
+    int regionCount, region;
+    GLsync fences[MAX_REGIONS];
+    unsigned int stallCount;
+
+    void create();
+    void release();
+    void waitFor(int index);
+
+    FrameAllocator(const FrameAllocator&);
+    FrameAllocator& operator=(const FrameAllocator&);
+};
+
+#endif
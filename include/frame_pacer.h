@@ -0,0 +1,53 @@
+#ifndef FRAME_PACER_H
+#define FRAME_PACER_H
+
+#include <chrono>
+
+// Swap intervals for glfwSwapInterval
+const int SWAP_UNCAPPED = 0;
+const int SWAP_VSYNC = 1;
+const int SWAP_ADAPTIVE = -1; // vsync, but a late frame tears instead of waiting a whole refresh
+
+// Paces the main loop for latency: sets the swap interval, holds frames to
+// an optional rate with a sleep that hands over to a short spin (sleeps
+// alone overshoot by a scheduler tick), and times each frame from the
+// moment input was sampled to the return of its buffer swap. The limiter
+// waits before input is sampled, so the wait adds nothing to that time.
+class FramePacer {
+public:
+    FramePacer();
+
+    // Applies the swap interval to the current context, falling back to vsync
+    // if adaptive is unsupported; fpsLimit 0 leaves the rate to the swap
+    void init(int swapInterval, float fpsLimit);
+    int swapInterval() const { return interval; }
+
+    // Blocks until the next frame is due under the limit
+    void waitForFrame();
+    // Call right after input is polled, before it is used
+    void inputSampled();
+    // Call right after the buffer swap returns
+    void frameSwapped();
+
+    // Input-to-swap time of the newest frame; negative until the first one.
+    // A queued swap returns before scanout, so this is a lower bound on what is seen
+    float inputLatencyMs() const { return latencyMs; }
+    // Swap to swap
+    float frameMs() const { return lastFrameMs; }
+    // Time the limiter held the newest frame back
+    float waitMs() const { return lastWaitMs; }
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    int interval;
+    Clock::duration period;      // zero when unlimited
+    Clock::duration spinMargin;  // how early before the deadline the sleep stops
+    Clock::time_point deadline;
+    Clock::time_point inputTime;
+    Clock::time_point lastSwap;
+    bool started, sampled;
+    float latencyMs, lastFrameMs, lastWaitMs;
+};
+
+#endif
@@ -0,0 +1,49 @@
+#ifndef FRAME_STATS_H
+#define FRAME_STATS_H
+
+#include <ostream>
+
+// Counters filled in by render() for the frame just drawn
+struct FrameStats {
+    bool deferredShading = false;
+    unsigned int cellsVisible = 0;
+    unsigned int cellCount = 0;
+    unsigned int portalsTested = 0;
+    unsigned int paintingsVisible = 0;
+    unsigned int paintingsCulled = 0;   // outside the frustum or occluded
+    unsigned int paintingsOccluded = 0;
+    unsigned int paintingLODs[3] = { 0, 0, 0 }; // visible paintings per level of detail
+    unsigned int surfacesVisible = 0; // room submeshes
+    unsigned int surfacesCulled = 0;
+    unsigned int occlusionQueries = 0;
+    unsigned int lightsInView = 0;     // spot lights binned into clusters
+    unsigned int lightIndices = 0;     // cluster light-list entries
+    unsigned int maxClusterLights = 0;
+    bool shadowsEnabled = false;
+    bool shadowMapRendered = false;    // static shadow map redrawn this frame, not reused
+    unsigned int shadowMapRenders = 0; // static redraws since startup
+    unsigned int shadowCasters = 0;    // dynamic casters composited this frame
+    bool depthPrepass = false;
+    unsigned int prepassDraws = 0;
+    bool shadedCounted = false;
+    unsigned long long shadedSamples = 0; // fragments the lit pass shaded, a few frames old
+    float samplesPerPixel = 0.0f;         // overdraw of the lit pass; 1 is every pixel once
+    bool dynamicResolution = false;
+    float renderScale = 1.0f;  // per axis
+    int renderWidth = 0;
+    int renderHeight = 0;
+    float gpuFrameMs = -1.0f;  // as the resolution controller last saw it
+    unsigned int frameDataBytes = 0;  // draw transforms written to the per-frame buffer
+    unsigned int frameDataStalls = 0; // frames since startup that waited for a region
+    // Filled in after the swap, for the frame just presented
+    int swapInterval = 1;
+    float frameMs = 0.0f;           // swap to swap
+    float limiterWaitMs = 0.0f;
+    float inputLatencyMs = -1.0f;   // input sampled to swap returned
+
+    void reset() { *this = FrameStats(); }
+};
+
+void printFrameStats(std::ostream& out, const FrameStats& stats);
+
+#endif
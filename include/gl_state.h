@@ -0,0 +1,104 @@
+#ifndef GL_STATE_H
+#define GL_STATE_H
+
+#include <GL/glew.h>
+#include <unordered_map>
+
+// Shadow copy of the GL state we touch every frame (bound program, VAO,
+// texture units, uniform buffer ranges and per-program uniform values). Calls that would not
+// change anything are dropped before they reach the driver.
+class GLStateCache {
+public:
+    enum Category {
+        PROGRAM = 0,
+        VERTEX_ARRAY,
+        ACTIVE_TEXTURE,
+        TEXTURE,
+        UNIFORM,
+        BUFFER_RANGE,
+        CATEGORY_COUNT
+    };
+
+    struct Counters {
+        unsigned int issued[CATEGORY_COUNT];
+        unsigned int skipped[CATEGORY_COUNT];
+
+        unsigned int totalIssued() const;
+        unsigned int totalSkipped() const;
+    };
+
+    static const int MAX_TEXTURE_UNITS = 16;
+    static const int MAX_UNIFORM_BUFFERS = 4;
+
+    GLStateCache();
+
+    // Each returns true if a GL call was actually issued.
+    bool useProgram(GLuint program);
+    bool bindVertexArray(GLuint vao);
+    bool activeTexture(GLuint unit); // unit index, not GL_TEXTURE0 + i
+    bool bindTexture(GLenum target, GLuint texture); // on the active unit
+    bool bindTextureUnit(GLuint unit, GLenum target, GLuint texture);
+    // glBindBufferRange on GL_UNIFORM_BUFFER binding point index
+    bool bindUniformBufferRange(GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size);
+
+    // Uniform uploads go to the given program, binding it first if needed.
+    // Inactive locations (-1) are ignored and not counted in the stats.
+    bool uniform1i(GLuint program, GLint location, int value);
+    bool uniform1f(GLuint program, GLint location, float value);
+    bool uniform2fv(GLuint program, GLint location, const float* value);
+    bool uniform3fv(GLuint program, GLint location, const float* value);
+    bool uniform4fv(GLuint program, GLint location, const float* value);
+    bool uniformMatrix3fv(GLuint program, GLint location, const float* value);
+    bool uniformMatrix4fv(GLuint program, GLint location, const float* value);
+
+    // Must be called when objects are deleted or bindings are changed behind our back
+    void forgetProgram(GLuint program);
+    void forgetVertexArray(GLuint vao);
+    void forgetTexture(GLuint texture);
+    void forgetBuffer(GLuint buffer);
+    void invalidate();
+
+    // The framebuffer that stands in for the window: 0, or an offscreen
+    // target when there is no window surface to draw to
+    void setDefaultFramebuffer(GLuint framebuffer) { windowFramebuffer = framebuffer; }
+    GLuint defaultFramebuffer() const { return windowFramebuffer; }
+
+    // Starts a new set of counters; RenderStats::endFrame() keeps the old one
+    void beginFrame();
+    const Counters& currentFrame() const { return current; }
+    unsigned long long framesCounted() const { return frames; }
+
+private:
+    static const GLuint UNKNOWN = 0xFFFFFFFFu;
+    static const int TARGET_COUNT = 5;
+
+    struct UniformValue {
+        int size; // number of 32-bit components
+        float data[16];
+    };
+
+    GLuint program;
+    GLuint vertexArray;
+    GLuint activeUnit;
+    GLuint textures[MAX_TEXTURE_UNITS][TARGET_COUNT];
+    struct BufferRange {
+        GLuint buffer;
+        GLintptr offset;
+        GLsizeiptr size;
+    };
+    BufferRange uniformBuffers[MAX_UNIFORM_BUFFERS];
+    std::unordered_map<GLuint, std::unordered_map<GLint, UniformValue>> uniforms;
+    GLuint windowFramebuffer;
+
+    Counters current;
+    unsigned long long frames;
+
+    static int targetSlot(GLenum target);
+    bool uniformChanged(GLuint program, GLint location, const float* data, int size);
+    void count(Category category, bool issued);
+};
+
+// Shared cache for the one GL context the application owns
+GLStateCache& glState();
+
+#endif
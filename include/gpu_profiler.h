@@ -0,0 +1,81 @@
+#ifndef GPU_PROFILER_H
+#define GPU_PROFILER_H
+
+#include <GL/glew.h>
+#include <chrono>
+#include <ostream>
+#include <vector>
+
+// GPU and CPU time of named render passes. Each scope brackets its
+// commands with two GL_TIMESTAMP counters, so scopes nest and can sit
+// inside the GL_TIME_ELAPSED query the resolution controller keeps open
+// for the whole frame. Queries go into a ring of frames and are read back
+// only once available, usually two or three frames later; if the GPU falls
+// a whole ring behind, the profiler skips a frame rather than wait.
+class GpuProfiler {
+public:
+    struct Timing {
+        const char* name;
+        int depth;   // 0 for outermost scopes
+        float gpuMs;
+        float cpuMs; // submitting the scope's commands
+    };
+
+    GpuProfiler();
+    ~GpuProfiler();
+
+    // Creates nothing yet; queries are made as scopes need them
+    void init();
+    bool isEnabled() const { return enabled; }
+
+    // Reads back finished frames without waiting and starts recording this one
+    void beginFrame();
+    void endFrame();
+    // name must outlive the profiler (a literal); returns -1 when not recording
+    int begin(const char* name);
+    void end(int scope);
+
+    // Scopes of the newest frame read back, in the order they began
+    const std::vector<Timing>& timings() const { return latest; }
+    // How many frames old those timings are
+    unsigned int framesLate() const { return lateBy; }
+    // Frames not recorded because the ring was still in flight
+    unsigned int skippedFrames() const { return skipped; }
+
+    void print(std::ostream& out) const;
+
+private:
+    typedef std::chrono::steady_clock Clock;
+    enum { FRAME_COUNT = 4 };
+
+    struct Scope {
+        const char* name;
+        int depth;
+        size_t firstQuery; // begin and end counters
+        Clock::time_point cpuBegin, cpuEnd;
+    };
+    struct Frame {
+        std::vector<GLuint> queries; // pool, grown on demand
+        size_t used;
+        std::vector<Scope> scopes;
+        bool pending;
+        unsigned long long number;
+    };
+
+    bool enabled;
+    Frame frames[FRAME_COUNT];
+    int current;
+    bool recording;
+    int depth;
+    unsigned long long frameNumber;
+    std::vector<Timing> latest;
+    unsigned int lateBy;
+    unsigned int skipped;
+
+    bool collect(Frame& frame);
+
+    GpuProfiler(const GpuProfiler&);
+    GpuProfiler& operator=(const GpuProfiler&);
+};
+
+#endif
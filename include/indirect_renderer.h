@@ -0,0 +1,64 @@
+#ifndef INDIRECT_RENDERER_H
+#define INDIRECT_RENDERER_H
+
+#include <GL/glew.h>
+#include <vector>
+#include "shader.h"
+#include "static_mesh.h"
+#include "transform.h"
+
+// Layout glMultiDrawElementsIndirect reads from GL_DRAW_INDIRECT_BUFFER
+struct DrawElementsIndirectCommand {
+    GLuint count;
+    GLuint instanceCount;
+    GLuint firstIndex;
+    GLint baseVertex;
+    GLuint baseInstance;
+};
+
+// GL 4.3+ backend: every submesh draw of a StaticMesh goes into one
+// command buffer and the whole pass is a single glMultiDrawElementsIndirect.
+// Per-draw data (model, normal matrix, material layer) is an instanced
+// attribute stream; each command's baseInstance selects its record, which
+// works without gl_DrawID / ARB_shader_draw_parameters.
+class IndirectRenderer {
+public:
+    struct DrawData {
+        float model[16];
+        float normal[12]; // normal matrix columns, padded to vec4
+        float params[4];  // x = texture array layer
+    };
+
+    static bool isSupported();
+
+    IndirectRenderer();
+    ~IndirectRenderer();
+
+    // Builds the VAO over the mesh's buffers plus the per-draw stream
+    void setMesh(const StaticMesh& mesh);
+
+    void clear();
+    void add(const SubMesh& subMesh, const Transform& transform, int layer);
+
+    // Uploads commands if they changed and issues the pass
+    void submit(Shader& shader, GLuint textureArray);
+    // The same multi-draw over the mesh's positions alone, for a depth pre-pass;
+    // shader reads the model matrix from attributes 3-6
+    void submitDepth(Shader& shader);
+
+    size_t drawCount() const { return commands.size(); }
+
+private:
+    GLuint VAO, depthVAO, commandBuffer, drawDataBuffer;
+    GLenum indexType;
+    bool dirty;
+    unsigned long long triangles; // over all commands, for the frame statistics
+
+    std::vector<DrawElementsIndirectCommand> commands;
+    std::vector<DrawData> drawData;
+
+    void upload();
+    void release();
+};
+
+#endif
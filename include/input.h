@@ -0,0 +1,72 @@
+#ifndef INPUT_H
+#define INPUT_H
+
+#include <GLFW/glfw3.h>
+#include <fstream>
+#include <vector>
+
+// Keyboard and mouse state, advanced once a frame. Live, events arrive
+// from GLFW callbacks and can be recorded to a binary log with the time
+// they took effect; replaying, they come from such a log instead and live
+// input is ignored. Replayed with a fixed frame time, a log drives the
+// camera along the same trajectory on every run.
+class Input {
+public:
+    struct CursorPosition {
+        float x, y;
+    };
+
+    Input();
+
+    // Installs key and cursor callbacks; the window's user pointer becomes this
+    void attach(GLFWwindow* window);
+    // stepSeconds is the fixed frame time the session runs at, 0 when it follows the clock
+    bool startRecording(const char* path, float stepSeconds);
+    bool startReplay(const char* path);
+    bool isReplaying() const { return replaying; }
+    // The fixed frame time the replayed log was recorded with, 0 if none
+    float recordedStep() const { return logStep; }
+    // Every logged event has been applied
+    bool replayFinished() const { return replaying && nextEvent == replayEvents.size(); }
+
+    // Applies what happened up to time, in seconds on the frame clock
+    void update(double time);
+    bool isKeyDown(int key) const { return key >= 0 && key < KEY_COUNT && keys[key]; }
+    // Cursor positions reported since the previous update, oldest first
+    const std::vector<CursorPosition>& cursorMoves() const { return cursor; }
+
+private:
+    enum { KEY_COUNT = 512 };
+    enum EventType { KEY_EVENT = 0, CURSOR_EVENT = 1 };
+
+    struct Event {
+        unsigned int timeUs; // since the first update
+        EventType type;
+        int key;
+        bool pressed;
+        float x, y;
+    };
+
+    bool keys[KEY_COUNT];
+    std::vector<CursorPosition> cursor;
+    std::vector<Event> pending; // live events waiting for update()
+    bool started;
+    double origin;
+
+    std::ofstream recording;
+    bool replaying;
+    float logStep;
+    std::vector<Event> replayEvents;
+    size_t nextEvent;
+
+    void apply(const Event& event);
+    void writeEvent(const Event& event);
+
+    static void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods);
+    static void cursorCallback(GLFWwindow* window, double x, double y);
+
+    Input(const Input&);
+    Input& operator=(const Input&);
+};
+
+#endif
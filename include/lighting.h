@@ -18,6 +18,17 @@ struct DirectionalLight {
     glm::vec3 specular;
 };
 
+// Cone light, such as a ceiling spot aimed at a painting. Angles are
+// half-angles in degrees; light fades to nothing at range.
+struct SpotLight {
+    glm::vec3 position;
+    glm::vec3 direction; // unit length
+    glm::vec3 color;
+    float range;
+    float innerAngle;
+    float outerAngle;
+};
+
 void setLightProperties(Shader &shader, const Light &light, const glm::vec3 &viewPos);
 
 void setDirectionalLightProperties(Shader &shader, const DirectionalLight &dirLight, const glm::vec3 &viewPos);
@@ -0,0 +1,123 @@
+#ifndef LIGHTMAP_H
+#define LIGHTMAP_H
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <string>
+#include <vector>
+#include "bvh.h"
+#include "lighting.h"
+#include "probe_volume.h"
+#include "static_mesh.h"
+#include "worker_pool.h"
+
+// Unit the baked lightmap is bound to for the room programs
+const GLuint LIGHTMAP_UNIT = 12;
+
+// How unwrapLightmap() laid out the atlas
+struct LightmapAtlas {
+    int size = 0;               // texels along each side
+    float texelsPerUnit = 0.0f; // one density for every chart
+    int chartCount = 0;
+};
+
+// Gives each triangle its own place in a size x size atlas. Coplanar
+// triangles of a submesh form a chart, projected onto their plane and
+// shelf packed with a few texels of padding between charts; density is
+// as high as fits, up to maxTexelsPerUnit. Vertices shared by two charts
+// are split so each gets its own lightmap UV.
+LightmapAtlas unwrapLightmap(StaticMeshBuilder& builder, int size, float maxTexelsPerUnit);
+
+// Offline path tracer for the lighting of static geometry. Every atlas
+// texel a triangle covers gets the ambient term, direct light from the sun
+// and the spot lights (with shadow rays) and diffuse interreflection, as
+// irradiance for the shader to multiply surface albedo by. Texels are
+// traced on a WorkerPool, four samples to a ray packet; the noisy
+// indirect part is smoothed with an edge-aware filter before it is added.
+// The same paths, started in every direction from points in open space,
+// give the irradiance probes that light moving objects.
+class LightmapBaker {
+public:
+    struct Material {
+        glm::vec3 albedo;
+        bool castsShadows; // ceilings do not: the sun shines through them as in the shadow map, and spots hang at their level
+    };
+
+    struct Settings {
+        int samples = 64; // per texel, rounded up to a multiple of four
+        int bounces = 2;
+        int probeSamples = 256; // rays per probe, over the whole sphere
+    };
+
+    LightmapBaker() {}
+
+    // Geometry is mesh space placed by model; materials are indexed by submesh material ID
+    void setScene(const StaticMeshBuilder& builder, const glm::mat4& model, const std::vector<Material>& materials);
+    void setLights(const DirectionalLight& sun, const std::vector<SpotLight>& spots);
+
+    // Fills texels with atlas.size^2 RGB values, bottom row first
+    void bake(const LightmapAtlas& atlas, const Settings& settings, std::vector<float>& texels);
+    // Ambient plus indirect light at each probe; direct light is left to the shaders.
+    // Probes that end up inside walls take the average of their neighbours.
+    void bakeProbes(const ProbeGrid& grid, const Settings& settings, std::vector<ProbeSH>& probes);
+
+private:
+    enum { RAY_ANY = 1, RAY_SHADOW = 2 }; // triangle masks: every ray, shadow rays
+
+    struct Random;
+
+    struct Triangle {
+        glm::vec3 positions[3];
+        glm::vec2 uvs[3];                  // lightmap UV
+        glm::vec3 normal;
+        glm::vec3 albedo;
+        std::vector<uint16_t> spots;       // lights whose range reaches the triangle
+    };
+
+    // Where a texel's samples start; triangle is -1 for texels no chart covers
+    struct Texel {
+        glm::vec3 position;
+        int triangle;
+        bool inside; // centre inside the triangle, so its samples may be jittered
+    };
+
+    std::vector<Triangle> triangles;
+    TriangleBVH bvh;
+    float rayOffset = 1e-3f;
+    DirectionalLight sun;
+    std::vector<SpotLight> spots;
+    std::vector<float> spotCosOuter, spotCosInner;
+    WorkerPool workers;
+
+    void rasterize(const LightmapAtlas& atlas, std::vector<Texel>& texels) const;
+    void directLight(const glm::vec3 points[4], const int hitTriangles[4], int active, glm::vec3 result[4],
+                     unsigned long long& rays) const;
+    int tracePaths(RayPacket& packet, int bounces, Random& random, glm::vec3 radiance[4],
+                   unsigned long long& rays) const;
+    void traceTexel(const Texel& texel, int x, int y, int size, const Settings& settings, glm::vec3& direct,
+                    glm::vec3& indirect, unsigned long long& rays) const;
+    void denoise(const LightmapAtlas& atlas, const std::vector<Texel>& texels, std::vector<glm::vec3>& values);
+};
+
+// Fingerprint of what a bake depends on: the unwrapped geometry (charts
+// included) with its placement and atlas size, then the lights on top
+unsigned long long lightmapLayoutHash(const StaticMeshBuilder& builder, const glm::mat4& model, int size);
+unsigned long long lightmapLightsHash(unsigned long long layoutHash, const DirectionalLight& sun,
+                                      const std::vector<SpotLight>& spots);
+
+// The fingerprint a bake at path was made with, kept beside it in path.hash
+bool saveBakeHash(const std::string& path, unsigned long long hash);
+bool bakeHashMatches(const std::string& path, unsigned long long hash);
+// True if there is a bake at path but it was made for another fingerprint
+bool bakeIsStale(const std::string& path, unsigned long long hash);
+
+// Radiance RGBE (.hdr) file of a baked lightmap, plus its fingerprint
+bool saveLightmap(const std::string& path, int size, const std::vector<float>& texels, unsigned long long hash);
+// Baked lightmap as an RGB16F texture; 0 if the file is missing, not size x size,
+// or its fingerprint is not hash
+GLuint loadLightmap(const std::string& path, int size, unsigned long long hash);
+
+// Mean color of an sRGB image in linear RGB, for bake albedo
+glm::vec3 averageTextureColor(const std::string& path);
+
+#endif
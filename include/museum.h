@@ -0,0 +1,42 @@
+#ifndef MUSEUM_H
+#define MUSEUM_H
+
+#include <glm/glm.hpp>
+#include <string>
+#include <vector>
+#include "cells.h"
+#include "painting.h"
+#include "static_mesh.h"
+
+// An image to hang and its pixel size (only the aspect ratio matters)
+struct Artwork {
+    std::string path;
+    glm::vec2 imageSize;
+};
+
+struct MuseumLayout {
+    int columns = 8;
+    int rows = 5;
+    float roomSize = 20.0f;
+    float roomHeight = 10.0f;
+    float wallThickness = 0.2f;
+    float doorWidth = 4.0f;
+    float doorHeight = 6.0f;
+};
+
+struct MuseumMaterials {
+    int floor;
+    int wall;
+    int ceiling;
+};
+
+// Generates a grid of rooms, each a cell, joined by doorways offset along
+// their walls so long sight lines through several rooms are rare. Every
+// floor, ceiling and wall is its own submesh. Geometry is written to the
+// builder in mesh space; cells and paintings are in world space, with the
+// mesh placed at 'origin'. Room (0, 0) is centered on the mesh origin and
+// the grid extends towards +X and -Z.
+void buildMuseum(const MuseumLayout& layout, const MuseumMaterials& materials, const std::vector<Artwork>& artworks,
+                 const glm::vec3& origin, StaticMeshBuilder& builder, CellGraph& cells, std::vector<Painting>& paintings);
+
+#endif
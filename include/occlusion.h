@@ -0,0 +1,97 @@
+#ifndef OCCLUSION_H
+#define OCCLUSION_H
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <memory>
+#include <vector>
+#include "culling.h"
+#include "shader.h"
+
+// Hardware occlusion culling with temporal coherence. Bounding boxes are
+// organised in two levels: groups (a room) holding nodes (the objects in
+// it). Queries are drawn after the frame's geometry and their results are
+// read a frame or more later, only once available, so the CPU never waits.
+//
+// - A hidden group is tested with a single query on its box; its nodes are
+//   not queried until the group turns visible again.
+// - Hidden boxes are queried every frame, visible ones only every
+//   REQUERY_INTERVAL frames.
+// - Boxes containing the camera, or outside the frustum, are treated as
+//   visible without a query.
+class OcclusionCuller {
+public:
+    static const unsigned int REQUERY_INTERVAL = 8;
+
+    struct Stats {
+        unsigned int queriesIssued;
+        unsigned int groupsHidden;
+        unsigned int nodesHidden;
+    };
+
+    OcclusionCuller();
+    ~OcclusionCuller();
+
+    // GL_ANY_SAMPLES_PASSED_CONSERVATIVE on GL 4.3 / ES3 compatibility, else GL_ANY_SAMPLES_PASSED
+    static GLenum queryTarget();
+
+    // Creates the box mesh and shader; needs a current context
+    void init();
+
+    int addGroup(const glm::vec3& minCorner, const glm::vec3& maxCorner);
+    int addNode(int group, const glm::vec3& minCorner, const glm::vec3& maxCorner);
+    void clear();
+
+    // Picks up results that have arrived since they were issued, without waiting
+    void collectResults(const glm::vec3& eye);
+
+    // Last known visibility; a node is hidden whenever its group is
+    bool isGroupVisible(int group) const { return entries[groups[group]].visible; }
+    bool isNodeVisible(int node) const;
+
+    // For a hidden group whose latest query is still in flight: the query to
+    // render its geometry conditionally on, so it appears without a frame of
+    // delay if it turned visible. 0 otherwise.
+    GLuint conditionFor(int group) const;
+
+    // Draws the query boxes against the current depth buffer. Call once the
+    // frame's opaque geometry is done; color and depth writes are disabled.
+    // Groups not in 'groupsInView' (when given) are treated like ones
+    // outside the frustum, e.g. rooms already rejected by portal culling.
+    void issueQueries(const Frustum& frustum, const glm::vec3& eye, const glm::mat4& view, const glm::mat4& projection,
+                      const std::vector<int>* groupsInView = NULL);
+
+    const Stats& getStats() const { return stats; }
+
+private:
+    struct Entry {
+        glm::vec3 minCorner, maxCorner;
+        GLuint query;
+        bool pending;
+        bool visible;
+        unsigned int lastQueried;
+        int group; // -1 for groups themselves
+        std::vector<int> children;
+    };
+
+    std::vector<Entry> entries;
+    std::vector<int> groups; // entry index per group
+    std::vector<int> nodes;  // entry index per node
+    std::vector<char> inView; // per group, this frame
+
+    GLenum target;
+    GLuint boxVAO, boxVBO, boxEBO;
+    std::unique_ptr<Shader> boxShader;
+    unsigned int frame;
+    Stats stats;
+
+    int addEntry(int group, const glm::vec3& minCorner, const glm::vec3& maxCorner);
+    void setSubtreeVisible(Entry& entry);
+    void issue(Entry& entry);
+    bool contains(const Entry& entry, const glm::vec3& point) const;
+
+    OcclusionCuller(const OcclusionCuller&);
+    OcclusionCuller& operator=(const OcclusionCuller&);
+};
+
+#endif
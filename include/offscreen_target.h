@@ -0,0 +1,32 @@
+#ifndef OFFSCREEN_TARGET_H
+#define OFFSCREEN_TARGET_H
+
+#include <GL/glew.h>
+
+// A fixed-size colour and depth framebuffer that takes the window's place
+// when the context has no surface (headless runs). Once bound as the
+// default framebuffer, every pass that would have ended on the window
+// ends here instead.
+class OffscreenTarget {
+public:
+    OffscreenTarget();
+    ~OffscreenTarget();
+
+    // Creates the framebuffer and makes it glState()'s default; needs a current context
+    bool init(int width, int height);
+    GLuint framebuffer() const { return fbo; }
+    int width() const { return targetWidth; }
+    int height() const { return targetHeight; }
+
+    // Saves what was last drawn as a binary PPM, top row first
+    bool writePPM(const char* path) const;
+
+private:
+    GLuint fbo, colorBuffer, depthBuffer;
+    int targetWidth, targetHeight;
+
+    OffscreenTarget(const OffscreenTarget&);
+    OffscreenTarget& operator=(const OffscreenTarget&);
+};
+
+#endif
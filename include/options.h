@@ -0,0 +1,36 @@
+#ifndef OPTIONS_H
+#define OPTIONS_H
+
+// Command-line switches
+struct Options {
+    bool forceGL33 = false;   // --gl33: request a 3.3 context and stay on 3.3 features
+    bool useIndirect = true;  // --no-indirect: keep the 3.3 draw path on 4.3 contexts
+    bool useCulling = true;   // --no-culling: draw everything regardless of the frustum
+    bool useOcclusion = true; // --no-occlusion: skip hardware occlusion queries
+    bool museum = false;      // --museum: 8x5 rooms joined by doorways instead of one room
+    bool printStats = false;  // --stats: print frame statistics once a second
+    const char* statsCsv = nullptr; // --stats-csv FILE: write each frame's render work counters to FILE
+    const char* traceFile = nullptr; // --trace FILE: record CPU scopes and write a Chrome trace to FILE on exit
+    bool deferred = false;    // --deferred: start on the deferred shading path (G toggles at runtime)
+    bool useShadows = true;   // --no-shadows: skip the directional shadow map
+    bool bakeLightmap = false; // --bake-lightmap: path trace the room lighting into assets/lightmaps first
+    bool useBakedLighting = true; // --no-baked-lighting: ignore assets/lightmaps, light everything dynamically
+    bool depthPrepass = false; // --depth-prepass: lay down depth first so each pixel is lit once (Z toggles)
+    float frameBudgetMs = 0.0f; // --dynamic-resolution [MS]: scale the render size to keep GPU time under MS
+    int swapInterval = 1;     // --swap vsync|adaptive|uncapped: 1, -1 or 0 for glfwSwapInterval
+    float fpsLimit = 0.0f;    // --fps-limit N: hold the frame rate to N, 0 for no limit
+    int forceLOD = -1;        // --lod N: draw every painting at level of detail N (0-2)
+    int width = 1280;         // --size WxH: window, or offscreen target, size
+    int height = 720;
+    int headlessFrames = 0;   // --headless [N]: render N frames offscreen without a window, then exit
+    const char* reportFile = nullptr; // --report FILE: where --headless writes its JSON (default stdout)
+    const char* captureFile = nullptr; // --capture FILE: save the last headless frame as a PPM image
+    const char* recordFile = nullptr; // --record FILE: log keyboard and mouse events to FILE
+    const char* replayFile = nullptr; // --replay FILE: drive the camera from a recorded log instead of live input
+    float timestepMs = 0.0f;  // --timestep MS: advance a fixed MS per frame instead of the clock (replays default to the log's)
+};
+
+// Returns false (after printing usage) if the arguments are not understood
+bool parseOptions(int argc, char** argv, Options& options);
+
+#endif
@@ -1,36 +1,37 @@
 #ifndef PAINTING_H
 #define PAINTING_H
 
-#include <GL/glew.h>
+#include <string>
 #include <glm/glm.hpp>
-#include <glm/gtc/matrix_transform.hpp>
-#include "shader.h" // Assuming you have a Shader class defined
+#include "transform.h"
 
+// A framed image hung in the gallery. Paintings hold no GL objects of
+// their own; PaintingRenderer draws all of them from one shared quad.
 class Painting {
 private:
-    GLuint texture;
+    std::string texturePath;
     glm::vec3 position;
     glm::vec2 size;
-    
-    // OpenGL buffer and array objects
-    GLuint VAO, VBO, EBO;
 
-    // Private method to set up geometry
-    void setupGeometry();
+    // Rigid placement only; size is applied per instance in the vertex shader
+    Transform transform;
 
 public:
-    // Constructor
-    Painting(const char* texturePath, const glm::vec3& pos, const glm::vec2& dimensions);
-    
-    // Destructor
-    ~Painting();
+    // Frame moulding around the image, in world units
+    static const float FRAME_WIDTH;
+    static const float FRAME_DEPTH;
 
-    // Draw method
-    void draw(Shader& shader);
+    // Constructor; yaw turns the painting about the vertical axis (0 faces +Z)
+    Painting(const char* path, const glm::vec3& pos, const glm::vec2& dimensions, float yawDegrees = 0.0f);
 
     // Optional: Getter methods if you want to access painting properties
+    const std::string& getTexturePath() const { return texturePath; }
     glm::vec3 getPosition() const { return position; }
     glm::vec2 getSize() const { return size; }
+    const Transform& getTransform() const { return transform; }
+
+    // Sphere around the image and its frame, centred on getPosition()
+    float getBoundingRadius() const;
 };
 
-#endif // PAINTING_H
\ No newline at end of file
+#endif // PAINTING_H
@@ -0,0 +1,131 @@
+#ifndef PAINTING_RENDERER_H
+#define PAINTING_RENDERER_H
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <map>
+#include <string>
+#include <vector>
+#include "painting.h"
+#include "render_queue.h"
+#include "shader.h"
+
+// Draws every painting from one shared unit quad. Per-instance data
+// (rigid model matrix, size, texture layer) lives in a single buffer and
+// images are packed into texture arrays, so each batch of up to
+// maxLayers distinct images is one glDrawElementsInstanced call.
+//
+// Each painting also has a level of detail picked from the projected
+// length of its larger side on screen. Level 0 samples the full-size
+// array and has a bevelled frame, level 1 samples a small proxy array and
+// has a flat frame, level 2 is the proxy image alone. Every batch keeps
+// one instance range per level, so a level is one more instanced draw,
+// not a rebind.
+class PaintingRenderer {
+public:
+    struct Instance {
+        float model[16];
+        float params[4]; // size.x, size.y, layer, unused
+    };
+
+    enum { LOD_COUNT = 3 };
+
+    // Projected larger side in pixels below which a painting drops from level i
+    // to i + 1; it only comes back once it is LOD_HYSTERESIS larger again
+    static const float LOD_THRESHOLDS[LOD_COUNT - 1];
+    static const float LOD_HYSTERESIS;
+
+    explicit PaintingRenderer(int textureSize = 1024, int proxySize = 128);
+    ~PaintingRenderer();
+
+    void add(const Painting& painting);
+    const std::vector<Painting>& getPaintings() const { return paintings; }
+
+    // Creates the shared quad and texture arrays and uploads instance data.
+    // Call after adding paintings; only what changed is rebuilt.
+    void build();
+
+    // Sets which paintings (indices in add() order) are drawn. Instance data
+    // is re-uploaded on the next draw, and only if this or a level changed.
+    void setVisible(const std::vector<uint32_t>& indices);
+
+    // Picks a level for each visible painting from its longer side's
+    // projected size; pixelScale is the viewport height over 2 tan(fovY / 2)
+    void updateLODs(const glm::vec3& eye, float pixelScale);
+    // Pins every painting to one level; -1 goes back to picking by size
+    void setForcedLOD(int level) { forcedLOD = level; }
+
+    // The depth shaders, if given, draw the quads and frames in a depth pre-pass
+    void submit(RenderQueue& queue, Shader& shader, Shader& frameShader, const glm::mat4& view,
+                Shader* depthShader = NULL, Shader* frameDepthShader = NULL);
+    // Every painting and its full frame, visible or not, for the shadow map.
+    // depthShader takes the instance attributes and frame offsets only.
+    void drawShadowCasters(Shader& depthShader);
+
+    size_t batchCount() const { return batches.size(); }
+    size_t visibleCount() const { return visible.size(); }
+    // Visible paintings at each level, as of the last updateLODs()
+    unsigned int lodCount(int level) const { return lodCounts[level]; }
+
+private:
+    enum { FRAME_DETAILED, FRAME_FLAT, FRAME_MESH_COUNT };
+
+    struct Batch {
+        GLuint quadVAOs[LOD_COUNT];               // one per level's instance range
+        GLuint frameVAOs[FRAME_MESH_COUNT];       // levels 0 and 1
+        GLuint textureArray;
+        GLuint proxyArray;
+        std::vector<std::string> layers;
+        GLsizei firstInstance;
+        GLsizei instanceCount;
+        GLsizei visibleCounts[LOD_COUNT];
+        glm::vec3 center;
+
+        // Level l's instances start at LOD_COUNT * firstInstance + l * instanceCount
+        GLsizei rangeStart(int level) const { return LOD_COUNT * firstInstance + level * instanceCount; }
+    };
+
+    struct FrameMesh {
+        GLuint vbo;
+        GLsizei vertexCount;
+    };
+
+    std::vector<Painting> paintings;
+    std::vector<Batch> batches;
+    std::map<std::string, std::pair<int, int> > imageSlots; // path -> (batch, layer)
+
+    // Instances grouped by batch, and each painting's batch and index into that list
+    std::vector<Instance> instances;
+    std::vector<uint32_t> instanceSlots;
+    std::vector<uint32_t> paintingBatches;
+    std::vector<uint32_t> visible;
+    std::vector<Instance> visibleInstances;
+
+    // Current level per painting; kept while it is off screen so it does not pop back
+    std::vector<unsigned char> lods;
+    unsigned int lodCounts[LOD_COUNT];
+    int forcedLOD;
+
+    int layerSize;
+    int proxySize;
+    int maxLayers;
+    bool texturesDirty;
+    bool instancesDirty;
+    bool visibleDirty;
+
+    GLuint quadVBO, quadEBO, instanceVBO;
+    // All instances in batch order, with a quad and a level 0 frame VAO over them
+    GLuint shadowVBO, shadowQuadVAO, shadowFrameVAO;
+    FrameMesh frameMeshes[FRAME_MESH_COUNT];
+    GLuint frameTexture;
+
+    void createQuad();
+    void createFrames();
+    void buildTextures();
+    void uploadInstances();
+    void setInstanceAttributes(GLuint buffer, GLsizei firstInstance);
+    void uploadVisible();
+    void releaseBatches();
+};
+
+#endif
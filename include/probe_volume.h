@@ -0,0 +1,64 @@
+#ifndef PROBE_VOLUME_H
+#define PROBE_VOLUME_H
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <string>
+#include <vector>
+#include "shader.h"
+
+// Unit the probe volume is bound to for lit programs
+const GLuint PROBE_UNIT = 13;
+
+// Regular grid of probes filling a box; each probe sits at the centre of
+// its grid cell, so none lies on the box faces (the walls)
+struct ProbeGrid {
+    glm::vec3 boundsMin, boundsMax;
+    glm::ivec3 counts;
+    glm::vec3 spacing;
+
+    glm::vec3 probePosition(int x, int y, int z) const;
+    size_t size() const { return (size_t)counts.x * counts.y * counts.z; }
+};
+
+// Grid over the box with probes about targetSpacing apart
+ProbeGrid makeProbeGrid(const glm::vec3& boundsMin, const glm::vec3& boundsMax, float targetSpacing);
+
+// Irradiance at a probe as L1 spherical harmonics, already convolved with
+// the cosine lobe: per channel, irradiance(n) = w + dot(xyz, n)
+struct ProbeSH {
+    glm::vec4 red, green, blue; // (x, y, z, w)
+};
+
+// Baked probes as one RGBA16F 3D texture: the red, green and blue
+// coefficients are three blocks of slices stacked along z. Shaders read
+// each block with one trilinear fetch, so anything drawn with the lit
+// programs gets smoothly varying indirect light wherever it moves.
+class ProbeVolume {
+public:
+    ProbeVolume();
+    ~ProbeVolume();
+
+    // False (with a message) if the file is missing or was baked for another
+    // grid, or its fingerprint (see lightmapLightsHash()) is not hash
+    bool load(const std::string& path, const ProbeGrid& grid, unsigned long long hash);
+    bool isLoaded() const { return texture != 0; }
+    const ProbeGrid& getGrid() const { return grid; }
+
+    // Binds the volume and sets the lookup uniforms; disabled, shaders fall back to the flat ambient
+    void apply(Shader& shader, bool enabled) const;
+
+private:
+    GLuint texture;
+    ProbeGrid grid;
+
+    ProbeVolume(const ProbeVolume&);
+    ProbeVolume& operator=(const ProbeVolume&);
+};
+
+// Raw little-endian file: grid header, then the probes in x, y, z order; the
+// fingerprint goes beside it as for a lightmap
+bool saveProbes(const std::string& path, const ProbeGrid& grid, const std::vector<ProbeSH>& probes,
+                unsigned long long hash);
+
+#endif
@@ -0,0 +1,53 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <cstdint>
+#include <string>
+
+// CPU instrumentation: PROFILE_SCOPE("name") times the rest of the enclosing
+// block. Each thread records into its own ring of events (oldest dropped
+// once full) with no locks on the recording path, and the rings export as
+// Chrome trace_event JSON, which chrome://tracing and Perfetto both load.
+// Until start() is called a scope costs one relaxed atomic load.
+class Profiler {
+public:
+    // Begins recording; eventsPerThread is each thread's ring size
+    static void start(size_t eventsPerThread = 1 << 16);
+    static bool isEnabled();
+
+    // Label for the calling thread in the trace; name must outlive the profiler
+    static void setThreadName(const char* name);
+
+    // Nanoseconds since start()
+    static uint64_t now();
+    static void record(const char* name, uint64_t beginNs, uint64_t endNs);
+
+    // Writes every thread's events; other threads should be idle while it runs
+    static bool writeChromeTrace(const std::string& path);
+};
+
+class ProfileScope {
+public:
+    explicit ProfileScope(const char* name) : name(name), active(Profiler::isEnabled()), begin(0) {
+        if (active) begin = Profiler::now();
+    }
+    ~ProfileScope() {
+        if (active) Profiler::record(name, begin, Profiler::now());
+    }
+
+private:
+    const char* name;
+    bool active;
+    uint64_t begin;
+
+    ProfileScope(const ProfileScope&);
+    ProfileScope& operator=(const ProfileScope&);
+};
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+// name must be a literal or otherwise outlive the profiler
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name)
+#define PROFILE_FUNCTION() PROFILE_SCOPE(__FUNCTION__)
+
+#endif
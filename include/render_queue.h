@@ -0,0 +1,84 @@
+#ifndef RENDER_QUEUE_H
+#define RENDER_QUEUE_H
+
+#include <GL/glew.h>
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+#include "frame_allocator.h"
+#include "shader.h"
+#include "transform.h"
+
+enum RenderPass {
+    PASS_OPAQUE = 0,
+    PASS_TRANSPARENT = 8 // passes from here on are sorted back to front
+};
+
+// Everything needed to issue one draw; referenced by index from a sort key
+struct DrawCommand {
+    Shader* shader;
+    GLuint vao;
+    GLenum textureTarget;
+    GLuint texture;
+    const Transform* transform;
+    GLenum mode;
+    GLsizei count;
+    GLenum indexType;  // 0 for glDrawArrays
+    GLintptr first;    // first vertex, or byte offset into the element buffer
+    GLsizei instanceCount; // 0 for a non-instanced draw
+    GLuint condition;      // occlusion query to render conditionally on, 0 for none
+    // Depth pre-pass: the position-only program and VAO (0 to reuse vao).
+    // With the pre-pass on, every opaque command needs one, since the
+    // colour pass only passes fragments whose depth is already there.
+    Shader* depthShader;
+    GLuint depthVao;
+};
+
+// One draw's transform as std140 lays out the Object block (object_block.glsl)
+struct ObjectBlock {
+    glm::mat4 model;
+    glm::vec4 normalMatrix[3]; // mat3 columns, each padded to a vec4
+};
+
+// Draws are submitted as 64-bit keys plus a payload index, radix sorted,
+// then executed through the state cache so consecutive draws sharing a
+// program, texture or VAO do not rebind it. Transforms are written into a
+// per-frame buffer before execution and bound by offset, so a draw costs
+// one buffer range bind instead of two matrix uploads.
+//
+// Opaque key:      pass:4 | program:10 | texture:14 | vao:12 | depth:24
+// Transparent key: pass:4 | far-to-near depth:24 | program:10 | texture:14 | vao:12
+class RenderQueue {
+public:
+    static uint64_t makeKey(unsigned int pass, GLuint program, GLuint texture, GLuint vao, float depth01);
+
+    void clear();
+    void submit(unsigned int pass, const DrawCommand& command, float viewDepth);
+    void sort();
+    // Writes each command's transform into the frame's region of ring (a
+    // GL_UNIFORM_BUFFER allocator); call after sort() and before executing,
+    // then flush the ring
+    void writeObjects(FrameAllocator& ring);
+    void execute();
+    // Lays down depth for the opaque commands with their depth programs, in
+    // the same order; view and projection are the caller's to set
+    unsigned int executeDepth();
+
+    void setDepthRange(float farPlane) { depthScale = farPlane > 0.0f ? 1.0f / farPlane : 0.0f; }
+    size_t size() const { return entries.size(); }
+
+private:
+    struct Entry {
+        uint64_t key;
+        uint32_t payload;
+    };
+
+    std::vector<DrawCommand> commands;
+    std::vector<Entry> entries;
+    std::vector<Entry> scratch;
+    std::vector<GLintptr> objectOffsets; // per command, into objectBuffer
+    GLuint objectBuffer = 0;
+    float depthScale = 0.01f;
+};
+
+#endif
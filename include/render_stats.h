@@ -0,0 +1,86 @@
+#ifndef RENDER_STATS_H
+#define RENDER_STATS_H
+
+#include <GL/glew.h>
+#include <ostream>
+#include <vector>
+#include "gl_state.h"
+
+// How much work a frame hands the GL. Draws and uploads are counted where
+// they are issued; binds and uniform uploads come from the state cache,
+// which every bind and Shader setter already goes through, so only the
+// calls that reached the driver count.
+struct FrameWork {
+    enum Counter {
+        DRAW_CALLS = 0,
+        TRIANGLES,          // submitted; conditional rendering may still drop some
+        PROGRAM_BINDS,
+        VERTEX_ARRAY_BINDS,
+        TEXTURE_BINDS,      // including active unit switches
+        BUFFER_BINDS,       // uniform buffer ranges
+        UNIFORM_UPLOADS,
+        BUFFER_BYTES,
+        TEXTURE_BYTES,
+        COUNTER_COUNT
+    };
+
+    unsigned long long counts[COUNTER_COUNT];
+
+    FrameWork();
+    unsigned long long operator[](Counter counter) const { return counts[counter]; }
+    static const char* name(Counter counter);
+};
+
+// Collects FrameWork for the frame in progress and keeps the last N
+// frames for rolling minimum, average and maximum.
+class RenderStats {
+public:
+    explicit RenderStats(size_t window = 120);
+
+    void setWindow(size_t frames);
+    size_t window() const { return windowSize; }
+
+    // A draw of count vertices (or indices) in mode, instanced or not
+    void countDraw(GLenum mode, GLsizei count, GLsizei instances = 1);
+    // A multi-draw: several draws in one call
+    void countMultiDraw(unsigned long long triangles);
+    void countBufferUpload(size_t bytes) { current.counts[FrameWork::BUFFER_BYTES] += bytes; }
+    void countTextureUpload(size_t bytes) { current.counts[FrameWork::TEXTURE_BYTES] += bytes; }
+
+    // Closes the frame, taking its binds and uniform uploads from the state
+    // cache's counters for the same frame
+    void endFrame(const GLStateCache::Counters& state);
+    // Drops what was counted since the last endFrame(), e.g. loading
+    void discardFrame() { current = FrameWork(); }
+
+    const FrameWork& currentFrame() const { return current; }
+    const FrameWork& lastFrame() const { return last; }
+    // The state cache's counters endFrame() was given, issued and skipped
+    const GLStateCache::Counters& lastStateCache() const { return lastState; }
+    unsigned long long framesCounted() const { return frames; }
+
+    // Over the frames in the window; zeros before the first endFrame()
+    FrameWork minimum() const;
+    FrameWork maximum() const;
+    void average(double out[FrameWork::COUNTER_COUNT]) const;
+
+    // One line of min/avg/max per counter over the window
+    void printSummary(std::ostream& out) const;
+    // frame, then each counter of the last frame
+    static void writeCsvHeader(std::ostream& out);
+    void writeCsvRow(std::ostream& out) const;
+
+private:
+    size_t windowSize;
+    std::vector<FrameWork> history; // ring of the last windowSize frames
+    size_t next;
+    FrameWork current;
+    FrameWork last;
+    GLStateCache::Counters lastState;
+    unsigned long long frames;
+};
+
+// Shared collector for the one GL context the application owns
+RenderStats& renderStats();
+
+#endif
@@ -0,0 +1,57 @@
+#ifndef SCULPTURE_H
+#define SCULPTURE_H
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <vector>
+#include "render_queue.h"
+#include "shader.h"
+#include "static_mesh.h"
+#include "transform.h"
+
+// Marble torus knots turning slowly on concrete plinths. They move, so
+// the baked lightmap cannot cover them: they take their ambient light from
+// the probe volume and are drawn into the shadow map's dynamic layer.
+// Every sculpture shares the two meshes and textures.
+class SculptureRenderer {
+public:
+    SculptureRenderer();
+    ~SculptureRenderer();
+
+    // base is the floor point under the plinth; cell is the room it stands in
+    void add(const glm::vec3& base, int cell);
+    // Creates the meshes and textures; call once sculptures are added
+    void build();
+    // Turns each knot to its angle at time seconds
+    void update(float time);
+
+    size_t size() const { return sculptures.size(); }
+    int getCell(size_t index) const { return sculptures[index].cell; }
+    void getBounds(size_t index, glm::vec3& minCorner, glm::vec3& maxCorner) const;
+
+    // Plinth and knot draws for each listed sculpture; depthShader, if given, draws them in a depth pre-pass
+    void submit(RenderQueue& queue, Shader& shader, const std::vector<uint32_t>& indices, const glm::mat4& view,
+                const std::vector<GLuint>& conditions, Shader* depthShader = NULL);
+    void addShadowCasters(const std::vector<uint32_t>& indices, std::vector<DrawCommand>& casters) const;
+
+private:
+    struct Sculpture {
+        Transform plinth;
+        Transform knot;
+        int cell;
+        float phase; // degrees, so neighbours do not turn in step
+    };
+
+    std::vector<Sculpture> sculptures;
+    StaticMesh plinthMesh;
+    StaticMesh knotMesh;
+    GLuint plinthTexture;
+    GLuint knotTexture;
+
+    DrawCommand command(const StaticMesh& mesh, GLuint texture, const Transform& transform, Shader* shader) const;
+
+    SculptureRenderer(const SculptureRenderer&);
+    SculptureRenderer& operator=(const SculptureRenderer&);
+};
+
+#endif
@@ -3,17 +3,34 @@
 
 #include <GL/glew.h>
 #include <string>
+#include <unordered_map>
 #include <glm/glm.hpp>
 
+// Binding point of the per-object uniform block (shaders/object_block.glsl);
+// programs that declare it are pointed at it when they are linked
+const GLuint OBJECT_BLOCK_BINDING = 0;
+
 class Shader {
 public:
     GLuint ID;
-    Shader(const char* vertexPath, const char* fragmentPath);
+    // defines, if given, is inserted after each stage's #version line (e.g. "#define GBUFFER\n").
+    // A NULL fragmentPath links a vertex-only program, for depth-only passes.
+    Shader(const char* vertexPath, const char* fragmentPath, const char* defines = NULL);
     void use();
+    // False if any stage failed to compile or the program failed to link
+    bool isLinked() const;
+    void setMat3(const std::string &name, const glm::mat3 &mat);
     void setMat4(const std::string &name, const glm::mat4 &mat);
+    void setVec2(const std::string &name, const glm::vec2 &value);
     void setVec3(const std::string &name, const glm::vec3 &value);
+    void setVec4(const std::string &name, const glm::vec4 &value);
     void setFloat(const std::string &name, float value);
     void setInt(const std::string &name, int value);
+
+private:
+    // Uniform locations looked up once per name instead of on every upload
+    std::unordered_map<std::string, GLint> uniformLocations;
+    GLint uniformLocation(const std::string &name);
 };
 
 #endif
@@ -0,0 +1,81 @@
+#ifndef SHADOW_MAP_H
+#define SHADOW_MAP_H
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <memory>
+#include "shader.h"
+
+// Orthographic shadow map for the directional light, cached across frames.
+// Static geometry, all built before the first frame, is rendered into its
+// own depth texture once and again only when the light turns or the scene
+// bounds move. Frames with dynamic casters copy that depth into a second
+// texture and draw just the casters on top, so they cost a blit and a few
+// draws rather than the whole scene. Shaders sample with 3x3 PCF through a
+// comparison sampler.
+class ShadowMap {
+public:
+    // Units the maps are bound to for lit programs, clear of materials and light buffers.
+    // The cached map alone is also bound when dynamic casters were drawn, so
+    // lightmapped surfaces can tell the shadows they already have from new ones.
+    enum { SHADOW_UNIT = 11, STATIC_SHADOW_UNIT = 14 };
+
+    explicit ShadowMap(int size = 2048);
+    ~ShadowMap();
+
+    // Creates the depth textures, framebuffers and depth-only programs
+    void init();
+    bool isReady() const { return framebuffers[0] != 0; }
+
+    // Region the map covers; static casters and receivers should lie inside
+    void setSceneBounds(const glm::vec3& minCorner, const glm::vec3& maxCorner);
+    void setLightDirection(const glm::vec3& direction);
+    bool needsStaticUpdate() const { return staticDirty; }
+
+    // Static pass: renders into the cached map; draw every static caster in between
+    void beginStatic();
+    void endStatic();
+
+    // Dynamic pass: copies the cached map and draws over the copy. Without
+    // one this frame, receivers sample the cached map directly.
+    void beginDynamic();
+    void endDynamic();
+    void beginFrame() { composited = false; }
+
+    // Depth-only programs: per-object "model", and instanced paintings and frames
+    Shader& depthShader() { return *depthProgram; }
+    Shader& instancedDepthShader() { return *instancedDepthProgram; }
+
+    // Binds the map this frame's receivers should use and sets the lookup uniforms
+    void apply(Shader& shader, bool enabled) const;
+
+    const glm::mat4& getLightSpace() const { return lightSpace; }
+    unsigned int staticRenders() const { return staticRenderCount; }
+
+private:
+    enum { STATIC_MAP = 0, COMPOSITE_MAP, MAP_COUNT };
+
+    int size;
+    GLuint textures[MAP_COUNT];
+    GLuint framebuffers[MAP_COUNT];
+    std::unique_ptr<Shader> depthProgram;
+    std::unique_ptr<Shader> instancedDepthProgram;
+
+    glm::vec3 boundsMin, boundsMax;
+    glm::vec3 lightDirection;
+    glm::mat4 lightSpace;
+    float texelSize; // world units per texel
+    bool staticDirty;
+    bool composited;
+    unsigned int staticRenderCount;
+    GLint savedViewport[4];
+
+    void updateLightSpace();
+    void beginPass(int map);
+    void endPass();
+
+    ShadowMap(const ShadowMap&);
+    ShadowMap& operator=(const ShadowMap&);
+};
+
+#endif
@@ -0,0 +1,10 @@
+#ifndef SIMD_MATH_H
+#define SIMD_MATH_H
+
+#include <glm/glm.hpp>
+
+// Inverse transpose of the upper 3x3 of a model matrix, built from cross
+// products of its columns. Uses SSE where available, scalar code otherwise.
+glm::mat3 computeNormalMatrix(const glm::mat4& model);
+
+#endif
@@ -0,0 +1,96 @@
+#ifndef STATIC_MESH_H
+#define STATIC_MESH_H
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <unordered_map>
+#include <vector>
+
+// Interleaved layout shared by all lit geometry: locations 0, 1, 2 and 12
+struct Vertex {
+    glm::vec3 position;
+    glm::vec3 normal;
+    glm::vec2 texCoords;
+    glm::vec2 lightmapUV; // atlas position, filled in by unwrapLightmap()
+
+    Vertex() {}
+    Vertex(const glm::vec3& p, const glm::vec3& n, const glm::vec2& uv)
+        : position(p), normal(n), texCoords(uv), lightmapUV(0.0f) {}
+};
+
+// A range of the shared index buffer drawn with one material
+struct SubMesh {
+    GLuint firstIndex;
+    GLsizei indexCount;
+    int materialId;
+    glm::vec3 boundsMin, boundsMax; // object space
+};
+
+// Collects static geometry into one deduplicated vertex/index list.
+// Each beginSubMesh() starts a new draw range tagged with a material ID.
+class StaticMeshBuilder {
+public:
+    int beginSubMesh(int materialId);
+    void addTriangle(const Vertex& a, const Vertex& b, const Vertex& c);
+    void addQuad(const Vertex& a, const Vertex& b, const Vertex& c, const Vertex& d); // a-b-c, a-c-d
+
+    const std::vector<Vertex>& getVertices() const { return vertices; }
+    const std::vector<GLuint>& getIndices() const { return indices; }
+    const std::vector<SubMesh>& getSubMeshes() const { return subMeshes; }
+
+    // Swaps in rewritten vertices and indices over the same submesh ranges,
+    // for passes that split vertices, such as lightmap unwrapping
+    void setGeometry(const std::vector<Vertex>& newVertices, const std::vector<GLuint>& newIndices);
+
+private:
+    struct VertexHash {
+        size_t operator()(const Vertex& v) const;
+    };
+    struct VertexEqual {
+        bool operator()(const Vertex& a, const Vertex& b) const;
+    };
+
+    std::vector<Vertex> vertices;
+    std::vector<GLuint> indices;
+    std::vector<SubMesh> subMeshes;
+    std::unordered_map<Vertex, GLuint, VertexHash, VertexEqual> lookup;
+
+    GLuint addVertex(const Vertex& v);
+};
+
+// GPU copy of a builder's output: one VAO, one VBO, one EBO. Indices are
+// stored as 16-bit when the vertex count allows it. A second VAO reads a
+// packed copy of the positions alone, through the same EBO, for
+// depth-only passes that would otherwise fetch whole vertices.
+class StaticMesh {
+public:
+    StaticMesh();
+    ~StaticMesh();
+
+    void upload(const StaticMeshBuilder& builder);
+    void release();
+
+    GLuint getVAO() const { return VAO; }
+    GLuint getDepthVAO() const { return depthVAO; }
+    GLuint getPositionBuffer() const { return positionVBO; }
+    GLuint getVertexBuffer() const { return VBO; }
+    GLuint getIndexBuffer() const { return EBO; }
+    GLenum getIndexType() const { return indexType; }
+    size_t getIndexSize() const { return indexType == GL_UNSIGNED_SHORT ? 2 : 4; }
+    const std::vector<SubMesh>& getSubMeshes() const { return subMeshes; }
+
+    // Byte offset of a submesh's first index, for glDrawElements
+    GLintptr indexOffset(const SubMesh& subMesh) const { return (GLintptr)(subMesh.firstIndex * getIndexSize()); }
+
+private:
+    GLuint VAO, VBO, EBO;
+    GLuint depthVAO, positionVBO;
+    GLenum indexType;
+    std::vector<SubMesh> subMeshes;
+
+    StaticMesh(const StaticMesh&);
+    StaticMesh& operator=(const StaticMesh&);
+};
+
+#endif
@@ -7,4 +7,15 @@
 
 GLuint loadTexture(const std::string &path);
 
+// sRGB texture array with a full mip chain; layers are filled with loadTextureLayer
+GLuint createTextureArray(int width, int height, int layers);
+
+// Loads an image, resamples it to the array's layer size and uploads it.
+// Mipmaps are not regenerated; call glGenerateMipmap once all layers are in.
+bool loadTextureLayer(GLuint textureArray, int layer, const std::string &path, int width, int height);
+
+// Copies one mip level of a texture array (level 0 is width x height) into a
+// new array of that size with its own mip chain, e.g. a low-resolution proxy
+GLuint createTextureArrayFromLevel(GLuint source, int level, int width, int height, int layers);
+
 #endif
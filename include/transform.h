@@ -0,0 +1,37 @@
+#ifndef TRANSFORM_H
+#define TRANSFORM_H
+
+#include <glm/glm.hpp>
+
+// Per-object placement. The model and normal matrices are computed on the
+// CPU once and cached until position, rotation or scale changes, so shaders
+// never have to invert the model matrix per vertex.
+class Transform {
+public:
+    Transform();
+    explicit Transform(const glm::vec3& startPos);
+
+    void setPosition(const glm::vec3& newPosition);
+    void setRotation(const glm::vec3& eulerDegrees); // applied Y, then X, then Z
+    void setScale(const glm::vec3& newScale);
+
+    glm::vec3 getPosition() const { return position; }
+    glm::vec3 getRotation() const { return rotation; }
+    glm::vec3 getScale() const { return scale; }
+
+    const glm::mat4& getModelMatrix() const;
+    const glm::mat3& getNormalMatrix() const;
+
+private:
+    glm::vec3 position;
+    glm::vec3 rotation;
+    glm::vec3 scale;
+
+    mutable glm::mat4 model;
+    mutable glm::mat3 normal;
+    mutable bool dirty;
+
+    void update() const;
+};
+
+#endif
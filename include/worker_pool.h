@@ -0,0 +1,45 @@
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A few long-lived threads for splitting per-frame CPU work. parallelFor
+// hands out chunks of an index range to the workers and the calling
+// thread and returns once every chunk has run; one job at a time.
+class WorkerPool {
+public:
+    // 0 picks one worker per hardware thread, less the caller's
+    explicit WorkerPool(unsigned int workers = 0);
+    ~WorkerPool();
+
+    // Calls job(begin, end) over disjoint pieces of [0, count)
+    void parallelFor(size_t count, const std::function<void(size_t begin, size_t end)>& job);
+
+    // Threads taking part in a job, the caller included
+    unsigned int threadCount() const { return (unsigned int)threads.size() + 1; }
+
+private:
+    std::vector<std::thread> threads;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable finished;
+
+    const std::function<void(size_t, size_t)>* job;
+    size_t jobCount;
+    size_t chunkSize;
+    std::atomic<size_t> nextIndex;
+    unsigned int generation;
+    unsigned int running;
+    bool stopping;
+
+    void workerLoop();
+    void runChunks();
+};
+
+#endif
@@ -0,0 +1,468 @@
+// Performance regression check. Renders each predefined scene headless
+// along a recorded camera path (perf/paths), then compares frame-time
+// percentiles, render work and memory high-water marks with
+// perf/baseline.json, and the last frame with perf/golden/<scene>.ppm using
+// SSIM. Exits non-zero if anything regressed past its tolerance.
+//
+//   perftest [--update] [--runs N] [--out DIR] BINARY
+//
+// Run from the repository root (make perftest does). Each scene runs N
+// times (default 3) and keeps the best of each measurement, which filters
+// out most scheduling noise. --update rewrites the baseline and golden
+// images from this run instead of checking; frame times only compare on
+// the machine the baseline was taken on, so refresh it there after a
+// deliberate change.
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <sys/stat.h>
+#include <utility>
+#include <vector>
+
+struct Scene {
+    const char* name;
+    const char* args;
+};
+
+// Fixed size and step, no resolution scaling, and dynamic lighting only, since
+// the bakes in assets/lightmaps are not in the repository; every run draws the same frames
+static const char* COMMON_ARGS = "--headless 100000 --size 320x180 --no-baked-lighting";
+static const Scene SCENES[] = {
+    {"room", "--replay perf/paths/room.log"},
+    {"room_deferred", "--deferred --depth-prepass --replay perf/paths/room.log"},
+    {"room_gl33", "--gl33 --replay perf/paths/room.log"},
+    {"museum", "--museum --replay perf/paths/museum.log"},
+};
+static const int SCENE_COUNT = sizeof(SCENES) / sizeof(SCENES[0]);
+
+struct Metric {
+    const char* name;       // key in the baseline
+    const char* reportPath; // dotted path in the run's report
+    const char* tolerance;  // relative headroom, by group
+    const char* unit;
+};
+
+static const Metric METRICS[] = {
+    {"frame_ms_p50", "frame_ms.p50", "frame_ms", "ms"},
+    {"frame_ms_p95", "frame_ms.p95", "frame_ms", "ms"},
+    {"draw_calls", "work.draw_calls.mean", "draw_calls", ""},
+    {"triangles", "work.triangles.mean", "triangles", ""},
+    {"peak_rss_kb", "memory_kb.peak_rss", "memory", "KB"},
+    {"startup_textures_kb", "memory_kb.startup_textures", "memory", "KB"},
+};
+static const int METRIC_COUNT = sizeof(METRICS) / sizeof(METRICS[0]);
+
+struct Tolerance {
+    const char* name;
+    double value;
+};
+
+// Used when the baseline has none
+static const Tolerance DEFAULT_TOLERANCES[] = {
+    {"frame_ms", 0.25}, {"draw_calls", 0.10}, {"triangles", 0.10}, {"memory", 0.15},
+    {"min_ssim", 0.98}, {"min_window_ssim", 0.80},
+};
+static const int TOLERANCE_COUNT = sizeof(DEFAULT_TOLERANCES) / sizeof(DEFAULT_TOLERANCES[0]);
+
+// Just enough JSON for the report and the baseline
+struct JsonValue {
+    enum Type { NUL, BOOLEAN, NUMBER, STRING, ARRAY, OBJECT };
+    Type type;
+    double number;
+    std::string text;
+    std::vector<JsonValue> items;
+    std::vector<std::pair<std::string, JsonValue> > members;
+
+    JsonValue() : type(NUL), number(0.0) {}
+
+    const JsonValue* find(const std::string& key) const {
+        for (size_t i = 0; i < members.size(); ++i) {
+            if (members[i].first == key) return &members[i].second;
+        }
+        return NULL;
+    }
+
+    // "a.b.c" through nested objects
+    const JsonValue* path(const char* dotted) const {
+        const JsonValue* value = this;
+        std::string rest(dotted);
+        while (value && !rest.empty()) {
+            size_t dot = rest.find('.');
+            value = value->find(rest.substr(0, dot));
+            rest = dot == std::string::npos ? "" : rest.substr(dot + 1);
+        }
+        return value;
+    }
+};
+
+class JsonParser {
+public:
+    explicit JsonParser(const std::string& text) : p(text.c_str()) {}
+
+    bool parse(JsonValue& value) {
+        if (!parseValue(value)) return false;
+        skipSpace();
+        return *p == '\0';
+    }
+
+private:
+    const char* p;
+
+    void skipSpace() {
+        while (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r') ++p;
+    }
+
+    bool parseString(std::string& out) {
+        if (*p != '"') return false;
+        for (++p; *p && *p != '"'; ++p) {
+            if (*p == '\\') {
+                ++p;
+                if (*p == 'n') out += '\n';
+                else if (*p == 't') out += '\t';
+                else if (*p == 'u') return false; // never written by the renderer
+                else if (*p) out += *p;
+                else return false;
+            } else {
+                out += *p;
+            }
+        }
+        if (*p != '"') return false;
+        ++p;
+        return true;
+    }
+
+    bool parseValue(JsonValue& value) {
+        skipSpace();
+        if (*p == '{') {
+            value.type = JsonValue::OBJECT;
+            ++p;
+            skipSpace();
+            if (*p == '}') return ++p, true;
+            for (;;) {
+                std::pair<std::string, JsonValue> member;
+                skipSpace();
+                if (!parseString(member.first)) return false;
+                skipSpace();
+                if (*p++ != ':' || !parseValue(member.second)) return false;
+                value.members.push_back(member);
+                skipSpace();
+                if (*p == ',') { ++p; continue; }
+                return *p++ == '}';
+            }
+        }
+        if (*p == '[') {
+            value.type = JsonValue::ARRAY;
+            ++p;
+            skipSpace();
+            if (*p == ']') return ++p, true;
+            for (;;) {
+                JsonValue item;
+                if (!parseValue(item)) return false;
+                value.items.push_back(item);
+                skipSpace();
+                if (*p == ',') { ++p; continue; }
+                return *p++ == ']';
+            }
+        }
+        if (*p == '"') {
+            value.type = JsonValue::STRING;
+            return parseString(value.text);
+        }
+        if (std::strncmp(p, "true", 4) == 0 || std::strncmp(p, "false", 5) == 0) {
+            value.type = JsonValue::BOOLEAN;
+            value.number = *p == 't' ? 1.0 : 0.0;
+            p += *p == 't' ? 4 : 5;
+            return true;
+        }
+        if (std::strncmp(p, "null", 4) == 0) {
+            p += 4;
+            return true;
+        }
+        char* end = NULL;
+        value.type = JsonValue::NUMBER;
+        value.number = std::strtod(p, &end);
+        if (end == p) return false;
+        p = end;
+        return true;
+    }
+};
+
+static bool readFile(const std::string& path, std::string& out) {
+    std::ifstream in(path.c_str(), std::ios::binary);
+    if (!in) return false;
+    std::ostringstream text;
+    text << in.rdbuf();
+    out = text.str();
+    return true;
+}
+
+static bool loadJson(const std::string& path, JsonValue& value) {
+    std::string text;
+    if (!readFile(path, text)) return false;
+    JsonParser parser(text);
+    if (!parser.parse(value)) {
+        std::cerr << "Malformed JSON in " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+struct Image {
+    int width, height;
+    std::vector<float> luma;
+};
+
+static bool loadPPM(const std::string& path, Image& image) {
+    std::string data;
+    if (!readFile(path, data)) return false;
+    // Header: P6, width, height, max value, each separated by whitespace or comments
+    size_t pos = 0;
+    int fields[4] = {0, 0, 0, 0};
+    for (int field = 0; field < 4; ++field) {
+        while (pos < data.size()) {
+            if (data[pos] == '#') {
+                while (pos < data.size() && data[pos] != '\n') ++pos;
+            } else if (std::isspace((unsigned char)data[pos])) {
+                ++pos;
+            } else {
+                break;
+            }
+        }
+        if (field == 0) {
+            if (data.compare(pos, 2, "P6") != 0) return false;
+            pos += 2;
+            continue;
+        }
+        while (pos < data.size() && std::isdigit((unsigned char)data[pos])) {
+            fields[field] = fields[field] * 10 + (data[pos++] - '0');
+        }
+    }
+    ++pos; // the single whitespace byte before the pixels
+    image.width = fields[1];
+    image.height = fields[2];
+    size_t count = (size_t)image.width * image.height;
+    if (fields[3] != 255 || count == 0 || data.size() < pos + count * 3) return false;
+
+    image.luma.resize(count);
+    const unsigned char* pixels = (const unsigned char*)data.data() + pos;
+    for (size_t i = 0; i < count; ++i) {
+        image.luma[i] = 0.299f * pixels[3 * i] + 0.587f * pixels[3 * i + 1] + 0.114f * pixels[3 * i + 2];
+    }
+    return true;
+}
+
+// Structural similarity of the luma over 8x8 windows a half window apart:
+// the mean over the image, and the worst single window so a small local
+// breakage cannot hide in a good average
+static bool compareImages(const Image& a, const Image& b, double& meanSsim, double& minSsim) {
+    if (a.width != b.width || a.height != b.height) return false;
+    const int WINDOW = 8, STRIDE = 4;
+    const double C1 = (0.01 * 255) * (0.01 * 255), C2 = (0.03 * 255) * (0.03 * 255);
+    double sum = 0.0;
+    int windows = 0;
+    minSsim = 1.0;
+    for (int y = 0; y + WINDOW <= a.height; y += STRIDE) {
+        for (int x = 0; x + WINDOW <= a.width; x += STRIDE) {
+            double meanA = 0.0, meanB = 0.0;
+            for (int j = 0; j < WINDOW; ++j) {
+                for (int i = 0; i < WINDOW; ++i) {
+                    meanA += a.luma[(size_t)(y + j) * a.width + x + i];
+                    meanB += b.luma[(size_t)(y + j) * b.width + x + i];
+                }
+            }
+            const double n = WINDOW * WINDOW;
+            meanA /= n;
+            meanB /= n;
+            double varA = 0.0, varB = 0.0, covariance = 0.0;
+            for (int j = 0; j < WINDOW; ++j) {
+                for (int i = 0; i < WINDOW; ++i) {
+                    double da = a.luma[(size_t)(y + j) * a.width + x + i] - meanA;
+                    double db = b.luma[(size_t)(y + j) * b.width + x + i] - meanB;
+                    varA += da * da;
+                    varB += db * db;
+                    covariance += da * db;
+                }
+            }
+            varA /= n - 1;
+            varB /= n - 1;
+            covariance /= n - 1;
+            double ssim = ((2 * meanA * meanB + C1) * (2 * covariance + C2))
+                          / ((meanA * meanA + meanB * meanB + C1) * (varA + varB + C2));
+            sum += ssim;
+            minSsim = std::min(minSsim, ssim);
+            ++windows;
+        }
+    }
+    meanSsim = windows ? sum / windows : 1.0;
+    return windows > 0;
+}
+
+static bool copyFile(const std::string& from, const std::string& to) {
+    std::string data;
+    if (!readFile(from, data)) return false;
+    std::ofstream out(to.c_str(), std::ios::binary);
+    out << data;
+    return (bool)out;
+}
+
+static double tolerance(const JsonValue& baseline, const char* name) {
+    const JsonValue* value = baseline.path((std::string("tolerances.") + name).c_str());
+    if (value && value->type == JsonValue::NUMBER) return value->number;
+    for (int i = 0; i < TOLERANCE_COUNT; ++i) {
+        if (std::strcmp(DEFAULT_TOLERANCES[i].name, name) == 0) return DEFAULT_TOLERANCES[i].value;
+    }
+    return 0.0;
+}
+
+static bool writeBaseline(const std::string& path, const JsonValue& previous,
+                          const std::vector<std::vector<double> >& values) {
+    std::ofstream out(path.c_str());
+    char number[64];
+    out << "{\n  \"tolerances\": {";
+    for (int i = 0; i < TOLERANCE_COUNT; ++i) {
+        std::snprintf(number, sizeof(number), "%.3f", tolerance(previous, DEFAULT_TOLERANCES[i].name));
+        out << (i ? ", " : "") << '"' << DEFAULT_TOLERANCES[i].name << "\": " << number;
+    }
+    out << "},\n  \"scenes\": {\n";
+    for (int s = 0; s < SCENE_COUNT; ++s) {
+        out << "    \"" << SCENES[s].name << "\": {";
+        for (int m = 0; m < METRIC_COUNT; ++m) {
+            std::snprintf(number, sizeof(number), "%.3f", values[s][m]);
+            out << (m ? ", " : "") << '"' << METRICS[m].name << "\": " << number;
+        }
+        out << "}" << (s + 1 < SCENE_COUNT ? "," : "") << "\n";
+    }
+    out << "  }\n}\n";
+    return (bool)out;
+}
+
+int main(int argc, char** argv) {
+    bool update = false;
+    int runs = 3;
+    std::string outDir = "build/perf";
+    const char* binary = NULL;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--update") == 0) {
+            update = true;
+        } else if (std::strcmp(argv[i], "--runs") == 0 && i + 1 < argc && std::atoi(argv[i + 1]) > 0) {
+            runs = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--out") == 0 && i + 1 < argc) {
+            outDir = argv[++i];
+        } else if (!binary && argv[i][0] != '-') {
+            binary = argv[i];
+        } else {
+            binary = NULL;
+            break;
+        }
+    }
+    if (!binary) {
+        std::cerr << "Usage: " << argv[0] << " [--update] [--runs N] [--out DIR] BINARY" << std::endl;
+        return 2;
+    }
+
+    const std::string baselinePath = "perf/baseline.json";
+    JsonValue baseline;
+    if (!loadJson(baselinePath, baseline) && !update) {
+        std::cerr << "No baseline at " << baselinePath << "; run make perftest-update first" << std::endl;
+        return 2;
+    }
+    mkdir(outDir.c_str(), 0755);
+
+    std::vector<std::vector<double> > values(SCENE_COUNT, std::vector<double>(METRIC_COUNT, 0.0));
+    int failures = 0;
+    for (int s = 0; s < SCENE_COUNT; ++s) {
+        const Scene& scene = SCENES[s];
+        std::string prefix = outDir + "/" + scene.name;
+        std::string command = std::string(binary) + " " + COMMON_ARGS + " " + scene.args + " --report " + prefix
+                              + ".json --capture " + prefix + ".ppm > " + prefix + ".log 2>&1";
+        std::cout << scene.name << ": " << scene.args << std::endl;
+        bool ran = true;
+        for (int run = 0; run < runs && ran; ++run) {
+            // Outputs of an earlier run must not pass for this one's
+            std::remove((prefix + ".json").c_str());
+            std::remove((prefix + ".ppm").c_str());
+            JsonValue report;
+            ran = std::system(command.c_str()) == 0 && loadJson(prefix + ".json", report);
+            for (int m = 0; ran && m < METRIC_COUNT; ++m) {
+                const JsonValue* value = report.path(METRICS[m].reportPath);
+                double measured = value ? value->number : 0.0;
+                values[s][m] = run ? std::min(values[s][m], measured) : measured;
+            }
+        }
+        if (!ran) {
+            std::cout << "  FAILED to run; see " << prefix << ".log" << std::endl;
+            ++failures;
+            continue;
+        }
+
+        const JsonValue* expected = baseline.path((std::string("scenes.") + scene.name).c_str());
+        if (!update && !expected) {
+            std::cout << "  no baseline for this scene; run make perftest-update" << std::endl;
+            ++failures;
+        }
+        for (int m = 0; m < METRIC_COUNT; ++m) {
+            const Metric& metric = METRICS[m];
+            if (update || !expected) continue;
+
+            const JsonValue* reference = expected->find(metric.name);
+            if (!reference) {
+                std::cout << "  " << metric.name << ": not in the baseline" << std::endl;
+                ++failures;
+                continue;
+            }
+            // Only growth fails: a faster or leaner run is a reason to update, not an error
+            double limit = reference->number * (1.0 + tolerance(baseline, metric.tolerance));
+            bool regressed = values[s][m] > limit;
+            char line[160];
+            std::snprintf(line, sizeof(line), "  %-20s %12.3f %-2s (baseline %.3f, limit %.3f)%s", metric.name,
+                          values[s][m], metric.unit, reference->number, limit, regressed ? "  REGRESSION" : "");
+            std::cout << line << std::endl;
+            if (regressed) ++failures;
+        }
+
+        std::string golden = std::string("perf/golden/") + scene.name + ".ppm";
+        if (update) {
+            if (!copyFile(prefix + ".ppm", golden)) {
+                std::cout << "  cannot write " << golden << std::endl;
+                ++failures;
+            }
+            continue;
+        }
+        Image goldenImage, captured;
+        double meanSsim = 0.0, minSsim = 0.0;
+        if (!loadPPM(golden, goldenImage) || !loadPPM(prefix + ".ppm", captured)
+            || !compareImages(goldenImage, captured, meanSsim, minSsim)) {
+            std::cout << "  image: cannot compare " << prefix << ".ppm with " << golden << std::endl;
+            ++failures;
+            continue;
+        }
+        bool differs = meanSsim < tolerance(baseline, "min_ssim") || minSsim < tolerance(baseline, "min_window_ssim");
+        char line[160];
+        std::snprintf(line, sizeof(line), "  %-20s %12.4f    (worst window %.4f)%s", "image_ssim", meanSsim, minSsim,
+                      differs ? "  REGRESSION" : "");
+        std::cout << line << std::endl;
+        if (differs) ++failures;
+    }
+
+    if (update) {
+        if (failures || !writeBaseline(baselinePath, baseline, values)) {
+            std::cerr << "Baseline not updated" << std::endl;
+            return 1;
+        }
+        std::cout << "Updated " << baselinePath << " and perf/golden" << std::endl;
+        return 0;
+    }
+    if (failures) {
+        std::cout << "Performance check FAILED: " << failures << " problem" << (failures == 1 ? "" : "s") << std::endl;
+        return 1;
+    }
+    std::cout << "Performance check passed" << std::endl;
+    return 0;
+}
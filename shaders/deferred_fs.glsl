@@ -0,0 +1,32 @@
+#version 330 core
+
+#include "lighting.glsl"
+
+out vec4 FragColor;
+
+uniform sampler2D gAlbedo;
+uniform sampler2D gNormal;
+uniform sampler2D gDepth;
+uniform mat4 inverseViewProjection;
+
+void main() {
+    ivec2 pixel = ivec2(gl_FragCoord.xy);
+    float depth = texelFetch(gDepth, pixel, 0).r;
+    if (depth == 1.0) discard;
+
+    vec3 albedo = texelFetch(gAlbedo, pixel, 0).rgb;
+    vec4 packedNormal = texelFetch(gNormal, pixel, 0);
+    if (packedNormal.a == 0.0) {
+        // Lit when the G-buffer was written (lightmapped surfaces)
+        FragColor = vec4(albedo, 1.0);
+        return;
+    }
+    vec3 normal = packedNormal.xyz * 2.0 - 1.0;
+
+    // World position back from window position and depth
+    vec2 ndc = gl_FragCoord.xy / vec2(textureSize(gDepth, 0)) * 2.0 - 1.0;
+    vec4 world = inverseViewProjection * vec4(ndc, depth * 2.0 - 1.0, 1.0);
+    vec3 fragPos = world.xyz / world.w;
+
+    FragColor = vec4(CalcLightingAt(normal, fragPos, albedo, vec3(gl_FragCoord.xy, depth)), 1.0);
+}
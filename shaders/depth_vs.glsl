@@ -0,0 +1,44 @@
+#version 330 core
+
+// Depth pre-pass, no fragment stage. Each variant computes gl_Position with
+// the same expressions as the lit program it stands in for, and both are
+// invariant, so the lit pass can test GL_EQUAL against this depth.
+//   default     static meshes and sculptures (vertex_shader.glsl)
+//   PAINTING    painting quads (painting_vs.glsl)
+//   FRAME       painting frames (frame_vs.glsl)
+//   MULTI_DRAW  the room through IndirectRenderer (indirect_vs.glsl)
+
+layout (location = 0) in vec3 aPos;
+
+#if defined(PAINTING) || defined(FRAME)
+layout (location = 3) in mat4 iModel;
+layout (location = 7) in vec4 iParams;    // xy = painting size
+#elif defined(MULTI_DRAW)
+layout (location = 3) in mat4 dModel;
+#else
+#include "object_block.glsl"
+#endif
+#ifdef FRAME
+layout (location = 11) in vec3 aOffset;
+#endif
+
+uniform mat4 view;
+uniform mat4 projection;
+
+invariant gl_Position;
+
+void main() {
+#if defined(FRAME)
+    vec3 local = vec3(aPos.xy * iParams.xy, aPos.z) + aOffset;
+    vec3 FragPos = vec3(iModel * vec4(local, 1.0));
+#elif defined(PAINTING)
+    vec3 local = vec3(aPos.xy * iParams.xy, aPos.z);
+    vec3 FragPos = vec3(iModel * vec4(local, 1.0));
+#elif defined(MULTI_DRAW)
+    vec3 FragPos = vec3(dModel * vec4(aPos, 1.0));
+#else
+    vec3 FragPos = vec3(model * vec4(aPos, 1.0));
+#endif
+
+    gl_Position = projection * view * vec4(FragPos, 1.0);
+}
@@ -1,71 +1,22 @@
 #version 330 core
 
-struct Light {
-    vec3 position;
-    vec3 ambient;
-    vec3 diffuse;
-    vec3 specular;
-};
-
-struct DirLight {
-    vec3 direction;
-    vec3 ambient;
-    vec3 diffuse;
-    vec3 specular;
-};
+#include "surface.glsl"
 
 in vec3 FragPos;
 in vec3 Normal;
 in vec2 TexCoords;
+in vec2 LightmapUV;
 
-out vec4 FragColor;
-
-uniform Light light;
-uniform DirLight dirLight;
-uniform vec3 viewPos;
 uniform sampler2D texture1;
-
-vec3 CalcDirLight(DirLight light, vec3 normal, vec3 viewDir, vec3 texColor) {
-    vec3 lightDir = normalize(-light.direction); 
-    float diff = max(dot(normal, lightDir), 0.0);
-    vec3 reflectDir = reflect(-lightDir, normal);
-    float spec = pow(max(dot(viewDir, reflectDir), 0.0), 32.0);
-    
-    vec3 ambient = light.ambient * texColor;
-    vec3 diffuse = light.diffuse * diff * texColor;
-    vec3 specular = light.specular * spec;
-    
-    return ambient + diffuse + specular;
-}
-
-vec3 CalcPointLight(Light light, vec3 normal, vec3 fragPos, vec3 viewDir, vec3 texColor) {
-    vec3 lightDir = normalize(light.position - fragPos); 
-    
-    float diff = max(dot(normal, lightDir), 0.0);
-    
-    vec3 reflectDir = reflect(-lightDir, normal);
-    float spec = pow(max(dot(viewDir, reflectDir), 0.0), 32.0);
-    
-    float distance = length(light.position - fragPos);
-    float attenuation = 1.0 / (1.0 + 0.09 * distance + 0.032 * (distance * distance));
-
-    vec3 ambient = light.ambient * texColor;
-    vec3 diffuse = light.diffuse * diff * texColor;
-    vec3 specular = light.specular * spec;
-    
-    return (ambient + diffuse + specular) * attenuation;
-}
+uniform sampler2D lightmap; // baked irradiance (LightmapBaker)
+uniform int useLightmap;
 
 void main() {
-    vec3 norm = normalize(Normal); 
-    vec3 viewDir = normalize(viewPos - FragPos); 
-    
     vec3 texColor = texture(texture1, TexCoords).rgb;
-    
-    vec3 dirResult = CalcDirLight(dirLight, norm, viewDir, texColor);
-    vec3 pointResult = CalcPointLight(light, norm, FragPos, viewDir, texColor);
-    
-    vec3 result = dirResult + pointResult;
-    
-    FragColor = vec4(result, 1.0);
+
+    if (useLightmap != 0) {
+        WriteLitSurface(texColor * CalcBakedLighting(Normal, FragPos, texture(lightmap, LightmapUV).rgb));
+    } else {
+        WriteSurface(Normal, FragPos, texColor);
+    }
 }
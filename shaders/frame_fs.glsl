@@ -0,0 +1,15 @@
+#version 330 core
+
+#include "surface.glsl"
+
+in vec3 FragPos;
+in vec3 Normal;
+in vec2 TexCoords;
+
+uniform sampler2D frameTexture;
+
+void main() {
+    vec3 texColor = texture(frameTexture, TexCoords).rgb;
+
+    WriteSurface(Normal, FragPos, texColor);
+}
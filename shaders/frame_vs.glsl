@@ -0,0 +1,29 @@
+#version 330 core
+
+layout (location = 0) in vec3 aPos;       // Corner of the unit image quad the vertex hangs off
+layout (location = 1) in vec3 aNormal;    // Vertex normal
+layout (location = 2) in vec2 aTexCoords; // Texture coordinates
+layout (location = 11) in vec3 aOffset;   // Moulding offset from that corner, not scaled by size
+
+// Per-instance attributes (divisor 1), shared with the painting quads
+layout (location = 3) in mat4 iModel;     // Rigid placement: translation and rotation only
+layout (location = 7) in vec4 iParams;    // xy = painting size
+
+out vec3 FragPos;
+out vec3 Normal;
+out vec2 TexCoords;
+
+uniform mat4 view;
+uniform mat4 projection;
+
+// Matches the depth pre-pass (depth_vs.glsl) bit for bit
+invariant gl_Position;
+
+void main() {
+    vec3 local = vec3(aPos.xy * iParams.xy, aPos.z) + aOffset;
+    FragPos = vec3(iModel * vec4(local, 1.0));
+    Normal = mat3(iModel) * aNormal;
+    TexCoords = aTexCoords;
+
+    gl_Position = projection * view * vec4(FragPos, 1.0);
+}
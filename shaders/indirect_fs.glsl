@@ -0,0 +1,22 @@
+#version 430 core
+
+#include "surface.glsl"
+
+in vec3 FragPos;
+in vec3 Normal;
+in vec3 TexCoords;
+in vec2 LightmapUV;
+
+uniform sampler2DArray materials;
+uniform sampler2D lightmap; // baked irradiance (LightmapBaker)
+uniform int useLightmap;
+
+void main() {
+    vec3 texColor = texture(materials, TexCoords).rgb;
+
+    if (useLightmap != 0) {
+        WriteLitSurface(texColor * CalcBakedLighting(Normal, FragPos, texture(lightmap, LightmapUV).rgb));
+    } else {
+        WriteSurface(Normal, FragPos, texColor);
+    }
+}
@@ -0,0 +1,31 @@
+#version 430 core
+
+layout (location = 0) in vec3 aPos;       // Vertex position
+layout (location = 1) in vec3 aNormal;    // Vertex normal
+layout (location = 2) in vec2 aTexCoords; // Texture coordinates
+layout (location = 12) in vec2 aLightmapUV; // Place in the baked lightmap atlas
+
+// Per-draw record, selected by each indirect command's baseInstance
+layout (location = 3) in mat4 dModel;
+layout (location = 7) in vec4 dParams;        // x = material layer
+layout (location = 8) in mat3 dNormalMatrix;
+
+out vec3 FragPos;
+out vec3 Normal;
+out vec3 TexCoords;   // xy = uv, z = layer
+out vec2 LightmapUV;
+
+uniform mat4 view;
+uniform mat4 projection;
+
+// Matches the depth pre-pass (depth_vs.glsl) bit for bit
+invariant gl_Position;
+
+void main() {
+    FragPos = vec3(dModel * vec4(aPos, 1.0));
+    Normal = dNormalMatrix * aNormal;
+    TexCoords = vec3(aTexCoords, dParams.x);
+    LightmapUV = aLightmapUV;
+
+    gl_Position = projection * view * vec4(FragPos, 1.0);
+}
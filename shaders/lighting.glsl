@@ -0,0 +1,177 @@
+// Shared lighting model, pulled into fragment shaders with #include "lighting.glsl"
+
+struct Light {
+    vec3 position;
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+};
+
+struct DirLight {
+    vec3 direction;
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+};
+
+uniform Light light;
+uniform DirLight dirLight;
+uniform vec3 viewPos;
+
+// Clustered spot lights (ClusteredLighting); the grid must match GRID_X/Y/Z there
+const int CLUSTER_X = 16;
+const int CLUSTER_Y = 9;
+const int CLUSTER_Z = 24;
+
+uniform samplerBuffer spotLights;     // 3 texels per light: position + range, direction + cos outer, color + cos inner
+uniform usamplerBuffer clusterGrid;   // per cluster: first entry in clusterLights, light count
+uniform usamplerBuffer clusterLights; // light indices, cluster by cluster
+uniform vec4 clusterTiles;            // xy = clusters per pixel
+uniform vec4 clusterDepth;            // near, far, slice scale, slice bias
+
+// Directional light shadow map (ShadowMap), depth compared in hardware
+uniform sampler2DShadow shadowMap;
+uniform mat4 lightSpace;
+uniform float shadowNormalOffset;     // world size of a shadow texel, times a margin
+uniform int useShadows;
+uniform sampler2DShadow staticShadowMap; // the same map without this frame's dynamic casters
+uniform int useDynamicShadows;
+
+// Baked irradiance probes (ProbeVolume): per channel, L1 spherical harmonics
+// convolved with the cosine lobe, so irradiance = w + dot(xyz, normal). The
+// red, green and blue probes are three blocks of slices along z.
+uniform sampler3D probeVolume;
+uniform vec3 probeOrigin;   // world position of the first probe
+uniform vec3 probeScale;    // probes per world unit
+uniform vec3 probeCounts;
+uniform int useProbes;
+
+// 3x3 PCF in a shadow map at light-space coords
+float SampleShadow(sampler2DShadow map, vec3 coords) {
+    vec2 texel = 1.0 / vec2(textureSize(map, 0));
+    float lit = 0.0;
+    for (int y = -1; y <= 1; ++y) {
+        for (int x = -1; x <= 1; ++x) {
+            lit += texture(map, vec3(coords.xy + vec2(x, y) * texel, coords.z));
+        }
+    }
+    return lit / 9.0;
+}
+
+// Light-space lookup for fragPos, pushed out along the normal so lit surfaces clear their own depth
+vec3 ShadowCoords(vec3 normal, vec3 fragPos) {
+    vec4 lightPos = lightSpace * vec4(fragPos + normal * shadowNormalOffset, 1.0);
+    return lightPos.xyz / lightPos.w * 0.5 + 0.5;
+}
+
+// Fraction of the directional light reaching fragPos
+float CalcShadow(vec3 normal, vec3 fragPos) {
+    if (useShadows == 0) return 1.0;
+    vec3 coords = ShadowCoords(normal, fragPos);
+    if (coords.z > 1.0) return 1.0;
+    return SampleShadow(shadowMap, coords);
+}
+
+// Light arriving from everywhere but the direct lights: the probes around
+// fragPos, blended trilinearly, or the directional light's flat ambient
+vec3 CalcAmbient(vec3 normal, vec3 fragPos) {
+    if (useProbes == 0) return dirLight.ambient;
+    vec3 cell = clamp((fragPos - probeOrigin) * probeScale, vec3(0.0), probeCounts - 1.0);
+    vec3 uvw = (cell + 0.5) / vec3(probeCounts.xy, probeCounts.z * 3.0);
+    vec4 n = vec4(normal, 1.0);
+    float red = dot(texture(probeVolume, uvw), n);
+    float green = dot(texture(probeVolume, uvw + vec3(0.0, 0.0, 1.0 / 3.0)), n);
+    float blue = dot(texture(probeVolume, uvw + vec3(0.0, 0.0, 2.0 / 3.0)), n);
+    return max(vec3(red, green, blue), vec3(0.0));
+}
+
+// Irradiance of a lightmapped surface: the baked value, less the sunlight
+// that dynamic casters block this frame (static shadows are in the bake)
+vec3 CalcBakedLighting(vec3 normal, vec3 fragPos, vec3 baked) {
+    if (useShadows == 0 || useDynamicShadows == 0) return baked;
+    vec3 norm = normalize(normal);
+    vec3 coords = ShadowCoords(norm, fragPos);
+    if (coords.z > 1.0) return baked;
+    float blocked = max(SampleShadow(staticShadowMap, coords) - SampleShadow(shadowMap, coords), 0.0);
+    float diff = max(dot(norm, normalize(-dirLight.direction)), 0.0);
+    return max(baked - dirLight.diffuse * diff * blocked, vec3(0.0));
+}
+
+vec3 CalcDirLight(DirLight light, vec3 normal, vec3 viewDir, vec3 texColor, float shadow) {
+    vec3 lightDir = normalize(-light.direction); 
+    float diff = max(dot(normal, lightDir), 0.0);
+    vec3 reflectDir = reflect(-lightDir, normal);
+    float spec = pow(max(dot(viewDir, reflectDir), 0.0), 32.0);
+    
+    vec3 diffuse = light.diffuse * diff * texColor;
+    vec3 specular = light.specular * spec;
+    
+    return (diffuse + specular) * shadow;
+}
+
+vec3 CalcPointLight(Light light, vec3 normal, vec3 fragPos, vec3 viewDir, vec3 texColor) {
+    vec3 lightDir = normalize(light.position - fragPos); 
+    
+    float diff = max(dot(normal, lightDir), 0.0);
+    
+    vec3 reflectDir = reflect(-lightDir, normal);
+    float spec = pow(max(dot(viewDir, reflectDir), 0.0), 32.0);
+    
+    float distance = length(light.position - fragPos);
+    float attenuation = 1.0 / (1.0 + 0.09 * distance + 0.032 * (distance * distance));
+
+    vec3 ambient = light.ambient * texColor;
+    vec3 diffuse = light.diffuse * diff * texColor;
+    vec3 specular = light.specular * spec;
+    
+    return (ambient + diffuse + specular) * attenuation;
+}
+
+// Sum of the spot lights binned into the cluster at window position
+// windowPos (pixel xy, depth-buffer z)
+vec3 CalcSpotLights(vec3 normal, vec3 fragPos, vec3 viewDir, vec3 texColor, vec3 windowPos) {
+    float near = clusterDepth.x;
+    float far = clusterDepth.y;
+    float depth = near * far / (far - windowPos.z * (far - near));
+    int slice = clamp(int(floor(log(depth) * clusterDepth.z - clusterDepth.w)), 0, CLUSTER_Z - 1);
+    ivec2 tile = clamp(ivec2(windowPos.xy * clusterTiles.xy), ivec2(0), ivec2(CLUSTER_X - 1, CLUSTER_Y - 1));
+    uvec2 cluster = texelFetch(clusterGrid, (slice * CLUSTER_Y + tile.y) * CLUSTER_X + tile.x).xy;
+
+    vec3 result = vec3(0.0);
+    for (uint i = 0u; i < cluster.y; ++i) {
+        int index = int(texelFetch(clusterLights, int(cluster.x + i)).r) * 3;
+        vec4 positionRange = texelFetch(spotLights, index);
+        vec4 directionOuter = texelFetch(spotLights, index + 1);
+        vec4 colorInner = texelFetch(spotLights, index + 2);
+
+        vec3 toLight = positionRange.xyz - fragPos;
+        float distance = length(toLight);
+        vec3 lightDir = toLight / distance;
+        float falloff = clamp(1.0 - (distance * distance) / (positionRange.w * positionRange.w), 0.0, 1.0);
+        float cone = smoothstep(directionOuter.w, colorInner.w, dot(-lightDir, directionOuter.xyz));
+
+        float diff = max(dot(normal, lightDir), 0.0);
+        vec3 reflectDir = reflect(-lightDir, normal);
+        float spec = diff > 0.0 ? pow(max(dot(viewDir, reflectDir), 0.0), 32.0) : 0.0;
+        result += colorInner.rgb * (diff * texColor + 0.3 * spec) * (falloff * falloff * cone);
+    }
+    return result;
+}
+
+// Directional, point and clustered spot lights for a surface point seen at windowPos
+vec3 CalcLightingAt(vec3 normal, vec3 fragPos, vec3 texColor, vec3 windowPos) {
+    vec3 norm = normalize(normal); 
+    vec3 viewDir = normalize(viewPos - fragPos); 
+    
+    vec3 ambient = CalcAmbient(norm, fragPos) * texColor;
+    vec3 dirResult = CalcDirLight(dirLight, norm, viewDir, texColor, CalcShadow(norm, fragPos));
+    vec3 pointResult = CalcPointLight(light, norm, fragPos, viewDir, texColor);
+    vec3 spotResult = CalcSpotLights(norm, fragPos, viewDir, texColor, windowPos);
+    
+    return ambient + dirResult + pointResult + spotResult;
+}
+
+// Lighting for the fragment being shaded
+vec3 CalcLighting(vec3 normal, vec3 fragPos, vec3 texColor) {
+    return CalcLightingAt(normal, fragPos, texColor, gl_FragCoord.xyz);
+}
@@ -0,0 +1,7 @@
+// Per-object transform. RenderQueue writes one per draw into the frame's
+// region of a uniform ring buffer and binds it by offset (std140 layout:
+// the mat3 takes three vec4 columns, 112 bytes in all).
+layout (std140) uniform Object {
+    mat4 model;        // Model transformation matrix
+    mat3 normalMatrix; // Inverse transpose of model's upper 3x3, computed on the CPU
+};
@@ -0,0 +1,15 @@
+#version 330 core
+
+#include "surface.glsl"
+
+in vec3 FragPos;
+in vec3 Normal;
+in vec3 TexCoords;
+
+uniform sampler2DArray paintings;
+
+void main() {
+    vec3 texColor = texture(paintings, TexCoords).rgb;
+
+    WriteSurface(Normal, FragPos, texColor);
+}
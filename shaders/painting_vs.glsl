@@ -0,0 +1,29 @@
+#version 330 core
+
+layout (location = 0) in vec3 aPos;       // Unit quad position
+layout (location = 1) in vec3 aNormal;    // Vertex normal
+layout (location = 2) in vec2 aTexCoords; // Texture coordinates
+
+// Per-instance attributes (divisor 1)
+layout (location = 3) in mat4 iModel;     // Rigid placement: translation and rotation only
+layout (location = 7) in vec4 iParams;    // xy = painting size, z = texture array layer
+
+out vec3 FragPos;
+out vec3 Normal;
+out vec3 TexCoords;   // xy = uv, z = layer
+
+uniform mat4 view;
+uniform mat4 projection;
+
+// Matches the depth pre-pass (depth_vs.glsl) bit for bit
+invariant gl_Position;
+
+void main() {
+    // Size is applied here so iModel stays rigid and mat3(iModel) is already the normal matrix
+    vec3 local = vec3(aPos.xy * iParams.xy, aPos.z);
+    FragPos = vec3(iModel * vec4(local, 1.0));
+    Normal = mat3(iModel) * aNormal;
+    TexCoords = vec3(aTexCoords, iParams.z);
+
+    gl_Position = projection * view * vec4(FragPos, 1.0);
+}
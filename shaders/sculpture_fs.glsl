@@ -0,0 +1,16 @@
+#version 330 core
+
+#include "surface.glsl"
+
+in vec3 FragPos;
+in vec3 Normal;
+in vec2 TexCoords;
+
+uniform sampler2D texture1;
+
+// Moving objects never use the lightmap; their ambient comes from the probe volume
+void main() {
+    vec3 texColor = texture(texture1, TexCoords).rgb;
+
+    WriteSurface(Normal, FragPos, texColor);
+}
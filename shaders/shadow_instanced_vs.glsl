@@ -0,0 +1,14 @@
+#version 330 core
+
+// Same layout as painting_vs / frame_vs; quads leave aOffset at its default of zero
+layout (location = 0) in vec3 aPos;
+layout (location = 11) in vec3 aOffset;
+layout (location = 3) in mat4 iModel;
+layout (location = 7) in vec4 iParams;   // xy = painting size
+
+uniform mat4 lightSpace;
+
+void main() {
+    vec3 local = vec3(aPos.xy * iParams.xy, aPos.z) + aOffset;
+    gl_Position = lightSpace * iModel * vec4(local, 1.0);
+}
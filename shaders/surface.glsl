@@ -0,0 +1,36 @@
+// Output stage of the lit surface shaders. Forward shading lights the
+// fragment here; built with GBUFFER defined, the same shaders instead
+// write the G-buffer for DeferredRenderer to light in one full-screen pass.
+// WriteLitSurface takes a color already lit, such as from a lightmap.
+
+#include "lighting.glsl"
+
+#ifdef GBUFFER
+
+layout (location = 0) out vec4 GAlbedo;  // sRGB target
+layout (location = 1) out vec4 GNormal;  // world-space normal * 0.5 + 0.5
+
+void WriteSurface(vec3 normal, vec3 fragPos, vec3 albedo) {
+    GAlbedo = vec4(albedo, 1.0);
+    GNormal = vec4(normalize(normal) * 0.5 + 0.5, 1.0);
+}
+
+// Normal alpha 0 tells the lighting pass to pass the color through
+void WriteLitSurface(vec3 color) {
+    GAlbedo = vec4(color, 1.0);
+    GNormal = vec4(0.5, 0.5, 0.5, 0.0);
+}
+
+#else
+
+out vec4 FragColor;
+
+void WriteSurface(vec3 normal, vec3 fragPos, vec3 albedo) {
+    FragColor = vec4(CalcLighting(normal, fragPos, albedo), 1.0);
+}
+
+void WriteLitSurface(vec3 color) {
+    FragColor = vec4(color, 1.0);
+}
+
+#endif
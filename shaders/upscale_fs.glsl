@@ -0,0 +1,31 @@
+#version 330 core
+
+// Bilinear upscale of the offscreen scene with a light unsharp mask. The
+// sharpened value is clamped to the neighbourhood it came from, so edges
+// gain contrast without ringing.
+
+out vec4 FragColor;
+
+uniform sampler2D scene;
+uniform vec2 outputSize; // window pixels
+uniform float sharpness; // 0 is a plain bilinear copy
+
+void main() {
+    vec2 uv = gl_FragCoord.xy / outputSize;
+    vec3 center = texture(scene, uv).rgb;
+    if (sharpness <= 0.0) {
+        FragColor = vec4(center, 1.0);
+        return;
+    }
+
+    vec2 texel = 1.0 / vec2(textureSize(scene, 0));
+    vec3 left = texture(scene, uv - vec2(texel.x, 0.0)).rgb;
+    vec3 right = texture(scene, uv + vec2(texel.x, 0.0)).rgb;
+    vec3 down = texture(scene, uv - vec2(0.0, texel.y)).rgb;
+    vec3 up = texture(scene, uv + vec2(0.0, texel.y)).rgb;
+
+    vec3 lo = min(center, min(min(left, right), min(down, up)));
+    vec3 hi = max(center, max(max(left, right), max(down, up)));
+    vec3 sharpened = center + sharpness * (center - 0.25 * (left + right + down + up));
+    FragColor = vec4(clamp(sharpened, lo, hi), 1.0);
+}
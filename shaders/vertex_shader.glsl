@@ -3,24 +3,30 @@
 layout (location = 0) in vec3 aPos;       // Vertex position
 layout (location = 1) in vec3 aNormal;    // Vertex normal
 layout (location = 2) in vec2 aTexCoords; // Texture coordinates
+layout (location = 12) in vec2 aLightmapUV; // Place in the baked lightmap atlas
 
 out vec3 FragPos;      // Position of the fragment in world space
 out vec3 Normal;       // Normal vector in world space
 out vec2 TexCoords;    // Texture coordinates passed to the fragment shader
+out vec2 LightmapUV;
 
-uniform mat4 model;      // Model transformation matrix
+#include "object_block.glsl"
 uniform mat4 view;       // View transformation matrix
 uniform mat4 projection; // Projection transformation matrix
 
+// Matches the depth pre-pass (depth_vs.glsl) bit for bit
+invariant gl_Position;
+
 void main() {
     // Transform vertex position to world space
     FragPos = vec3(model * vec4(aPos, 1.0));
 
-    // Transform normal to world space using inverse transpose of the model matrix
-    Normal = mat3(transpose(inverse(model))) * aNormal;
+    // Transform normal to world space using the precomputed normal matrix
+    Normal = normalMatrix * aNormal;
 
     // Pass the texture coordinates to the fragment shader
     TexCoords = aTexCoords;
+    LightmapUV = aLightmapUV;
 
     // Apply the view and projection transformations to the vertex position
     gl_Position = projection * view * vec4(FragPos, 1.0);
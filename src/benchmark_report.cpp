@@ -0,0 +1,111 @@
+#include "benchmark_report.h"
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <sys/resource.h>
+
+BenchmarkReport::BenchmarkReport()
+    : lastMark(Clock::now()), width(0), height(0), startupBufferBytes(0), startupTextureBytes(0) {}
+
+void BenchmarkReport::markPhase(const char* name) {
+    Clock::time_point now = Clock::now();
+    Phase phase;
+    phase.name = name;
+    phase.ms = std::chrono::duration<float, std::milli>(now - lastMark).count();
+    phases.push_back(phase);
+    lastMark = now;
+}
+
+void BenchmarkReport::setTarget(const char* renderer, int targetWidth, int targetHeight) {
+    rendererName = renderer ? renderer : "unknown";
+    width = targetWidth;
+    height = targetHeight;
+}
+
+void BenchmarkReport::addFrame(float frameMs, const FrameWork& work) {
+    frameTimes.push_back(frameMs);
+    frames.push_back(work);
+}
+
+void BenchmarkReport::setStartupUploads(unsigned long long bufferBytes, unsigned long long textureBytes) {
+    startupBufferBytes = bufferBytes;
+    startupTextureBytes = textureBytes;
+}
+
+// Peak resident set of the process so far, in kilobytes
+static long peakResidentKb() {
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+#ifdef __APPLE__
+    return usage.ru_maxrss / 1024; // bytes on macOS
+#else
+    return usage.ru_maxrss;
+#endif
+}
+
+float BenchmarkReport::framePercentile(float p) const {
+    if (frameTimes.empty()) return 0.0f;
+    std::vector<float> sorted(frameTimes);
+    std::sort(sorted.begin(), sorted.end());
+    size_t rank = (size_t)std::ceil(p / 100.0f * sorted.size());
+    return sorted[std::min(std::max<size_t>(rank, 1), sorted.size()) - 1];
+}
+
+static void writeString(std::ostream& out, const std::string& text) {
+    out << '"';
+    for (size_t i = 0; i < text.size(); ++i) {
+        if (text[i] == '"' || text[i] == '\\') out << '\\';
+        if ((unsigned char)text[i] >= 0x20) out << text[i];
+    }
+    out << '"';
+}
+
+void BenchmarkReport::writeJson(std::ostream& out) const {
+    std::ios::fmtflags flags = out.flags();
+    std::streamsize precision = out.precision();
+    out << std::fixed << std::setprecision(3);
+
+    out << "{\n  \"renderer\": ";
+    writeString(out, rendererName);
+    out << ",\n  \"width\": " << width << ",\n  \"height\": " << height
+        << ",\n  \"frames\": " << frameTimes.size() << ",\n";
+
+    float startupMs = 0.0f;
+    out << "  \"startup_ms\": {";
+    for (size_t i = 0; i < phases.size(); ++i) {
+        out << (i ? ", " : "") << '"' << phases[i].name << "\": " << phases[i].ms;
+        startupMs += phases[i].ms;
+    }
+    out << (phases.empty() ? "" : ", ") << "\"total\": " << startupMs << "},\n";
+
+    double totalMs = 0.0;
+    for (size_t i = 0; i < frameTimes.size(); ++i) totalMs += frameTimes[i];
+    float meanMs = frameTimes.empty() ? 0.0f : (float)(totalMs / frameTimes.size());
+    out << "  \"frame_ms\": {\"mean\": " << meanMs << ", \"min\": " << framePercentile(0.0f)
+        << ", \"p50\": " << framePercentile(50.0f) << ", \"p90\": " << framePercentile(90.0f)
+        << ", \"p95\": " << framePercentile(95.0f) << ", \"p99\": " << framePercentile(99.0f)
+        << ", \"max\": " << framePercentile(100.0f) << "},\n";
+
+    // Each counter's min, mean and max over the counted frames
+    out << "  \"work\": {";
+    for (int c = 0; c < FrameWork::COUNTER_COUNT; ++c) {
+        FrameWork::Counter counter = (FrameWork::Counter)c;
+        unsigned long long low = 0, high = 0;
+        double sum = 0.0;
+        for (size_t i = 0; i < frames.size(); ++i) {
+            unsigned long long value = frames[i][counter];
+            low = i ? std::min(low, value) : value;
+            high = std::max(high, value);
+            sum += (double)value;
+        }
+        out << (c ? ",\n            " : "") << '"' << FrameWork::name(counter) << "\": {\"min\": " << low
+            << ", \"mean\": " << (frames.empty() ? 0.0 : sum / frames.size()) << ", \"max\": " << high << "}";
+    }
+    out << "},\n";
+
+    out << "  \"memory_kb\": {\"peak_rss\": " << peakResidentKb() << ", \"startup_buffers\": "
+        << startupBufferBytes / 1024 << ", \"startup_textures\": " << startupTextureBytes / 1024 << "}\n}" << std::endl;
+
+    out.flags(flags);
+    out.precision(precision);
+}
@@ -0,0 +1,358 @@
+#include "bvh.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE__) || defined(_M_X64)
+#include <xmmintrin.h>
+#define BVH_SSE 1
+#endif
+
+namespace {
+
+// Four floats with SSE when the target has it, plain arrays otherwise.
+// Comparisons return all-ones/all-zero lanes, as SSE does.
+struct Float4 {
+#ifdef BVH_SSE
+    __m128 v;
+    Float4() {}
+    Float4(__m128 value) : v(value) {}
+    explicit Float4(float s) : v(_mm_set1_ps(s)) {}
+    static Float4 load(const float* p) { return Float4(_mm_load_ps(p)); }
+    void store(float* p) const { _mm_store_ps(p, v); }
+    friend Float4 operator+(Float4 a, Float4 b) { return _mm_add_ps(a.v, b.v); }
+    friend Float4 operator-(Float4 a, Float4 b) { return _mm_sub_ps(a.v, b.v); }
+    friend Float4 operator*(Float4 a, Float4 b) { return _mm_mul_ps(a.v, b.v); }
+    friend Float4 operator&(Float4 a, Float4 b) { return _mm_and_ps(a.v, b.v); }
+    friend Float4 operator|(Float4 a, Float4 b) { return _mm_or_ps(a.v, b.v); }
+    friend Float4 operator<(Float4 a, Float4 b) { return _mm_cmplt_ps(a.v, b.v); }
+    friend Float4 operator<=(Float4 a, Float4 b) { return _mm_cmple_ps(a.v, b.v); }
+    friend Float4 operator>(Float4 a, Float4 b) { return _mm_cmpgt_ps(a.v, b.v); }
+    friend Float4 operator>=(Float4 a, Float4 b) { return _mm_cmpge_ps(a.v, b.v); }
+    friend Float4 min(Float4 a, Float4 b) { return _mm_min_ps(a.v, b.v); }
+    friend Float4 max(Float4 a, Float4 b) { return _mm_max_ps(a.v, b.v); }
+    friend Float4 reciprocal(Float4 a) { return _mm_div_ps(_mm_set1_ps(1.0f), a.v); }
+    friend Float4 abs(Float4 a) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a.v); }
+    friend Float4 select(Float4 m, Float4 a, Float4 b) { return _mm_or_ps(_mm_and_ps(m.v, a.v), _mm_andnot_ps(m.v, b.v)); }
+    friend int bits(Float4 m) { return _mm_movemask_ps(m.v); }
+#else
+    float v[4];
+    Float4() {}
+    explicit Float4(float s) { v[0] = v[1] = v[2] = v[3] = s; }
+    static Float4 load(const float* p) { Float4 r; std::memcpy(r.v, p, sizeof(r.v)); return r; }
+    void store(float* p) const { std::memcpy(p, v, sizeof(v)); }
+    template <typename F> static Float4 map(Float4 a, Float4 b, F f) {
+        Float4 r;
+        for (int i = 0; i < 4; ++i) r.v[i] = f(a.v[i], b.v[i]);
+        return r;
+    }
+    static float maskOf(bool b) { uint32_t u = b ? ~0u : 0u; float f; std::memcpy(&f, &u, 4); return f; }
+    static uint32_t bitsOf(float f) { uint32_t u; std::memcpy(&u, &f, 4); return u; }
+    static float fromBits(uint32_t u) { float f; std::memcpy(&f, &u, 4); return f; }
+    friend Float4 operator+(Float4 a, Float4 b) { return map(a, b, [](float x, float y) { return x + y; }); }
+    friend Float4 operator-(Float4 a, Float4 b) { return map(a, b, [](float x, float y) { return x - y; }); }
+    friend Float4 operator*(Float4 a, Float4 b) { return map(a, b, [](float x, float y) { return x * y; }); }
+    friend Float4 operator&(Float4 a, Float4 b) { return map(a, b, [](float x, float y) { return fromBits(bitsOf(x) & bitsOf(y)); }); }
+    friend Float4 operator|(Float4 a, Float4 b) { return map(a, b, [](float x, float y) { return fromBits(bitsOf(x) | bitsOf(y)); }); }
+    friend Float4 operator<(Float4 a, Float4 b) { return map(a, b, [](float x, float y) { return maskOf(x < y); }); }
+    friend Float4 operator<=(Float4 a, Float4 b) { return map(a, b, [](float x, float y) { return maskOf(x <= y); }); }
+    friend Float4 operator>(Float4 a, Float4 b) { return map(a, b, [](float x, float y) { return maskOf(x > y); }); }
+    friend Float4 operator>=(Float4 a, Float4 b) { return map(a, b, [](float x, float y) { return maskOf(x >= y); }); }
+    friend Float4 min(Float4 a, Float4 b) { return map(a, b, [](float x, float y) { return y < x ? y : x; }); }
+    friend Float4 max(Float4 a, Float4 b) { return map(a, b, [](float x, float y) { return y > x ? y : x; }); }
+    friend Float4 reciprocal(Float4 a) { return map(a, a, [](float x, float) { return 1.0f / x; }); }
+    friend Float4 abs(Float4 a) { return map(a, a, [](float x, float) { return std::fabs(x); }); }
+    friend Float4 select(Float4 m, Float4 a, Float4 b) { return (m & a) | map(m, b, [](float x, float y) { return fromBits(~bitsOf(x) & bitsOf(y)); }); }
+    friend int bits(Float4 m) {
+        int r = 0;
+        for (int i = 0; i < 4; ++i) r |= (bitsOf(m.v[i]) >> 31) << i;
+        return r;
+    }
+#endif
+};
+
+struct Vec4x3 {
+    Float4 x, y, z;
+};
+
+inline Float4 dot(const Vec4x3& a, const Vec4x3& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+
+inline Vec4x3 cross(const Vec4x3& a, const Vec4x3& b) {
+    Vec4x3 r;
+    r.x = a.y * b.z - a.z * b.y;
+    r.y = a.z * b.x - a.x * b.z;
+    r.z = a.x * b.y - a.y * b.x;
+    return r;
+}
+
+inline Vec4x3 broadcast(const glm::vec3& v) {
+    Vec4x3 r;
+    r.x = Float4(v.x);
+    r.y = Float4(v.y);
+    r.z = Float4(v.z);
+    return r;
+}
+
+inline Float4 laneMask(int active) {
+    static const float ON[16][4] = {
+#define L(i) ((i) & 1 ? -1.0f : 0.0f), ((i) & 2 ? -1.0f : 0.0f), ((i) & 4 ? -1.0f : 0.0f), ((i) & 8 ? -1.0f : 0.0f)
+        { L(0) }, { L(1) }, { L(2) }, { L(3) }, { L(4) }, { L(5) }, { L(6) }, { L(7) },
+        { L(8) }, { L(9) }, { L(10) }, { L(11) }, { L(12) }, { L(13) }, { L(14) }, { L(15) }
+#undef L
+    };
+    // Sign bit only; compared against zero below to widen it to a full lane mask
+    return Float4::load(ON[active & 15]) < Float4(0.0f);
+}
+
+const int SAH_BINS = 12;
+const int LEAF_SIZE = 4;
+const float TRAVERSAL_COST = 1.0f;
+const float TRIANGLE_COST = 1.0f;
+
+float surfaceArea(const glm::vec3& lo, const glm::vec3& hi) {
+    glm::vec3 d = glm::max(hi - lo, glm::vec3(0.0f));
+    return 2.0f * (d.x * d.y + d.y * d.z + d.z * d.x);
+}
+
+} // namespace
+
+void RayPacket::setRay(int lane, const glm::vec3& origin, const glm::vec3& direction, float length) {
+    originX[lane] = origin.x;
+    originY[lane] = origin.y;
+    originZ[lane] = origin.z;
+    // Exact zeros would turn slab tests into 0 * inf
+    directionX[lane] = std::fabs(direction.x) > 1e-8f ? direction.x : 1e-8f;
+    directionY[lane] = std::fabs(direction.y) > 1e-8f ? direction.y : 1e-8f;
+    directionZ[lane] = std::fabs(direction.z) > 1e-8f ? direction.z : 1e-8f;
+    tMax[lane] = length;
+    triangle[lane] = -1;
+    active |= 1 << lane;
+}
+
+void TriangleBVH::build(const std::vector<BVHTriangle>& triangles) {
+    nodes.clear();
+    packed.clear();
+    order.clear();
+    if (triangles.empty()) return;
+
+    std::vector<BuildItem> items(triangles.size());
+    for (size_t i = 0; i < triangles.size(); ++i) {
+        const BVHTriangle& t = triangles[i];
+        items[i].boundsMin = glm::min(t.v0, glm::min(t.v1, t.v2));
+        items[i].boundsMax = glm::max(t.v0, glm::max(t.v1, t.v2));
+        items[i].centroid = (items[i].boundsMin + items[i].boundsMax) * 0.5f;
+        items[i].index = (uint32_t)i;
+    }
+    nodes.reserve(2 * triangles.size());
+    buildNode(items, 0, items.size());
+
+    packed.resize(items.size());
+    order.resize(items.size());
+    for (size_t i = 0; i < items.size(); ++i) {
+        const BVHTriangle& t = triangles[items[i].index];
+        packed[i].v0 = t.v0;
+        packed[i].edge1 = t.v1 - t.v0;
+        packed[i].edge2 = t.v2 - t.v0;
+        packed[i].mask = t.mask;
+        order[i] = items[i].index;
+    }
+}
+
+uint32_t TriangleBVH::buildNode(std::vector<BuildItem>& items, size_t begin, size_t end) {
+    uint32_t index = (uint32_t)nodes.size();
+    nodes.push_back(Node());
+    glm::vec3 lo(1e30f), hi(-1e30f), centroidLo(1e30f), centroidHi(-1e30f);
+    for (size_t i = begin; i < end; ++i) {
+        lo = glm::min(lo, items[i].boundsMin);
+        hi = glm::max(hi, items[i].boundsMax);
+        centroidLo = glm::min(centroidLo, items[i].centroid);
+        centroidHi = glm::max(centroidHi, items[i].centroid);
+    }
+    nodes[index].boundsMin = lo;
+    nodes[index].boundsMax = hi;
+    nodes[index].offset = (uint32_t)begin;
+    nodes[index].count = (uint16_t)(end - begin);
+    nodes[index].axis = 0;
+
+    size_t count = end - begin;
+    if (count <= (size_t)LEAF_SIZE) return index;
+
+    // Bin centroids along each axis and keep the cheapest split by surface area
+    float bestCost = TRIANGLE_COST * count;
+    int bestAxis = -1, bestSplit = 0;
+    for (int axis = 0; axis < 3; ++axis) {
+        float extent = centroidHi[axis] - centroidLo[axis];
+        if (extent <= 0.0f) continue;
+        float scale = SAH_BINS / extent;
+
+        glm::vec3 binLo[SAH_BINS], binHi[SAH_BINS];
+        int binCount[SAH_BINS];
+        for (int b = 0; b < SAH_BINS; ++b) {
+            binLo[b] = glm::vec3(1e30f);
+            binHi[b] = glm::vec3(-1e30f);
+            binCount[b] = 0;
+        }
+        for (size_t i = begin; i < end; ++i) {
+            int b = std::min(SAH_BINS - 1, (int)((items[i].centroid[axis] - centroidLo[axis]) * scale));
+            binLo[b] = glm::min(binLo[b], items[i].boundsMin);
+            binHi[b] = glm::max(binHi[b], items[i].boundsMax);
+            binCount[b]++;
+        }
+
+        // Sweep from the right for the area and count of every suffix
+        float rightArea[SAH_BINS];
+        int rightCount[SAH_BINS];
+        glm::vec3 accLo(1e30f), accHi(-1e30f);
+        int acc = 0;
+        for (int b = SAH_BINS - 1; b > 0; --b) {
+            accLo = glm::min(accLo, binLo[b]);
+            accHi = glm::max(accHi, binHi[b]);
+            acc += binCount[b];
+            rightArea[b] = surfaceArea(accLo, accHi);
+            rightCount[b] = acc;
+        }
+        accLo = glm::vec3(1e30f);
+        accHi = glm::vec3(-1e30f);
+        acc = 0;
+        float parentArea = surfaceArea(lo, hi);
+        for (int b = 0; b < SAH_BINS - 1; ++b) {
+            accLo = glm::min(accLo, binLo[b]);
+            accHi = glm::max(accHi, binHi[b]);
+            acc += binCount[b];
+            if (acc == 0 || rightCount[b + 1] == 0) continue;
+            float cost = TRAVERSAL_COST + TRIANGLE_COST *
+                         (surfaceArea(accLo, accHi) * acc + rightArea[b + 1] * rightCount[b + 1]) / parentArea;
+            if (cost < bestCost) {
+                bestCost = cost;
+                bestAxis = axis;
+                bestSplit = b + 1;
+            }
+        }
+    }
+
+    size_t middle;
+    if (bestAxis >= 0) {
+        float scale = SAH_BINS / (centroidHi[bestAxis] - centroidLo[bestAxis]);
+        float lowest = centroidLo[bestAxis];
+        middle = std::partition(items.begin() + begin, items.begin() + end, [=](const BuildItem& item) {
+            return std::min(SAH_BINS - 1, (int)((item.centroid[bestAxis] - lowest) * scale)) < bestSplit;
+        }) - items.begin();
+    } else if (count <= 0xFFFF) {
+        return index; // nothing worth splitting: keep one larger leaf
+    } else {
+        // Identical centroids but too many for a leaf: split down the middle
+        bestAxis = 0;
+        middle = begin + count / 2;
+    }
+
+    nodes[index].count = 0;
+    nodes[index].axis = (uint16_t)bestAxis;
+    buildNode(items, begin, middle);
+    uint32_t right = buildNode(items, middle, end);
+    nodes[index].offset = right;
+    return index;
+}
+
+template <bool ANY_HIT>
+int TriangleBVH::trace(RayPacket& packet) const {
+    if (nodes.empty() || packet.active == 0) return 0;
+
+    Vec4x3 origin, direction, inverse;
+    origin.x = Float4::load(packet.originX);
+    origin.y = Float4::load(packet.originY);
+    origin.z = Float4::load(packet.originZ);
+    direction.x = Float4::load(packet.directionX);
+    direction.y = Float4::load(packet.directionY);
+    direction.z = Float4::load(packet.directionZ);
+    inverse.x = reciprocal(direction.x);
+    inverse.y = reciprocal(direction.y);
+    inverse.z = reciprocal(direction.z);
+    Float4 tMax = Float4::load(packet.tMax);
+    Float4 active = laneMask(packet.active);
+    alignas(16) float hitTriangle[4] = { -1.0f, -1.0f, -1.0f, -1.0f };
+    Float4 triangle = Float4::load(hitTriangle);
+    int hits = 0;
+
+    // Near child first, by the direction of the first active ray
+    int lead = 0;
+    while (!(packet.active & (1 << lead))) ++lead;
+    float leadDirection[3] = { packet.directionX[lead], packet.directionY[lead], packet.directionZ[lead] };
+
+    const Float4 zero(0.0f), one(1.0f), epsilon(1e-7f), minDistance(1e-4f);
+    uint32_t stack[64];
+    int top = 0;
+    stack[top++] = 0;
+    while (top > 0) {
+        const Node& node = nodes[stack[--top]];
+
+        Float4 t0x = (Float4(node.boundsMin.x) - origin.x) * inverse.x, t1x = (Float4(node.boundsMax.x) - origin.x) * inverse.x;
+        Float4 t0y = (Float4(node.boundsMin.y) - origin.y) * inverse.y, t1y = (Float4(node.boundsMax.y) - origin.y) * inverse.y;
+        Float4 t0z = (Float4(node.boundsMin.z) - origin.z) * inverse.z, t1z = (Float4(node.boundsMax.z) - origin.z) * inverse.z;
+        Float4 tNear = max(max(min(t0x, t1x), min(t0y, t1y)), max(min(t0z, t1z), zero));
+        Float4 tFar = min(min(max(t0x, t1x), max(t0y, t1y)), min(max(t0z, t1z), tMax));
+        if (bits((tNear <= tFar) & active) == 0) continue;
+
+        if (node.count == 0) {
+            uint32_t left = (uint32_t)(&node - &nodes[0]) + 1;
+            if (leadDirection[node.axis] > 0.0f) {
+                stack[top++] = node.offset;
+                stack[top++] = left;
+            } else {
+                stack[top++] = left;
+                stack[top++] = node.offset;
+            }
+            continue;
+        }
+
+        for (uint32_t i = node.offset; i < node.offset + node.count; ++i) {
+            const PackedTriangle& tri = packed[i];
+            if (!(tri.mask & packet.mask)) continue;
+
+            Vec4x3 edge1 = broadcast(tri.edge1), edge2 = broadcast(tri.edge2);
+            Vec4x3 p = cross(direction, edge2);
+            Float4 det = dot(edge1, p);
+            Float4 inverseDet = reciprocal(det);
+            Vec4x3 v0 = broadcast(tri.v0);
+            Vec4x3 s;
+            s.x = origin.x - v0.x;
+            s.y = origin.y - v0.y;
+            s.z = origin.z - v0.z;
+            Float4 u = dot(s, p) * inverseDet;
+            Vec4x3 q = cross(s, edge1);
+            Float4 v = dot(direction, q) * inverseDet;
+            Float4 t = dot(edge2, q) * inverseDet;
+            Float4 hit = active & (abs(det) > epsilon) & (u >= zero) & (v >= zero) & (u + v <= one)
+                       & (t > minDistance) & (t < tMax);
+            int hitBits = bits(hit);
+            if (hitBits == 0) continue;
+
+            if (ANY_HIT) {
+                hits |= hitBits;
+                active = laneMask(packet.active & ~hits);
+                if ((packet.active & ~hits) == 0) return hits;
+                continue;
+            }
+            tMax = select(hit, t, tMax);
+            triangle = select(hit, Float4((float)i), triangle);
+            hits |= hitBits;
+        }
+    }
+
+    if (!ANY_HIT) {
+        tMax.store(packet.tMax);
+        triangle.store(hitTriangle);
+        for (int lane = 0; lane < 4; ++lane) {
+            packet.triangle[lane] = hitTriangle[lane] >= 0.0f ? (int)order[(uint32_t)hitTriangle[lane]] : -1;
+        }
+    }
+    return hits;
+}
+
+void TriangleBVH::intersect(RayPacket& packet) const {
+    trace<false>(packet);
+}
+
+int TriangleBVH::occluded(const RayPacket& packet) const {
+    RayPacket copy = packet;
+    return trace<true>(copy);
+}
@@ -1,8 +1,5 @@
 #include "camera.h"
-
-float maxX = 9.5f, minX = -9.5f;
-float maxY = 2.0f, minY = 2.0f;
-float maxZ = 9.5f, minZ = -9.5f;
+#include "profiler.h"
 
 Camera::Camera(glm::vec3 startPos, glm::vec3 startUp, float startYaw, float startPitch)
     : position(startPos), up(startUp), yaw(startYaw), pitch(startPitch) {
@@ -13,33 +10,43 @@ Camera::Camera(glm::vec3 startPos, glm::vec3 startUp, float startYaw, float star
     lastX = 400.0f;  // Initial mouse position X (center of the window)
     lastY = 300.0f;  // Initial mouse position Y (center of the window)
     firstMouse = true;
+    boundsMin = glm::vec3(-9.5f, 2.0f, -9.5f);
+    boundsMax = glm::vec3(9.5f, 2.0f, 9.5f);
+}
+
+void Camera::setBounds(const glm::vec3& minCorner, const glm::vec3& maxCorner) {
+    boundsMin = minCorner;
+    boundsMax = maxCorner;
 }
 
 glm::mat4 Camera::getViewMatrix() {
     return glm::lookAt(position, position + front, up);
 }
 
-void Camera::processKeyboardInput(GLFWwindow* window, float deltaTime) {
+void Camera::processKeyboardInput(const Input& input, float deltaTime) {
+    PROFILE_FUNCTION();
     float velocity = movementSpeed * deltaTime * 2;
     glm::vec3 newPos = position;
 
-    if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
+    if (input.isKeyDown(GLFW_KEY_W))
         newPos += velocity * front;
-    if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
+    if (input.isKeyDown(GLFW_KEY_S))
         newPos -= velocity * front;
-    if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
+    if (input.isKeyDown(GLFW_KEY_A))
         newPos -= glm::normalize(glm::cross(front, up)) * velocity;
-    if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
+    if (input.isKeyDown(GLFW_KEY_D))
         newPos += glm::normalize(glm::cross(front, up)) * velocity;
 
     // Simple collision detection: prevent camera from going out of bounds
     // Assuming the world is a box with limits in the X, Y, and Z axes.
-    if (newPos.x > maxX || newPos.x < minX) 
+    if (newPos.x > boundsMax.x || newPos.x < boundsMin.x) 
         newPos.x = position.x;  // Prevent moving outside X bounds
-    if (newPos.y > maxY || newPos.y < minY) 
+    if (newPos.y > boundsMax.y || newPos.y < boundsMin.y) 
         newPos.y = position.y;  // Prevent moving outside Y bounds
-    if (newPos.z > maxZ || newPos.z < minZ) 
+    if (newPos.z > boundsMax.z || newPos.z < boundsMin.z) 
         newPos.z = position.z;  // Prevent moving outside Z bounds
+    if (constrain && newPos != position)
+        newPos = constrain(position, newPos);
 
     // Update the camera's position if no collision occurred
     position = newPos;
@@ -0,0 +1,235 @@
+#include "cells.h"
+#include <algorithm>
+
+// Empty rectangle marker: min above max
+static const glm::vec4 NO_RECT(1.0f, 1.0f, -1.0f, -1.0f);
+static const glm::vec4 FULL_SCREEN(-1.0f, -1.0f, 1.0f, 1.0f);
+
+static bool isEmpty(const glm::vec4& rect) {
+    return rect.x >= rect.z || rect.y >= rect.w;
+}
+
+static bool containsRect(const glm::vec4& outer, const glm::vec4& inner) {
+    return inner.x >= outer.x && inner.y >= outer.y && inner.z <= outer.z && inner.w <= outer.w;
+}
+
+int CellGraph::addCell(const glm::vec3& boundsMin, const glm::vec3& boundsMax) {
+    Cell cell;
+    cell.boundsMin = boundsMin;
+    cell.boundsMax = boundsMax;
+    cells.push_back(cell);
+    return (int)cells.size() - 1;
+}
+
+void CellGraph::addPortal(int a, int b, const glm::vec3 corners[4], float depth) {
+    Portal portal;
+    portal.passMin = glm::vec3(1e30f);
+    portal.passMax = glm::vec3(-1e30f);
+    for (int i = 0; i < 4; ++i) {
+        portal.corners[i] = corners[i];
+        portal.passMin = glm::min(portal.passMin, corners[i]);
+        portal.passMax = glm::max(portal.passMax, corners[i]);
+    }
+    // The opening is flat; stretch it through the wall along its thin axis
+    int axis = (portal.passMax.x - portal.passMin.x) < (portal.passMax.z - portal.passMin.z) ? 0 : 2;
+    portal.passMin[axis] -= depth * 0.5f;
+    portal.passMax[axis] += depth * 0.5f;
+
+    portal.target = b;
+    cells[a].portals.push_back(portal);
+    portal.target = a;
+    cells[b].portals.push_back(portal);
+}
+
+void CellGraph::addSurface(int cell, uint32_t subMesh) {
+    cells[cell].surfaces.push_back(subMesh);
+}
+
+void CellGraph::addPainting(int cell, uint32_t painting) {
+    cells[cell].paintings.push_back(painting);
+}
+
+void CellGraph::clear() {
+    cells.clear();
+}
+
+void CellGraph::buildBounds(const std::vector<SubMesh>& subMeshes, const glm::mat4& model, const std::vector<Painting>& paintings) {
+    for (size_t c = 0; c < cells.size(); ++c) {
+        Cell& cell = cells[c];
+        cell.surfaceBounds.clear();
+        for (size_t i = 0; i < cell.surfaces.size(); ++i) {
+            const SubMesh& subMesh = subMeshes[cell.surfaces[i]];
+            cell.surfaceBounds.add(subMesh.boundsMin, subMesh.boundsMax, model);
+        }
+        cell.paintingBounds.clear();
+        for (size_t i = 0; i < cell.paintings.size(); ++i) {
+            const Painting& painting = paintings[cell.paintings[i]];
+            cell.paintingBounds.add(painting.getPosition(), painting.getBoundingRadius());
+        }
+    }
+}
+
+int CellGraph::findCell(const glm::vec3& point) const {
+    for (size_t c = 0; c < cells.size(); ++c) {
+        const Cell& cell = cells[c];
+        if (point.x >= cell.boundsMin.x && point.y >= cell.boundsMin.y && point.z >= cell.boundsMin.z &&
+            point.x <= cell.boundsMax.x && point.y <= cell.boundsMax.y && point.z <= cell.boundsMax.z) {
+            return (int)c;
+        }
+    }
+    return -1;
+}
+
+bool CellGraph::isWalkable(const glm::vec3& point, float radius) const {
+    for (size_t c = 0; c < cells.size(); ++c) {
+        const Cell& cell = cells[c];
+        if (point.x >= cell.boundsMin.x + radius && point.x <= cell.boundsMax.x - radius &&
+            point.z >= cell.boundsMin.z + radius && point.z <= cell.boundsMax.z - radius &&
+            point.y >= cell.boundsMin.y && point.y <= cell.boundsMax.y) {
+            return true;
+        }
+        for (size_t p = 0; p < cell.portals.size(); ++p) {
+            const Portal& portal = cell.portals[p];
+            // Narrower across the doorway, longer through it so the sphere can reach either room
+            glm::vec3 lo = portal.passMin, hi = portal.passMax;
+            int across = (hi.x - lo.x) < (hi.z - lo.z) ? 2 : 0;
+            int through = 2 - across;
+            lo[across] += radius;
+            hi[across] -= radius;
+            lo[through] -= radius;
+            hi[through] += radius;
+            if (point.x >= lo.x && point.x <= hi.x && point.z >= lo.z && point.z <= hi.z &&
+                point.y >= lo.y && point.y <= hi.y) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+glm::vec3 CellGraph::constrainMove(const glm::vec3& from, const glm::vec3& to, float radius) const {
+    if (isWalkable(to, radius)) return to;
+
+    glm::vec3 result = from;
+    if (isWalkable(glm::vec3(to.x, from.y, from.z), radius)) result.x = to.x;
+    if (isWalkable(glm::vec3(result.x, from.y, to.z), radius)) result.z = to.z;
+    return result;
+}
+
+bool CellGraph::portalRect(const Portal& portal, const glm::mat4& viewProjection, const glm::vec3& eye, glm::vec4& rect) const {
+    // Standing in the doorway: the near plane would cut the opening away
+    const float NEAR_MARGIN = 0.5f;
+    if (eye.x >= portal.passMin.x - NEAR_MARGIN && eye.x <= portal.passMax.x + NEAR_MARGIN &&
+        eye.y >= portal.passMin.y && eye.y <= portal.passMax.y &&
+        eye.z >= portal.passMin.z - NEAR_MARGIN && eye.z <= portal.passMax.z + NEAR_MARGIN) {
+        rect = FULL_SCREEN;
+        return true;
+    }
+
+    // Clip the polygon against the near plane (z + w >= 0) before dividing by w
+    glm::vec4 input[4];
+    for (int i = 0; i < 4; ++i) input[i] = viewProjection * glm::vec4(portal.corners[i], 1.0f);
+    glm::vec4 clipped[8];
+    int count = 0;
+    for (int i = 0; i < 4; ++i) {
+        const glm::vec4& a = input[i];
+        const glm::vec4& b = input[(i + 1) % 4];
+        float da = a.z + a.w, db = b.z + b.w;
+        if (da >= 0.0f) clipped[count++] = a;
+        if ((da >= 0.0f) != (db >= 0.0f)) {
+            float t = da / (da - db);
+            clipped[count++] = a + (b - a) * t;
+        }
+    }
+    if (count == 0) return false;
+
+    rect = glm::vec4(1e30f, 1e30f, -1e30f, -1e30f);
+    for (int i = 0; i < count; ++i) {
+        float w = std::max(clipped[i].w, 1e-6f);
+        float x = clipped[i].x / w, y = clipped[i].y / w;
+        rect.x = std::min(rect.x, x);
+        rect.y = std::min(rect.y, y);
+        rect.z = std::max(rect.z, x);
+        rect.w = std::max(rect.w, y);
+    }
+    rect = glm::vec4(std::max(rect.x, -1.0f), std::max(rect.y, -1.0f), std::min(rect.z, 1.0f), std::min(rect.w, 1.0f));
+    return !isEmpty(rect);
+}
+
+void CellGraph::visit(int cell, const glm::vec4& rect, int depth, const glm::mat4& viewProjection,
+                      const glm::vec3& eye, CellVisibility& out) const {
+    glm::vec4& seen = reached[cell];
+    if (isEmpty(seen)) {
+        out.cells.push_back(cell);
+        seen = rect;
+    } else if (containsRect(seen, rect)) {
+        return; // nothing new is visible through this path
+    } else {
+        seen = glm::vec4(std::min(seen.x, rect.x), std::min(seen.y, rect.y), std::max(seen.z, rect.z), std::max(seen.w, rect.w));
+    }
+    if (depth >= MAX_DEPTH) return;
+
+    onPath[cell] = 1;
+    const std::vector<Portal>& portals = cells[cell].portals;
+    for (size_t p = 0; p < portals.size(); ++p) {
+        const Portal& portal = portals[p];
+        if (onPath[portal.target]) continue;
+
+        out.portalsTested++;
+        glm::vec4 through;
+        if (!portalRect(portal, viewProjection, eye, through)) continue;
+        through = glm::vec4(std::max(through.x, rect.x), std::max(through.y, rect.y),
+                            std::min(through.z, rect.z), std::min(through.w, rect.w));
+        if (!isEmpty(through)) visit(portal.target, through, depth + 1, viewProjection, eye, out);
+    }
+    onPath[cell] = 0;
+}
+
+void CellGraph::collect(int cell, const glm::vec4& rect, const glm::mat4& viewProjection, CellVisibility& out) const {
+    const Cell& c = cells[cell];
+    Frustum frustum;
+    frustum.extract(viewProjection, rect);
+
+    frustumCullBoxes(frustum, c.surfaceBounds, scratch);
+    for (size_t i = 0; i < scratch.size(); ++i) out.surfaces.push_back(c.surfaces[scratch[i]]);
+    frustumCullSpheres(frustum, c.paintingBounds, scratch);
+    for (size_t i = 0; i < scratch.size(); ++i) out.paintings.push_back(c.paintings[scratch[i]]);
+}
+
+void CellGraph::findVisible(const glm::mat4& viewProjection, const glm::vec3& eye, CellVisibility& out) const {
+    out.cells.clear();
+    out.surfaces.clear();
+    out.paintings.clear();
+    out.portalsTested = 0;
+    reached.assign(cells.size(), NO_RECT);
+    onPath.assign(cells.size(), 0);
+
+    int start = findCell(eye);
+    if (start < 0) {
+        // In a doorway: start on either side, the portal back is then fully open
+        for (size_t c = 0; c < cells.size() && start < 0; ++c) {
+            for (size_t p = 0; p < cells[c].portals.size(); ++p) {
+                const Portal& portal = cells[c].portals[p];
+                if (eye.x >= portal.passMin.x && eye.x <= portal.passMax.x &&
+                    eye.z >= portal.passMin.z && eye.z <= portal.passMax.z) {
+                    start = (int)c;
+                    break;
+                }
+            }
+        }
+    }
+
+    if (start >= 0) {
+        visit(start, FULL_SCREEN, 0, viewProjection, eye, out);
+    } else {
+        // Outside every cell: fall back to plain frustum culling
+        for (size_t c = 0; c < cells.size(); ++c) {
+            out.cells.push_back((int)c);
+            reached[c] = FULL_SCREEN;
+        }
+    }
+
+    for (size_t i = 0; i < out.cells.size(); ++i) {
+        collect(out.cells[i], reached[out.cells[i]], viewProjection, out);
+    }
+}
@@ -0,0 +1,224 @@
+#include "clustered_lighting.h"
+#include "gl_state.h"
+#include "render_stats.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+static const GLenum BUFFER_FORMATS[3] = { GL_RGBA32F, GL_RG32UI, GL_R32UI };
+static const GLuint BUFFER_UNITS[3] = { ClusteredLighting::LIGHT_UNIT, ClusteredLighting::GRID_UNIT,
+                                        ClusteredLighting::INDEX_UNIT };
+
+ClusteredLighting::ClusteredLighting()
+    : boxesProjection(0.0f), nearPlane(0.1f), farPlane(100.0f), sliceScale(0.0f), sliceBias(0.0f),
+      tilesPerPixel(0.0f) {
+    for (int i = 0; i < 3; ++i) {
+        buffers[i] = 0;
+        textures[i] = 0;
+    }
+    stats.lightsInView = 0;
+    stats.lightIndices = 0;
+    stats.maxClusterLights = 0;
+}
+
+ClusteredLighting::~ClusteredLighting() {
+    for (int i = 0; i < 3; ++i) {
+        glState().forgetTexture(textures[i]);
+    }
+    glDeleteTextures(3, textures);
+    glDeleteBuffers(3, buffers);
+}
+
+void ClusteredLighting::init() {
+    glGenBuffers(3, buffers);
+    glGenTextures(3, textures);
+    for (int i = 0; i < 3; ++i) {
+        // Never empty, so the texture always has a valid store
+        glBindBuffer(GL_TEXTURE_BUFFER, buffers[i]);
+        glBufferData(GL_TEXTURE_BUFFER, 16, NULL, GL_DYNAMIC_DRAW);
+        glState().bindTextureUnit(BUFFER_UNITS[i], GL_TEXTURE_BUFFER, textures[i]);
+        glTexBuffer(GL_TEXTURE_BUFFER, BUFFER_FORMATS[i], buffers[i]);
+    }
+    clusterLights.resize(CLUSTER_COUNT);
+    grid.assign(2 * CLUSTER_COUNT, 0);
+    std::cout << "Clustered lighting: " << GRID_X << "x" << GRID_Y << "x" << GRID_Z << " clusters, "
+              << workers.threadCount() << " binning thread(s)" << std::endl;
+}
+
+void ClusteredLighting::setLights(const std::vector<SpotLight>& spotLights) {
+    lights = spotLights;
+
+    // Three texels per light: position + range, direction + cos outer, color + cos inner
+    std::vector<glm::vec4> texels;
+    texels.reserve(3 * lights.size());
+    for (size_t i = 0; i < lights.size(); ++i) {
+        const SpotLight& light = lights[i];
+        texels.push_back(glm::vec4(light.position, light.range));
+        texels.push_back(glm::vec4(glm::normalize(light.direction), std::cos(glm::radians(light.outerAngle))));
+        texels.push_back(glm::vec4(light.color, std::cos(glm::radians(light.innerAngle))));
+    }
+    if (texels.empty()) return;
+    glBindBuffer(GL_TEXTURE_BUFFER, buffers[0]);
+    glBufferData(GL_TEXTURE_BUFFER, texels.size() * sizeof(glm::vec4), &texels[0], GL_STATIC_DRAW);
+    renderStats().countBufferUpload(texels.size() * sizeof(glm::vec4));
+}
+
+int ClusteredLighting::sliceOf(float depth) const {
+    int slice = (int)std::floor(std::log(depth) * sliceScale - sliceBias);
+    return std::max(0, std::min(slice, GRID_Z - 1));
+}
+
+void ClusteredLighting::buildClusterBoxes(const glm::mat4& projection) {
+    // Symmetric perspective: a point at NDC (x, y) and depth d sits at (x d / P00, y d / P11, -d)
+    float scaleX = 1.0f / projection[0][0];
+    float scaleY = 1.0f / projection[1][1];
+    clusterBoxes.resize(CLUSTER_COUNT);
+    for (int z = 0; z < GRID_Z; ++z) {
+        float depths[2] = { nearPlane * std::pow(farPlane / nearPlane, (float)z / GRID_Z),
+                            nearPlane * std::pow(farPlane / nearPlane, (float)(z + 1) / GRID_Z) };
+        for (int y = 0; y < GRID_Y; ++y) {
+            float ndcY[2] = { -1.0f + 2.0f * y / GRID_Y, -1.0f + 2.0f * (y + 1) / GRID_Y };
+            for (int x = 0; x < GRID_X; ++x) {
+                float ndcX[2] = { -1.0f + 2.0f * x / GRID_X, -1.0f + 2.0f * (x + 1) / GRID_X };
+                Box& box = clusterBoxes[(z * GRID_Y + y) * GRID_X + x];
+                box.min = glm::vec3(1e30f);
+                box.max = glm::vec3(-1e30f);
+                for (int corner = 0; corner < 8; ++corner) {
+                    float d = depths[corner >> 2];
+                    glm::vec3 p(ndcX[corner & 1] * d * scaleX, ndcY[(corner >> 1) & 1] * d * scaleY, -d);
+                    box.min = glm::min(box.min, p);
+                    box.max = glm::max(box.max, p);
+                }
+            }
+        }
+    }
+    boxesProjection = projection;
+}
+
+bool ClusteredLighting::boundLight(const SpotLight& light, const glm::mat4& view, const glm::mat4& projection,
+                                   LightBounds& bounds) const {
+    // Sphere around the cone: for wide cones the base disc's, else the one through apex and rim
+    float angle = glm::radians(light.outerAngle);
+    glm::vec3 center;
+    float radius;
+    if (angle > glm::radians(45.0f)) {
+        center = light.position + light.direction * (std::cos(angle) * light.range);
+        radius = std::sin(angle) * light.range;
+    } else {
+        radius = light.range / (2.0f * std::cos(angle));
+        center = light.position + light.direction * radius;
+    }
+    bounds.center = glm::vec3(view * glm::vec4(center, 1.0f));
+    bounds.radius = radius;
+
+    float depth = -bounds.center.z;
+    float nearDepth = depth - radius, farDepth = depth + radius;
+    if (farDepth < nearPlane || nearDepth > farPlane) return false;
+    bounds.z0 = sliceOf(std::max(nearDepth, nearPlane));
+    bounds.z1 = sliceOf(std::min(farDepth, farPlane));
+
+    bounds.x0 = 0;
+    bounds.x1 = GRID_X - 1;
+    bounds.y0 = 0;
+    bounds.y1 = GRID_Y - 1;
+    if (nearDepth > nearPlane) {
+        // Project the sphere's box; extremes of x / d come from the nearest or farthest depth
+        float ndc[2][2] = { { 1e30f, -1e30f }, { 1e30f, -1e30f } };
+        for (int corner = 0; corner < 8; ++corner) {
+            float x = bounds.center.x + ((corner & 1) ? radius : -radius);
+            float y = bounds.center.y + ((corner & 2) ? radius : -radius);
+            float d = (corner & 4) ? farDepth : nearDepth;
+            float px = x * projection[0][0] / d, py = y * projection[1][1] / d;
+            ndc[0][0] = std::min(ndc[0][0], px);
+            ndc[0][1] = std::max(ndc[0][1], px);
+            ndc[1][0] = std::min(ndc[1][0], py);
+            ndc[1][1] = std::max(ndc[1][1], py);
+        }
+        if (ndc[0][1] < -1.0f || ndc[0][0] > 1.0f || ndc[1][1] < -1.0f || ndc[1][0] > 1.0f) return false;
+        bounds.x0 = std::max(0, (int)std::floor((ndc[0][0] * 0.5f + 0.5f) * GRID_X));
+        bounds.x1 = std::min(GRID_X - 1, (int)std::floor((ndc[0][1] * 0.5f + 0.5f) * GRID_X));
+        bounds.y0 = std::max(0, (int)std::floor((ndc[1][0] * 0.5f + 0.5f) * GRID_Y));
+        bounds.y1 = std::min(GRID_Y - 1, (int)std::floor((ndc[1][1] * 0.5f + 0.5f) * GRID_Y));
+    }
+    return true;
+}
+
+void ClusteredLighting::binSlices(size_t begin, size_t end) {
+    for (size_t z = begin; z < end; ++z) {
+        for (size_t i = 0; i < CLUSTER_COUNT / GRID_Z; ++i) {
+            clusterLights[z * (CLUSTER_COUNT / GRID_Z) + i].clear();
+        }
+        for (size_t l = 0; l < inView.size(); ++l) {
+            const LightBounds& bounds = inView[l];
+            if ((int)z < bounds.z0 || (int)z > bounds.z1) continue;
+            float radius2 = bounds.radius * bounds.radius;
+            for (int y = bounds.y0; y <= bounds.y1; ++y) {
+                for (int x = bounds.x0; x <= bounds.x1; ++x) {
+                    size_t cluster = (z * GRID_Y + y) * GRID_X + x;
+                    const Box& box = clusterBoxes[cluster];
+                    glm::vec3 nearest = glm::clamp(bounds.center, box.min, box.max);
+                    glm::vec3 offset = nearest - bounds.center;
+                    if (glm::dot(offset, offset) <= radius2) clusterLights[cluster].push_back(inViewIndices[l]);
+                }
+            }
+        }
+    }
+}
+
+void ClusteredLighting::update(const glm::mat4& view, const glm::mat4& projection, float nearDistance,
+                               float farDistance, int width, int height) {
+    if (nearDistance != nearPlane || farDistance != farPlane || projection != boxesProjection) {
+        nearPlane = nearDistance;
+        farPlane = farDistance;
+        // slice = log(depth) * scale - bias puts nearPlane at 0 and farPlane at GRID_Z
+        sliceScale = GRID_Z / std::log(farPlane / nearPlane);
+        sliceBias = GRID_Z * std::log(nearPlane) / std::log(farPlane / nearPlane);
+        buildClusterBoxes(projection);
+    }
+    tilesPerPixel = glm::vec2((float)GRID_X / width, (float)GRID_Y / height);
+
+    inView.clear();
+    inViewIndices.clear();
+    for (size_t i = 0; i < lights.size(); ++i) {
+        LightBounds bounds;
+        if (!boundLight(lights[i], view, projection, bounds)) continue;
+        inView.push_back(bounds);
+        inViewIndices.push_back((uint32_t)i);
+    }
+
+    // Slices are independent, so each thread fills whole slices without locking
+    workers.parallelFor(GRID_Z, [this](size_t begin, size_t end) { binSlices(begin, end); });
+
+    indices.clear();
+    stats.maxClusterLights = 0;
+    for (size_t cluster = 0; cluster < CLUSTER_COUNT; ++cluster) {
+        const std::vector<uint32_t>& list = clusterLights[cluster];
+        grid[2 * cluster] = (uint32_t)indices.size();
+        grid[2 * cluster + 1] = (uint32_t)list.size();
+        indices.insert(indices.end(), list.begin(), list.end());
+        stats.maxClusterLights = std::max(stats.maxClusterLights, (unsigned int)list.size());
+    }
+    stats.lightsInView = (unsigned int)inView.size();
+    stats.lightIndices = (unsigned int)indices.size();
+
+    // Orphan and refill; the previous frame's lists may still be in use
+    glBindBuffer(GL_TEXTURE_BUFFER, buffers[1]);
+    glBufferData(GL_TEXTURE_BUFFER, grid.size() * sizeof(uint32_t), &grid[0], GL_STREAM_DRAW);
+    renderStats().countBufferUpload(grid.size() * sizeof(uint32_t));
+    if (!indices.empty()) {
+        glBindBuffer(GL_TEXTURE_BUFFER, buffers[2]);
+        glBufferData(GL_TEXTURE_BUFFER, indices.size() * sizeof(uint32_t), &indices[0], GL_STREAM_DRAW);
+        renderStats().countBufferUpload(indices.size() * sizeof(uint32_t));
+    }
+}
+
+void ClusteredLighting::apply(Shader& shader) const {
+    for (int i = 0; i < 3; ++i) {
+        glState().bindTextureUnit(BUFFER_UNITS[i], GL_TEXTURE_BUFFER, textures[i]);
+    }
+    shader.setInt("spotLights", LIGHT_UNIT);
+    shader.setInt("clusterGrid", GRID_UNIT);
+    shader.setInt("clusterLights", INDEX_UNIT);
+    shader.setVec4("clusterTiles", glm::vec4(tilesPerPixel, 0.0f, 0.0f));
+    shader.setVec4("clusterDepth", glm::vec4(nearPlane, farPlane, sliceScale, sliceBias));
+}
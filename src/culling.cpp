@@ -0,0 +1,220 @@
+#include "culling.h"
+#include <cmath>
+
+#if (defined(__x86_64__) || defined(__SSE__)) && (defined(__GNUC__) || defined(__clang__))
+#define CULLING_X86 1
+#include <immintrin.h>
+#endif
+
+void Frustum::extract(const glm::mat4& m) {
+    // Gribb/Hartmann: each plane is the fourth row of the matrix plus or minus another row
+    for (int i = 0; i < 3; ++i) {
+        planes[i * 2 + 0] = glm::vec4(m[0][3] + m[0][i], m[1][3] + m[1][i], m[2][3] + m[2][i], m[3][3] + m[3][i]);
+        planes[i * 2 + 1] = glm::vec4(m[0][3] - m[0][i], m[1][3] - m[1][i], m[2][3] - m[2][i], m[3][3] - m[3][i]);
+    }
+    for (int i = 0; i < 6; ++i) {
+        float length = std::sqrt(planes[i].x * planes[i].x + planes[i].y * planes[i].y + planes[i].z * planes[i].z);
+        planes[i] /= length;
+    }
+}
+
+void Frustum::extract(const glm::mat4& m, const glm::vec4& rect) {
+    extract(m);
+    // Clip-space x >= x0 * w etc.; near and far planes are kept from above
+    glm::vec4 row0(m[0][0], m[1][0], m[2][0], m[3][0]);
+    glm::vec4 row1(m[0][1], m[1][1], m[2][1], m[3][1]);
+    glm::vec4 row3(m[0][3], m[1][3], m[2][3], m[3][3]);
+    planes[0] = row0 - row3 * rect.x;
+    planes[1] = row3 * rect.z - row0;
+    planes[2] = row1 - row3 * rect.y;
+    planes[3] = row3 * rect.w - row1;
+    for (int i = 0; i < 4; ++i) {
+        float length = std::sqrt(planes[i].x * planes[i].x + planes[i].y * planes[i].y + planes[i].z * planes[i].z);
+        planes[i] /= length;
+    }
+}
+
+bool Frustum::intersectsBox(const glm::vec3& minCorner, const glm::vec3& maxCorner) const {
+    glm::vec3 center = (minCorner + maxCorner) * 0.5f;
+    glm::vec3 extent = (maxCorner - minCorner) * 0.5f;
+    for (int p = 0; p < 6; ++p) {
+        const glm::vec4& plane = planes[p];
+        float distance = plane.x * center.x + plane.y * center.y + plane.z * center.z + plane.w;
+        float r = std::fabs(plane.x) * extent.x + std::fabs(plane.y) * extent.y + std::fabs(plane.z) * extent.z;
+        if (distance < -r) return false;
+    }
+    return true;
+}
+
+static void padTo8(std::vector<float>& values, size_t count, float padding) {
+    size_t padded = (count + 7) & ~(size_t)7;
+    values.resize(padded, padding);
+}
+
+void BoundingSpheres::clear() {
+    x.clear(); y.clear(); z.clear(); radius.clear();
+    count = 0;
+}
+
+size_t BoundingSpheres::add(const glm::vec3& center, float r) {
+    x.resize(count); y.resize(count); z.resize(count); radius.resize(count);
+    x.push_back(center.x); y.push_back(center.y); z.push_back(center.z); radius.push_back(r);
+    ++count;
+    // Padding lanes are far outside any frustum and never reported
+    padTo8(x, count, 1e30f); padTo8(y, count, 0.0f); padTo8(z, count, 0.0f); padTo8(radius, count, 0.0f);
+    return count - 1;
+}
+
+void BoundingBoxes::clear() {
+    cx.clear(); cy.clear(); cz.clear(); ex.clear(); ey.clear(); ez.clear();
+    count = 0;
+}
+
+size_t BoundingBoxes::add(const glm::vec3& minCorner, const glm::vec3& maxCorner) {
+    glm::vec3 center = (minCorner + maxCorner) * 0.5f;
+    glm::vec3 extent = (maxCorner - minCorner) * 0.5f;
+    cx.resize(count); cy.resize(count); cz.resize(count); ex.resize(count); ey.resize(count); ez.resize(count);
+    cx.push_back(center.x); cy.push_back(center.y); cz.push_back(center.z);
+    ex.push_back(extent.x); ey.push_back(extent.y); ez.push_back(extent.z);
+    ++count;
+    padTo8(cx, count, 1e30f); padTo8(cy, count, 0.0f); padTo8(cz, count, 0.0f);
+    padTo8(ex, count, 0.0f); padTo8(ey, count, 0.0f); padTo8(ez, count, 0.0f);
+    return count - 1;
+}
+
+size_t BoundingBoxes::add(const glm::vec3& minCorner, const glm::vec3& maxCorner, const glm::mat4& model) {
+    glm::vec3 center = glm::vec3(model * glm::vec4((minCorner + maxCorner) * 0.5f, 1.0f));
+    glm::vec3 extent = (maxCorner - minCorner) * 0.5f;
+    glm::vec3 worldExtent(0.0f);
+    for (int column = 0; column < 3; ++column) {
+        for (int row = 0; row < 3; ++row) {
+            worldExtent[row] += std::fabs(model[column][row]) * extent[column];
+        }
+    }
+    return add(center - worldExtent, center + worldExtent);
+}
+
+// A sphere is outside if it lies entirely behind any plane. A box is the
+// same test with its radius projected onto the plane normal.
+struct CullInput {
+    const float* x; const float* y; const float* z;
+    const float* ex; const float* ey; const float* ez; // radius in ex when sphere
+    bool boxes;
+    size_t count;
+};
+
+#ifndef CULLING_X86
+static void cullScalar(const Frustum& frustum, const CullInput& in, std::vector<uint32_t>& visible) {
+    for (size_t i = 0; i < in.count; ++i) {
+        bool inside = true;
+        for (int p = 0; p < 6 && inside; ++p) {
+            const glm::vec4& plane = frustum.planes[p];
+            float distance = plane.x * in.x[i] + plane.y * in.y[i] + plane.z * in.z[i] + plane.w;
+            float r = in.boxes ? std::fabs(plane.x) * in.ex[i] + std::fabs(plane.y) * in.ey[i] + std::fabs(plane.z) * in.ez[i]
+                               : in.ex[i];
+            inside = distance >= -r;
+        }
+        if (inside) visible.push_back((uint32_t)i);
+    }
+}
+#endif
+
+#ifdef CULLING_X86
+static void cullSSE(const Frustum& frustum, const CullInput& in, std::vector<uint32_t>& visible) {
+    size_t padded = (in.count + 7) & ~(size_t)7;
+    for (size_t i = 0; i < padded; i += 4) {
+        __m128 x = _mm_loadu_ps(in.x + i), y = _mm_loadu_ps(in.y + i), z = _mm_loadu_ps(in.z + i);
+        __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+        for (int p = 0; p < 6; ++p) {
+            const glm::vec4& plane = frustum.planes[p];
+            __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane.x), x), _mm_mul_ps(_mm_set1_ps(plane.y), y)),
+                                         _mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane.z), z), _mm_set1_ps(plane.w)));
+            __m128 r;
+            if (in.boxes) {
+                r = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(std::fabs(plane.x)), _mm_loadu_ps(in.ex + i)),
+                                          _mm_mul_ps(_mm_set1_ps(std::fabs(plane.y)), _mm_loadu_ps(in.ey + i))),
+                               _mm_mul_ps(_mm_set1_ps(std::fabs(plane.z)), _mm_loadu_ps(in.ez + i)));
+            } else {
+                r = _mm_loadu_ps(in.ex + i);
+            }
+            inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, _mm_sub_ps(_mm_setzero_ps(), r)));
+        }
+        int mask = _mm_movemask_ps(inside);
+        while (mask) {
+            int lane = __builtin_ctz(mask);
+            if (i + lane < in.count) visible.push_back((uint32_t)(i + lane));
+            mask &= mask - 1;
+        }
+    }
+}
+#endif
+
+#ifdef CULLING_X86
+__attribute__((target("avx")))
+static void cullAVX(const Frustum& frustum, const CullInput& in, std::vector<uint32_t>& visible) {
+    size_t padded = (in.count + 7) & ~(size_t)7;
+    for (size_t i = 0; i < padded; i += 8) {
+        __m256 x = _mm256_loadu_ps(in.x + i), y = _mm256_loadu_ps(in.y + i), z = _mm256_loadu_ps(in.z + i);
+        __m256 ex = _mm256_loadu_ps(in.ex + i);
+        __m256 ey = in.boxes ? _mm256_loadu_ps(in.ey + i) : _mm256_setzero_ps();
+        __m256 ez = in.boxes ? _mm256_loadu_ps(in.ez + i) : _mm256_setzero_ps();
+        __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+        for (int p = 0; p < 6; ++p) {
+            const glm::vec4& plane = frustum.planes[p];
+            __m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(plane.x), x), _mm256_mul_ps(_mm256_set1_ps(plane.y), y)),
+                                            _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(plane.z), z), _mm256_set1_ps(plane.w)));
+            __m256 r = in.boxes
+                ? _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(std::fabs(plane.x)), ex),
+                                              _mm256_mul_ps(_mm256_set1_ps(std::fabs(plane.y)), ey)),
+                                _mm256_mul_ps(_mm256_set1_ps(std::fabs(plane.z)), ez))
+                : ex;
+            inside = _mm256_and_ps(inside, _mm256_cmp_ps(distance, _mm256_sub_ps(_mm256_setzero_ps(), r), _CMP_GE_OQ));
+        }
+        int mask = _mm256_movemask_ps(inside);
+        while (mask) {
+            int lane = __builtin_ctz(mask);
+            if (i + lane < in.count) visible.push_back((uint32_t)(i + lane));
+            mask &= mask - 1;
+        }
+    }
+}
+
+static bool cpuHasAVX() {
+    static const bool hasAVX = __builtin_cpu_supports("avx");
+    return hasAVX;
+}
+#endif
+
+static size_t cull(const Frustum& frustum, const CullInput& in, std::vector<uint32_t>& visible) {
+    visible.clear();
+    if (in.count == 0) return 0;
+#if defined(CULLING_X86)
+    if (cpuHasAVX()) cullAVX(frustum, in, visible);
+    else cullSSE(frustum, in, visible);
+#else
+    cullScalar(frustum, in, visible);
+#endif
+    return visible.size();
+}
+
+size_t frustumCullSpheres(const Frustum& frustum, const BoundingSpheres& spheres, std::vector<uint32_t>& visible) {
+    CullInput in;
+    in.boxes = false;
+    in.count = spheres.count;
+    if (in.count) {
+        in.x = &spheres.x[0]; in.y = &spheres.y[0]; in.z = &spheres.z[0];
+        in.ex = &spheres.radius[0]; in.ey = in.ez = NULL;
+    }
+    return cull(frustum, in, visible);
+}
+
+size_t frustumCullBoxes(const Frustum& frustum, const BoundingBoxes& boxes, std::vector<uint32_t>& visible) {
+    CullInput in;
+    in.boxes = true;
+    in.count = boxes.count;
+    if (in.count) {
+        in.x = &boxes.cx[0]; in.y = &boxes.cy[0]; in.z = &boxes.cz[0];
+        in.ex = &boxes.ex[0]; in.ey = &boxes.ey[0]; in.ez = &boxes.ez[0];
+    }
+    return cull(frustum, in, visible);
+}
@@ -0,0 +1,98 @@
+#include "deferred_renderer.h"
+#include "gl_state.h"
+#include "render_stats.h"
+#include <iostream>
+
+// Texture units for the resolve; clear of the clustered-light buffers
+static const GLuint TARGET_UNITS[DeferredRenderer::TARGET_COUNT] = { 0, 1, 2 };
+
+DeferredRenderer::DeferredRenderer() : framebuffer(0), emptyVAO(0), width(0), height(0) {
+    for (int i = 0; i < TARGET_COUNT; ++i) targets[i] = 0;
+}
+
+DeferredRenderer::~DeferredRenderer() {
+    releaseTargets();
+    if (emptyVAO) {
+        glState().forgetVertexArray(emptyVAO);
+        glDeleteVertexArrays(1, &emptyVAO);
+    }
+}
+
+void DeferredRenderer::init() {
+    lighting.reset(new Shader("shaders/deferred_vs.glsl", "shaders/deferred_fs.glsl"));
+    // The full-screen triangle comes from gl_VertexID, but core profiles still want a VAO bound
+    glGenVertexArrays(1, &emptyVAO);
+}
+
+void DeferredRenderer::createTargets() {
+    glGenFramebuffers(1, &framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glGenTextures(TARGET_COUNT, targets);
+
+    const GLenum internalFormats[TARGET_COUNT] = { GL_SRGB8_ALPHA8, GL_RGB10_A2, GL_DEPTH_COMPONENT24 };
+    const GLenum formats[TARGET_COUNT] = { GL_RGBA, GL_RGBA, GL_DEPTH_COMPONENT };
+    const GLenum types[TARGET_COUNT] = { GL_UNSIGNED_BYTE, GL_UNSIGNED_INT_2_10_10_10_REV, GL_UNSIGNED_INT };
+    const GLenum attachments[TARGET_COUNT] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1, GL_DEPTH_ATTACHMENT };
+    for (int i = 0; i < TARGET_COUNT; ++i) {
+        glState().bindTexture(GL_TEXTURE_2D, targets[i]);
+        glTexImage2D(GL_TEXTURE_2D, 0, internalFormats[i], width, height, 0, formats[i], types[i], NULL);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, attachments[i], GL_TEXTURE_2D, targets[i], 0);
+    }
+    const GLenum drawBuffers[2] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+    glDrawBuffers(2, drawBuffers);
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        std::cerr << "G-buffer framebuffer is incomplete" << std::endl;
+    }
+    std::cout << "G-buffer: " << width << "x" << height << std::endl;
+}
+
+void DeferredRenderer::releaseTargets() {
+    for (int i = 0; i < TARGET_COUNT; ++i) glState().forgetTexture(targets[i]);
+    if (framebuffer) {
+        glDeleteTextures(TARGET_COUNT, targets);
+        glDeleteFramebuffers(1, &framebuffer);
+    }
+    framebuffer = 0;
+    for (int i = 0; i < TARGET_COUNT; ++i) targets[i] = 0;
+}
+
+void DeferredRenderer::beginGeometry(int newWidth, int newHeight) {
+    if (framebuffer == 0 || newWidth != width || newHeight != height) {
+        releaseTargets();
+        width = newWidth;
+        height = newHeight;
+        createTargets();
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    // Shaders write linear albedo; the sRGB target encodes it so darks keep their precision
+    glEnable(GL_FRAMEBUFFER_SRGB);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+}
+
+void DeferredRenderer::endGeometry(GLuint target) {
+    glDisable(GL_FRAMEBUFFER_SRGB);
+    glBindFramebuffer(GL_FRAMEBUFFER, target);
+}
+
+void DeferredRenderer::resolve(const glm::mat4& view, const glm::mat4& projection) {
+    lighting->use();
+    lighting->setInt("gAlbedo", TARGET_UNITS[ALBEDO]);
+    lighting->setInt("gNormal", TARGET_UNITS[NORMAL]);
+    lighting->setInt("gDepth", TARGET_UNITS[DEPTH]);
+    lighting->setMat4("inverseViewProjection", glm::inverse(projection * view));
+    for (int i = 0; i < TARGET_COUNT; ++i) {
+        glState().bindTextureUnit(TARGET_UNITS[i], GL_TEXTURE_2D, targets[i]);
+    }
+
+    // Pixels without geometry are discarded and keep the target's clear
+    glDisable(GL_DEPTH_TEST);
+    glState().bindVertexArray(emptyVAO);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    renderStats().countDraw(GL_TRIANGLES, 3);
+    glEnable(GL_DEPTH_TEST);
+}
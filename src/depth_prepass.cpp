@@ -0,0 +1,82 @@
+#include "depth_prepass.h"
+
+DepthPrepass::DepthPrepass()
+    : next(0), oldest(0), counting(false), counted(false), samples(0), samplesPixels(0) {
+    for (int i = 0; i < QUERY_COUNT; ++i) {
+        queries[i] = 0;
+        queryPixels[i] = 0;
+        pending[i] = false;
+    }
+}
+
+DepthPrepass::~DepthPrepass() {
+    if (queries[0]) glDeleteQueries(QUERY_COUNT, queries);
+}
+
+void DepthPrepass::init(bool multiDraw) {
+    const char* VS = "shaders/depth_vs.glsl";
+    programs[MESH].reset(new Shader(VS, NULL));
+    programs[PAINTING].reset(new Shader(VS, NULL, "#define PAINTING\n"));
+    programs[FRAME].reset(new Shader(VS, NULL, "#define FRAME\n"));
+    if (multiDraw) programs[MULTI_DRAW].reset(new Shader(VS, NULL, "#define MULTI_DRAW\n"));
+    glGenQueries(QUERY_COUNT, queries);
+}
+
+void DepthPrepass::setMatrices(const glm::mat4& view, const glm::mat4& projection) {
+    for (int i = 0; i < PROGRAM_COUNT; ++i) {
+        if (!programs[i]) continue;
+        programs[i]->setMat4("view", view);
+        programs[i]->setMat4("projection", projection);
+    }
+}
+
+void DepthPrepass::begin() {
+    glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+    glDepthMask(GL_TRUE);
+    glDepthFunc(GL_LESS);
+}
+
+void DepthPrepass::end() {
+    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+    glDepthMask(GL_FALSE);
+    glDepthFunc(GL_EQUAL);
+}
+
+void DepthPrepass::restore() {
+    glDepthMask(GL_TRUE);
+    glDepthFunc(GL_LESS);
+}
+
+// Reads back finished queries oldest first, without waiting on any
+void DepthPrepass::collect() {
+    while (pending[oldest]) {
+        GLint available = 0;
+        glGetQueryObjectiv(queries[oldest], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) break;
+        GLuint64 result = 0;
+        glGetQueryObjectui64v(queries[oldest], GL_QUERY_RESULT, &result);
+        samples = result;
+        samplesPixels = queryPixels[oldest];
+        counted = true;
+        pending[oldest] = false;
+        oldest = (oldest + 1) % QUERY_COUNT;
+    }
+}
+
+void DepthPrepass::beginCount(int pixels) {
+    if (!queries[0]) return;
+    collect();
+    // GPU more than QUERY_COUNT frames behind: skip this frame rather than wait
+    if (pending[next]) return;
+    glBeginQuery(GL_SAMPLES_PASSED, queries[next]);
+    queryPixels[next] = pixels;
+    counting = true;
+}
+
+void DepthPrepass::endCount() {
+    if (!counting) return;
+    glEndQuery(GL_SAMPLES_PASSED);
+    pending[next] = true;
+    next = (next + 1) % QUERY_COUNT;
+    counting = false;
+}
@@ -0,0 +1,162 @@
+#include "dynamic_resolution.h"
+#include "gl_state.h"
+#include "render_stats.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+DynamicResolution::DynamicResolution()
+    : emptyVAO(0), targetFramebuffer(0), colorTexture(0), depthBuffer(0), targetWidth(0), targetHeight(0),
+      windowWidth(0), windowHeight(0), next(0), oldest(0), timing(false), controlScale(1.0f), appliedScale(1.0f),
+      previousError(0.0f), olderError(0.0f), hasError(false), lastGpuMs(-1.0f) {
+    for (int i = 0; i < QUERY_COUNT; ++i) {
+        queries[i] = 0;
+        pending[i] = false;
+    }
+}
+
+DynamicResolution::~DynamicResolution() {
+    releaseTarget();
+    if (emptyVAO) {
+        glState().forgetVertexArray(emptyVAO);
+        glDeleteVertexArrays(1, &emptyVAO);
+        glDeleteQueries(QUERY_COUNT, queries);
+    }
+}
+
+void DynamicResolution::init(const Settings& newSettings) {
+    settings = newSettings;
+    controlScale = appliedScale = settings.maxScale;
+    // The full-screen triangle of the deferred resolve
+    upscale.reset(new Shader("shaders/deferred_vs.glsl", "shaders/upscale_fs.glsl"));
+    glGenVertexArrays(1, &emptyVAO);
+    glGenQueries(QUERY_COUNT, queries);
+    std::cout << "Dynamic resolution: " << settings.budgetMs << " ms GPU budget, scale "
+              << settings.minScale << "-" << settings.maxScale << std::endl;
+}
+
+void DynamicResolution::releaseTarget() {
+    glState().forgetTexture(colorTexture);
+    if (targetFramebuffer) {
+        glDeleteFramebuffers(1, &targetFramebuffer);
+        glDeleteTextures(1, &colorTexture);
+        glDeleteRenderbuffers(1, &depthBuffer);
+    }
+    targetFramebuffer = colorTexture = depthBuffer = 0;
+}
+
+void DynamicResolution::resize(int width, int height) {
+    releaseTarget();
+    targetWidth = width;
+    targetHeight = height;
+
+    glGenFramebuffers(1, &targetFramebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, targetFramebuffer);
+    // Holds exactly what would have gone to the window, so a plain 8-bit target
+    glGenTextures(1, &colorTexture);
+    glState().bindTexture(GL_TEXTURE_2D, colorTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, colorTexture, 0);
+    glGenRenderbuffers(1, &depthBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthBuffer);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        std::cerr << "Dynamic resolution framebuffer is incomplete" << std::endl;
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, glState().defaultFramebuffer());
+}
+
+// Reads back finished timings oldest first, without waiting on any
+void DynamicResolution::collect() {
+    while (pending[oldest]) {
+        GLint available = 0;
+        glGetQueryObjectiv(queries[oldest], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) break;
+        GLuint64 nanoseconds = 0;
+        glGetQueryObjectui64v(queries[oldest], GL_QUERY_RESULT, &nanoseconds);
+        pending[oldest] = false;
+        oldest = (oldest + 1) % QUERY_COUNT;
+        lastGpuMs = (float)(nanoseconds * 1e-6);
+        control(lastGpuMs);
+    }
+}
+
+// One PID step per timing, in incremental (velocity) form: the output is a
+// change of scale made from the last three errors, with no stored integral,
+// so clamping the scale at its limits cannot wind anything up. The error is
+// the headroom left in the budget as a fraction of it, so the same gains
+// work for any budget.
+void DynamicResolution::control(float gpuMs) {
+    float error = (settings.budgetMs - gpuMs) / settings.budgetMs;
+    error = std::max(-1.0f, std::min(error, 1.0f));
+    if (!hasError) {
+        previousError = olderError = error;
+        hasError = true;
+    }
+
+    float change = settings.kp * (error - previousError) + settings.ki * error
+                 + settings.kd * (error - 2.0f * previousError + olderError);
+    olderError = previousError;
+    previousError = error;
+    controlScale = std::max(settings.minScale, std::min(controlScale + change, settings.maxScale));
+
+    // Snap to a step, and only leave the current one once the controller is
+    // more than three quarters of a step past it, so noise does not flip
+    // between two sizes
+    if (std::fabs(controlScale - appliedScale) > 0.75f * settings.step) {
+        float steps = std::floor((controlScale - settings.minScale) / settings.step + 0.5f);
+        appliedScale = std::min(settings.minScale + steps * settings.step, settings.maxScale);
+    }
+}
+
+void DynamicResolution::beginFrame(int width, int height) {
+    windowWidth = width;
+    windowHeight = height;
+    collect();
+    int renderWidth = std::max(1, (int)(width * appliedScale + 0.5f));
+    int renderHeight = std::max(1, (int)(height * appliedScale + 0.5f));
+    if (renderWidth != targetWidth || renderHeight != targetHeight || !targetFramebuffer) {
+        resize(renderWidth, renderHeight);
+    }
+
+    // GPU more than QUERY_COUNT frames behind: leave this frame untimed rather than wait
+    timing = !pending[next];
+    if (timing) glBeginQuery(GL_TIME_ELAPSED, queries[next]);
+}
+
+void DynamicResolution::bindTarget() {
+    glBindFramebuffer(GL_FRAMEBUFFER, targetFramebuffer);
+    glViewport(0, 0, targetWidth, targetHeight);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+}
+
+void DynamicResolution::endFrame() {
+    glBindFramebuffer(GL_FRAMEBUFFER, glState().defaultFramebuffer());
+    glViewport(0, 0, windowWidth, windowHeight);
+
+    // Sharpening grows as the scale drops; at full size the blit is a copy
+    float range = settings.maxScale - settings.minScale;
+    float amount = range > 0.0f ? settings.sharpness * (settings.maxScale - appliedScale) / range : 0.0f;
+    upscale->use();
+    upscale->setInt("scene", 0);
+    upscale->setFloat("sharpness", amount);
+    upscale->setVec2("outputSize", glm::vec2((float)windowWidth, (float)windowHeight));
+    glState().bindTextureUnit(0, GL_TEXTURE_2D, colorTexture);
+    glDisable(GL_DEPTH_TEST);
+    glState().bindVertexArray(emptyVAO);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    renderStats().countDraw(GL_TRIANGLES, 3);
+    glEnable(GL_DEPTH_TEST);
+
+    if (timing) {
+        glEndQuery(GL_TIME_ELAPSED);
+        pending[next] = true;
+        next = (next + 1) % QUERY_COUNT;
+        timing = false;
+    }
+}
@@ -0,0 +1,136 @@
+#include "frame_allocator.h"
+#include "gl_state.h"
+#include "render_stats.h"
+#include <algorithm>
+#include <iostream>
+
+static GLsizeiptr alignUp(GLsizeiptr value, GLsizeiptr alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+FrameAllocator::FrameAllocator()
+    : target(GL_ARRAY_BUFFER), name(0), persistent(false), allowPersistent(false), mapped(NULL), regionSize(0),
+      align(16), head(0), regionCount(0), region(0), stallCount(0) {
+    for (int i = 0; i < MAX_REGIONS; ++i) fences[i] = 0;
+}
+
+FrameAllocator::~FrameAllocator() {
+    release();
+}
+
+void FrameAllocator::init(GLenum newTarget, GLsizeiptr size, bool allowMapping, int regions) {
+    target = newTarget;
+    allowPersistent = allowMapping;
+    regionCount = std::max(1, std::min(regions, (int)MAX_REGIONS));
+    align = 16;
+    if (target == GL_UNIFORM_BUFFER) {
+        GLint uniformAlignment = 0;
+        glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &uniformAlignment);
+        align = std::max<GLsizeiptr>(align, uniformAlignment);
+    }
+    regionSize = alignUp(size, align);
+    create();
+    std::cout << "Per-frame buffer: " << regionCount << " x " << regionSize / 1024 << " KB, "
+              << (persistent ? "persistently mapped" : "orphaned each frame") << std::endl;
+}
+
+void FrameAllocator::create() {
+    persistent = allowPersistent && (GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage);
+    glGenBuffers(1, &name);
+    glBindBuffer(target, name);
+    if (persistent) {
+        const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(target, regionSize * regionCount, NULL, flags);
+        mapped = (char*)glMapBufferRange(target, 0, regionSize * regionCount, flags);
+        if (!mapped) {
+            std::cerr << "Persistent mapping failed; orphaning the per-frame buffer instead" << std::endl;
+            glDeleteBuffers(1, &name);
+            glGenBuffers(1, &name);
+            glBindBuffer(target, name);
+            persistent = false;
+        }
+    }
+    if (!persistent) {
+        // One region's worth is enough: every frame gets a fresh store
+        glBufferData(target, regionSize, NULL, GL_STREAM_DRAW);
+        staging.resize(regionSize);
+    }
+    region = 0;
+    head = 0;
+}
+
+void FrameAllocator::release() {
+    for (int i = 0; i < MAX_REGIONS; ++i) {
+        if (fences[i]) glDeleteSync(fences[i]);
+        fences[i] = 0;
+    }
+    if (name) {
+        glState().forgetBuffer(name);
+        if (mapped) {
+            glBindBuffer(target, name);
+            glUnmapBuffer(target);
+        }
+        glDeleteBuffers(1, &name);
+    }
+    name = 0;
+    mapped = NULL;
+    staging.clear();
+}
+
+void FrameAllocator::waitFor(int index) {
+    GLsync fence = fences[index];
+    if (!fence) return;
+    GLenum result = glClientWaitSync(fence, 0, 0);
+    if (result == GL_TIMEOUT_EXPIRED) {
+        ++stallCount;
+        do {
+            result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000); // 1 ms at a time
+        } while (result == GL_TIMEOUT_EXPIRED);
+    }
+    glDeleteSync(fence);
+    fences[index] = 0;
+}
+
+void FrameAllocator::beginFrame() {
+    region = (region + 1) % regionCount;
+    head = 0;
+    if (persistent) waitFor(region);
+}
+
+void FrameAllocator::reserve(GLsizeiptr size) {
+    if (size <= regionSize) return;
+    for (int i = 0; i < regionCount; ++i) waitFor(i);
+    release();
+    regionSize = alignUp(std::max(size, regionSize * 2), align);
+    create();
+    std::cout << "Per-frame buffer grown to " << regionSize / 1024 << " KB a frame" << std::endl;
+}
+
+FrameAllocator::Allocation FrameAllocator::allocate(GLsizeiptr size) {
+    Allocation allocation = { NULL, 0 };
+    GLsizeiptr start = alignUp(head, align);
+    if (!name || start + size > regionSize) return allocation;
+    head = start + size;
+    if (persistent) {
+        allocation.offset = region * regionSize + start;
+        allocation.data = mapped + allocation.offset;
+    } else {
+        allocation.offset = start;
+        allocation.data = &staging[start];
+    }
+    return allocation;
+}
+
+void FrameAllocator::flush() {
+    renderStats().countBufferUpload(head);
+    if (persistent || head == 0) return;
+    glBindBuffer(target, name);
+    glBufferData(target, regionSize, NULL, GL_STREAM_DRAW);
+    glBufferSubData(target, 0, head, &staging[0]);
+}
+
+void FrameAllocator::endFrame() {
+    if (!persistent) return;
+    if (fences[region]) glDeleteSync(fences[region]);
+    fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
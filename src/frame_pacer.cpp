@@ -0,0 +1,81 @@
+#include "frame_pacer.h"
+#include <GLFW/glfw3.h>
+#include <algorithm>
+#include <iostream>
+#include <thread>
+
+// Bounds on the spin; the margin grows to the worst oversleep seen and decays slowly
+static const std::chrono::microseconds MIN_SPIN_MARGIN(200);
+static const std::chrono::microseconds MAX_SPIN_MARGIN(4000);
+
+static float toMs(std::chrono::steady_clock::duration duration) {
+    return std::chrono::duration<float, std::milli>(duration).count();
+}
+
+FramePacer::FramePacer()
+    : interval(SWAP_VSYNC), period(Clock::duration::zero()), spinMargin(std::chrono::microseconds(1000)),
+      started(false), sampled(false), latencyMs(-1.0f), lastFrameMs(0.0f), lastWaitMs(0.0f) {}
+
+void FramePacer::init(int swapInterval, float fpsLimit) {
+    interval = swapInterval;
+    if (interval == SWAP_ADAPTIVE && !glfwExtensionSupported("GLX_EXT_swap_control_tear")
+        && !glfwExtensionSupported("WGL_EXT_swap_control_tear")) {
+        std::cerr << "Adaptive vsync is not supported; using vsync" << std::endl;
+        interval = SWAP_VSYNC;
+    }
+    glfwSwapInterval(interval);
+
+    period = Clock::duration::zero();
+    if (fpsLimit > 0.0f) {
+        period = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / fpsLimit));
+    }
+    std::cout << "Frame pacing: "
+              << (interval == SWAP_UNCAPPED ? "uncapped" : interval == SWAP_ADAPTIVE ? "adaptive vsync" : "vsync");
+    if (fpsLimit > 0.0f) std::cout << ", limited to " << fpsLimit << " fps";
+    std::cout << std::endl;
+}
+
+void FramePacer::waitForFrame() {
+    Clock::time_point now = Clock::now();
+    lastWaitMs = 0.0f;
+    if (period == Clock::duration::zero()) return;
+    if (!started || now - deadline > period) {
+        // First frame, or a frame long enough to miss a whole slot: restart
+        // the schedule from now instead of rushing frames out to catch up
+        deadline = now + period;
+        started = true;
+        return;
+    }
+
+    Clock::time_point begin = now;
+    Clock::time_point wake = deadline - spinMargin;
+    if (now < wake) {
+        std::this_thread::sleep_for(wake - now);
+        now = Clock::now();
+        Clock::duration oversleep = now - wake;
+        if (oversleep > spinMargin) {
+            spinMargin = std::min<Clock::duration>(oversleep + oversleep / 4, MAX_SPIN_MARGIN);
+        } else {
+            spinMargin = std::max<Clock::duration>(spinMargin - spinMargin / 64, MIN_SPIN_MARGIN);
+        }
+    }
+    while (now < deadline) {
+        std::this_thread::yield();
+        now = Clock::now();
+    }
+    lastWaitMs = toMs(now - begin);
+    deadline += period;
+}
+
+void FramePacer::inputSampled() {
+    inputTime = Clock::now();
+    sampled = true;
+}
+
+void FramePacer::frameSwapped() {
+    Clock::time_point now = Clock::now();
+    if (sampled) latencyMs = toMs(now - inputTime);
+    if (lastSwap != Clock::time_point()) lastFrameMs = toMs(now - lastSwap);
+    lastSwap = now;
+    sampled = false;
+}
@@ -0,0 +1,37 @@
+#include "frame_stats.h"
+#include "render_stats.h"
+
+void printFrameStats(std::ostream& out, const FrameStats& stats) {
+    // Closed together with the draw and upload counts of the same frame
+    const GLStateCache::Counters& counters = renderStats().lastStateCache();
+    out << (stats.deferredShading ? "Deferred" : "Forward") << " shading; "
+        << "cells: " << stats.cellsVisible << "/" << stats.cellCount << " visible, "
+        << stats.portalsTested << " portals tested; "
+        << "culling: paintings " << stats.paintingsVisible << " visible / " << stats.paintingsCulled << " culled ("
+        << stats.paintingsOccluded << " occluded, LOD " << stats.paintingLODs[0] << "/"
+        << stats.paintingLODs[1] << "/" << stats.paintingLODs[2] << "), "
+        << "surfaces " << stats.surfacesVisible << " visible / " << stats.surfacesCulled << " culled, "
+        << stats.occlusionQueries << " occlusion queries; "
+        << "lights: " << stats.lightsInView << " in view, " << stats.lightIndices << " cluster entries, max "
+        << stats.maxClusterLights << " per cluster; ";
+    if (stats.shadowsEnabled) {
+        out << "shadows: static map " << (stats.shadowMapRendered ? "rendered" : "cached") << " ("
+            << stats.shadowMapRenders << " renders), " << stats.shadowCasters << " dynamic casters; ";
+    }
+    out << "depth pre-pass: " << (stats.depthPrepass ? "on" : "off");
+    if (stats.depthPrepass) out << " (" << stats.prepassDraws << " draws)";
+    if (stats.shadedCounted) {
+        out << ", lit pass shaded " << stats.shadedSamples << " samples (" << stats.samplesPerPixel << " per pixel)";
+    }
+    if (stats.dynamicResolution) {
+        out << "; resolution " << stats.renderWidth << "x" << stats.renderHeight << " (scale " << stats.renderScale
+            << ", GPU " << stats.gpuFrameMs << " ms)";
+    }
+    out << "; per-frame data: " << stats.frameDataBytes << " bytes, " << stats.frameDataStalls << " stalls";
+    out << "; frame " << stats.frameMs << " ms ("
+        << (stats.swapInterval == 0 ? "uncapped" : stats.swapInterval < 0 ? "adaptive vsync" : "vsync");
+    if (stats.limiterWaitMs > 0.0f) out << ", limiter waited " << stats.limiterWaitMs << " ms";
+    out << "), input to swap " << stats.inputLatencyMs << " ms";
+    out << "; GL state cache: " << counters.totalIssued() << " issued, " << counters.totalSkipped() << " skipped"
+        << std::endl;
+}
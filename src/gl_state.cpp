@@ -0,0 +1,249 @@
+#include "gl_state.h"
+#include <cstring>
+
+unsigned int GLStateCache::Counters::totalIssued() const {
+    unsigned int total = 0;
+    for (int i = 0; i < CATEGORY_COUNT; ++i) total += issued[i];
+    return total;
+}
+
+unsigned int GLStateCache::Counters::totalSkipped() const {
+    unsigned int total = 0;
+    for (int i = 0; i < CATEGORY_COUNT; ++i) total += skipped[i];
+    return total;
+}
+
+GLStateCache::GLStateCache() : windowFramebuffer(0), frames(0) {
+    std::memset(&current, 0, sizeof(current));
+    invalidate();
+}
+
+int GLStateCache::targetSlot(GLenum target) {
+    switch (target) {
+        case GL_TEXTURE_2D:       return 0;
+        case GL_TEXTURE_2D_ARRAY: return 1;
+        case GL_TEXTURE_3D:       return 2;
+        case GL_TEXTURE_BUFFER:   return 3;
+        case GL_TEXTURE_CUBE_MAP: return 4;
+        default:                  return -1;
+    }
+}
+
+void GLStateCache::count(Category category, bool issued) {
+    if (issued) current.issued[category]++;
+    else current.skipped[category]++;
+}
+
+bool GLStateCache::useProgram(GLuint id) {
+    bool issue = (program != id);
+    if (issue) {
+        glUseProgram(id);
+        program = id;
+    }
+    count(PROGRAM, issue);
+    return issue;
+}
+
+bool GLStateCache::bindVertexArray(GLuint vao) {
+    bool issue = (vertexArray != vao);
+    if (issue) {
+        glBindVertexArray(vao);
+        vertexArray = vao;
+    }
+    count(VERTEX_ARRAY, issue);
+    return issue;
+}
+
+bool GLStateCache::activeTexture(GLuint unit) {
+    bool issue = (activeUnit != unit);
+    if (issue) {
+        glActiveTexture(GL_TEXTURE0 + unit);
+        activeUnit = unit;
+    }
+    count(ACTIVE_TEXTURE, issue);
+    return issue;
+}
+
+bool GLStateCache::bindTexture(GLenum target, GLuint texture) {
+    int slot = targetSlot(target);
+    if (slot < 0 || activeUnit >= (GLuint)MAX_TEXTURE_UNITS) {
+        // Untracked target or unit: always issue
+        glBindTexture(target, texture);
+        count(TEXTURE, true);
+        return true;
+    }
+
+    bool issue = (textures[activeUnit][slot] != texture);
+    if (issue) {
+        glBindTexture(target, texture);
+        textures[activeUnit][slot] = texture;
+    }
+    count(TEXTURE, issue);
+    return issue;
+}
+
+bool GLStateCache::bindTextureUnit(GLuint unit, GLenum target, GLuint texture) {
+    int slot = targetSlot(target);
+    if (slot >= 0 && unit < (GLuint)MAX_TEXTURE_UNITS && textures[unit][slot] == texture) {
+        // Already bound on that unit; no need to switch the active unit either
+        count(TEXTURE, false);
+        return false;
+    }
+    activeTexture(unit);
+    return bindTexture(target, texture);
+}
+
+bool GLStateCache::bindUniformBufferRange(GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size) {
+    if (index >= (GLuint)MAX_UNIFORM_BUFFERS) {
+        glBindBufferRange(GL_UNIFORM_BUFFER, index, buffer, offset, size);
+        count(BUFFER_RANGE, true);
+        return true;
+    }
+    BufferRange& range = uniformBuffers[index];
+    bool issue = range.buffer != buffer || range.offset != offset || range.size != size;
+    if (issue) {
+        glBindBufferRange(GL_UNIFORM_BUFFER, index, buffer, offset, size);
+        range.buffer = buffer;
+        range.offset = offset;
+        range.size = size;
+    }
+    count(BUFFER_RANGE, issue);
+    return issue;
+}
+
+bool GLStateCache::uniformChanged(GLuint id, GLint location, const float* data, int size) {
+    UniformValue& value = uniforms[id][location];
+    if (value.size == size && std::memcmp(value.data, data, size * sizeof(float)) == 0) {
+        return false;
+    }
+    value.size = size;
+    std::memcpy(value.data, data, size * sizeof(float));
+    return true;
+}
+
+bool GLStateCache::uniform1i(GLuint id, GLint location, int value) {
+    if (location < 0) return false;
+    float bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    bool issue = uniformChanged(id, location, &bits, 1);
+    if (issue) {
+        useProgram(id);
+        glUniform1i(location, value);
+    }
+    count(UNIFORM, issue);
+    return issue;
+}
+
+bool GLStateCache::uniform1f(GLuint id, GLint location, float value) {
+    if (location < 0) return false;
+    bool issue = uniformChanged(id, location, &value, 1);
+    if (issue) {
+        useProgram(id);
+        glUniform1f(location, value);
+    }
+    count(UNIFORM, issue);
+    return issue;
+}
+
+bool GLStateCache::uniform2fv(GLuint id, GLint location, const float* value) {
+    if (location < 0) return false;
+    bool issue = uniformChanged(id, location, value, 2);
+    if (issue) {
+        useProgram(id);
+        glUniform2fv(location, 1, value);
+    }
+    count(UNIFORM, issue);
+    return issue;
+}
+
+bool GLStateCache::uniform3fv(GLuint id, GLint location, const float* value) {
+    if (location < 0) return false;
+    bool issue = uniformChanged(id, location, value, 3);
+    if (issue) {
+        useProgram(id);
+        glUniform3fv(location, 1, value);
+    }
+    count(UNIFORM, issue);
+    return issue;
+}
+
+bool GLStateCache::uniform4fv(GLuint id, GLint location, const float* value) {
+    if (location < 0) return false;
+    bool issue = uniformChanged(id, location, value, 4);
+    if (issue) {
+        useProgram(id);
+        glUniform4fv(location, 1, value);
+    }
+    count(UNIFORM, issue);
+    return issue;
+}
+
+bool GLStateCache::uniformMatrix3fv(GLuint id, GLint location, const float* value) {
+    if (location < 0) return false;
+    bool issue = uniformChanged(id, location, value, 9);
+    if (issue) {
+        useProgram(id);
+        glUniformMatrix3fv(location, 1, GL_FALSE, value);
+    }
+    count(UNIFORM, issue);
+    return issue;
+}
+
+bool GLStateCache::uniformMatrix4fv(GLuint id, GLint location, const float* value) {
+    if (location < 0) return false;
+    bool issue = uniformChanged(id, location, value, 16);
+    if (issue) {
+        useProgram(id);
+        glUniformMatrix4fv(location, 1, GL_FALSE, value);
+    }
+    count(UNIFORM, issue);
+    return issue;
+}
+
+void GLStateCache::forgetProgram(GLuint id) {
+    uniforms.erase(id);
+    if (program == id) program = UNKNOWN;
+}
+
+void GLStateCache::forgetVertexArray(GLuint vao) {
+    if (vertexArray == vao) vertexArray = UNKNOWN;
+}
+
+void GLStateCache::forgetTexture(GLuint texture) {
+    for (int unit = 0; unit < MAX_TEXTURE_UNITS; ++unit) {
+        for (int slot = 0; slot < TARGET_COUNT; ++slot) {
+            if (textures[unit][slot] == texture) textures[unit][slot] = UNKNOWN;
+        }
+    }
+}
+
+void GLStateCache::forgetBuffer(GLuint buffer) {
+    for (int index = 0; index < MAX_UNIFORM_BUFFERS; ++index) {
+        if (uniformBuffers[index].buffer == buffer) uniformBuffers[index].buffer = UNKNOWN;
+    }
+}
+
+void GLStateCache::invalidate() {
+    program = UNKNOWN;
+    vertexArray = UNKNOWN;
+    activeUnit = UNKNOWN;
+    for (int unit = 0; unit < MAX_TEXTURE_UNITS; ++unit) {
+        for (int slot = 0; slot < TARGET_COUNT; ++slot) {
+            textures[unit][slot] = UNKNOWN;
+        }
+    }
+    for (int index = 0; index < MAX_UNIFORM_BUFFERS; ++index) {
+        uniformBuffers[index].buffer = UNKNOWN;
+    }
+    // Uniform values live in the program objects and survive rebinding
+}
+
+void GLStateCache::beginFrame() {
+    std::memset(&current, 0, sizeof(current));
+    frames++;
+}
+
+GLStateCache& glState() {
+    static GLStateCache cache;
+    return cache;
+}
@@ -0,0 +1,120 @@
+#include "gpu_profiler.h"
+#include <iomanip>
+
+GpuProfiler::GpuProfiler()
+    : enabled(false), current(0), recording(false), depth(0), frameNumber(0), lateBy(0), skipped(0) {
+    for (int i = 0; i < FRAME_COUNT; ++i) {
+        frames[i].used = 0;
+        frames[i].pending = false;
+        frames[i].number = 0;
+    }
+}
+
+GpuProfiler::~GpuProfiler() {
+    for (int i = 0; i < FRAME_COUNT; ++i) {
+        if (!frames[i].queries.empty()) glDeleteQueries((GLsizei)frames[i].queries.size(), &frames[i].queries[0]);
+    }
+}
+
+void GpuProfiler::init() {
+    // Timestamp queries are core in 3.3; a zero-bit counter means the driver has none
+    GLint bits = 0;
+    glGetQueryiv(GL_TIMESTAMP, GL_QUERY_COUNTER_BITS, &bits);
+    enabled = bits > 0;
+}
+
+bool GpuProfiler::collect(Frame& frame) {
+    GLint available = 0;
+    glGetQueryObjectiv(frame.queries[frame.used - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+    if (!available) return false;
+
+    // Counters complete in order, so the last being back means all are
+    latest.resize(frame.scopes.size());
+    for (size_t i = 0; i < frame.scopes.size(); ++i) {
+        const Scope& scope = frame.scopes[i];
+        GLuint64 begin = 0, end = 0;
+        glGetQueryObjectui64v(frame.queries[scope.firstQuery], GL_QUERY_RESULT, &begin);
+        glGetQueryObjectui64v(frame.queries[scope.firstQuery + 1], GL_QUERY_RESULT, &end);
+        Timing& timing = latest[i];
+        timing.name = scope.name;
+        timing.depth = scope.depth;
+        timing.gpuMs = end > begin ? (end - begin) / 1.0e6f : 0.0f;
+        timing.cpuMs = std::chrono::duration<float, std::milli>(scope.cpuEnd - scope.cpuBegin).count();
+    }
+    lateBy = (unsigned int)(frameNumber - frame.number);
+    frame.pending = false;
+    return true;
+}
+
+void GpuProfiler::beginFrame() {
+    if (!enabled) return;
+    ++frameNumber;
+    // Oldest first, stopping at the first frame still in flight
+    for (int k = 1; k <= FRAME_COUNT; ++k) {
+        Frame& frame = frames[(current + k) % FRAME_COUNT];
+        if (frame.pending && !collect(frame)) break;
+    }
+
+    current = (current + 1) % FRAME_COUNT;
+    Frame& frame = frames[current];
+    recording = !frame.pending;
+    if (!recording) {
+        ++skipped;
+        return;
+    }
+    frame.used = 0;
+    frame.scopes.clear();
+    frame.number = frameNumber;
+    depth = 0;
+}
+
+void GpuProfiler::endFrame() {
+    if (!recording) return;
+    Frame& frame = frames[current];
+    frame.pending = frame.used > 0;
+    recording = false;
+}
+
+int GpuProfiler::begin(const char* name) {
+    if (!recording) return -1;
+    Frame& frame = frames[current];
+    if (frame.used + 2 > frame.queries.size()) {
+        size_t count = frame.queries.size();
+        frame.queries.resize(count + 16);
+        glGenQueries(16, &frame.queries[count]);
+    }
+
+    Scope scope;
+    scope.name = name;
+    scope.depth = depth++;
+    scope.firstQuery = frame.used;
+    scope.cpuBegin = Clock::now();
+    frame.used += 2;
+    glQueryCounter(frame.queries[scope.firstQuery], GL_TIMESTAMP);
+    frame.scopes.push_back(scope);
+    return (int)frame.scopes.size() - 1;
+}
+
+void GpuProfiler::end(int index) {
+    if (!recording || index < 0) return;
+    Frame& frame = frames[current];
+    Scope& scope = frame.scopes[index];
+    glQueryCounter(frame.queries[scope.firstQuery + 1], GL_TIMESTAMP);
+    scope.cpuEnd = Clock::now();
+    --depth;
+}
+
+void GpuProfiler::print(std::ostream& out) const {
+    std::ios::fmtflags flags = out.flags();
+    std::streamsize precision = out.precision();
+    out << std::fixed << std::setprecision(3) << "Passes (GPU/CPU ms, " << lateBy << " frames late):";
+    for (size_t i = 0; i < latest.size(); ++i) {
+        out << (i ? ", " : " ");
+        for (int d = 0; d < latest[i].depth; ++d) out << "-";
+        out << latest[i].name << " " << latest[i].gpuMs << "/" << latest[i].cpuMs;
+    }
+    if (skipped) out << "; " << skipped << " frames skipped";
+    out << std::endl;
+    out.flags(flags);
+    out.precision(precision);
+}
@@ -0,0 +1,153 @@
+#include "indirect_renderer.h"
+#include "gl_state.h"
+#include "render_stats.h"
+#include <cstring>
+
+// The shaders are GLSL 4.30 and the per-draw stream relies on baseInstance,
+// so the multi-draw extension alone on an older context is not enough
+bool IndirectRenderer::isSupported() {
+    return GLEW_VERSION_4_3 != 0;
+}
+
+IndirectRenderer::IndirectRenderer()
+    : VAO(0), depthVAO(0), commandBuffer(0), drawDataBuffer(0), indexType(GL_UNSIGNED_INT), dirty(false),
+      triangles(0) {}
+
+IndirectRenderer::~IndirectRenderer() {
+    release();
+}
+
+void IndirectRenderer::release() {
+    if (VAO) {
+        glState().forgetVertexArray(VAO);
+        glDeleteVertexArrays(1, &VAO);
+        glState().forgetVertexArray(depthVAO);
+        glDeleteVertexArrays(1, &depthVAO);
+        glDeleteBuffers(1, &commandBuffer);
+        glDeleteBuffers(1, &drawDataBuffer);
+    }
+    VAO = depthVAO = commandBuffer = drawDataBuffer = 0;
+}
+
+void IndirectRenderer::setMesh(const StaticMesh& mesh) {
+    release();
+    indexType = mesh.getIndexType();
+
+    glGenVertexArrays(1, &VAO);
+    glGenBuffers(1, &commandBuffer);
+    glGenBuffers(1, &drawDataBuffer);
+
+    glState().bindVertexArray(VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, mesh.getVertexBuffer());
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.getIndexBuffer());
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, position));
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, normal));
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, texCoords));
+    glEnableVertexAttribArray(2);
+    glVertexAttribPointer(12, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, lightmapUV));
+    glEnableVertexAttribArray(12);
+
+    // Per-draw stream: model at 3-6, params at 7, normal matrix at 8-10
+    glBindBuffer(GL_ARRAY_BUFFER, drawDataBuffer);
+    for (int column = 0; column < 4; ++column) {
+        glVertexAttribPointer(3 + column, 4, GL_FLOAT, GL_FALSE, sizeof(DrawData),
+                              (void*)(offsetof(DrawData, model) + column * 4 * sizeof(float)));
+        glEnableVertexAttribArray(3 + column);
+        glVertexAttribDivisor(3 + column, 1);
+    }
+    glVertexAttribPointer(7, 4, GL_FLOAT, GL_FALSE, sizeof(DrawData), (void*)offsetof(DrawData, params));
+    glEnableVertexAttribArray(7);
+    glVertexAttribDivisor(7, 1);
+    for (int column = 0; column < 3; ++column) {
+        glVertexAttribPointer(8 + column, 3, GL_FLOAT, GL_FALSE, sizeof(DrawData),
+                              (void*)(offsetof(DrawData, normal) + column * 4 * sizeof(float)));
+        glEnableVertexAttribArray(8 + column);
+        glVertexAttribDivisor(8 + column, 1);
+    }
+
+    // Positions and model matrices only
+    glGenVertexArrays(1, &depthVAO);
+    glState().bindVertexArray(depthVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, mesh.getPositionBuffer());
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.getIndexBuffer());
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (void*)0);
+    glEnableVertexAttribArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, drawDataBuffer);
+    for (int column = 0; column < 4; ++column) {
+        glVertexAttribPointer(3 + column, 4, GL_FLOAT, GL_FALSE, sizeof(DrawData),
+                              (void*)(offsetof(DrawData, model) + column * 4 * sizeof(float)));
+        glEnableVertexAttribArray(3 + column);
+        glVertexAttribDivisor(3 + column, 1);
+    }
+    dirty = true;
+}
+
+void IndirectRenderer::clear() {
+    commands.clear();
+    drawData.clear();
+    triangles = 0;
+    dirty = true;
+}
+
+void IndirectRenderer::add(const SubMesh& subMesh, const Transform& transform, int layer) {
+    DrawElementsIndirectCommand cmd;
+    cmd.count = (GLuint)subMesh.indexCount;
+    cmd.instanceCount = 1;
+    cmd.firstIndex = subMesh.firstIndex;
+    cmd.baseVertex = 0;
+    cmd.baseInstance = (GLuint)drawData.size(); // selects this draw's record in the per-draw stream
+    commands.push_back(cmd);
+    triangles += subMesh.indexCount / 3;
+
+    DrawData data;
+    const glm::mat4& model = transform.getModelMatrix();
+    const glm::mat3& normal = transform.getNormalMatrix();
+    std::memcpy(data.model, &model[0][0], sizeof(data.model));
+    for (int column = 0; column < 3; ++column) {
+        data.normal[column * 4 + 0] = normal[column][0];
+        data.normal[column * 4 + 1] = normal[column][1];
+        data.normal[column * 4 + 2] = normal[column][2];
+        data.normal[column * 4 + 3] = 0.0f;
+    }
+    data.params[0] = (float)layer;
+    data.params[1] = data.params[2] = data.params[3] = 0.0f;
+    drawData.push_back(data);
+    dirty = true;
+}
+
+void IndirectRenderer::upload() {
+    if (!dirty) return;
+    glBindBuffer(GL_ARRAY_BUFFER, drawDataBuffer);
+    glBufferData(GL_ARRAY_BUFFER, drawData.size() * sizeof(DrawData), &drawData[0], GL_STATIC_DRAW);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+    glBufferData(GL_DRAW_INDIRECT_BUFFER, commands.size() * sizeof(DrawElementsIndirectCommand), &commands[0], GL_STATIC_DRAW);
+    renderStats().countBufferUpload(drawData.size() * sizeof(DrawData)
+                                    + commands.size() * sizeof(DrawElementsIndirectCommand));
+    dirty = false;
+}
+
+void IndirectRenderer::submit(Shader& shader, GLuint textureArray) {
+    if (commands.empty() || !VAO) return;
+    upload();
+
+    shader.use();
+    shader.setInt("materials", 0);
+    glState().bindVertexArray(VAO);
+    glState().bindTextureUnit(0, GL_TEXTURE_2D_ARRAY, textureArray);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+    glMultiDrawElementsIndirect(GL_TRIANGLES, indexType, (void*)0, (GLsizei)commands.size(), 0);
+    renderStats().countMultiDraw(triangles);
+}
+
+void IndirectRenderer::submitDepth(Shader& shader) {
+    if (commands.empty() || !depthVAO) return;
+    upload();
+
+    shader.use();
+    glState().bindVertexArray(depthVAO);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+    glMultiDrawElementsIndirect(GL_TRIANGLES, indexType, (void*)0, (GLsizei)commands.size(), 0);
+    renderStats().countMultiDraw(triangles);
+}
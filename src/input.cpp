@@ -0,0 +1,158 @@
+#include "input.h"
+#include <cstring>
+#include <iostream>
+
+// Log layout, little-endian: "AGIN", a 16-bit version and the recording's
+// fixed frame time in seconds as a 32-bit float, then events of a 32-bit
+// microsecond time and a type byte followed by either a 16-bit key and a
+// pressed byte, or the cursor's x and y as 32-bit floats
+static const char LOG_MAGIC[4] = {'A', 'G', 'I', 'N'};
+static const unsigned int LOG_VERSION = 1;
+
+static void writeBytes(std::ostream& out, unsigned int value, int bytes) {
+    for (int i = 0; i < bytes; ++i) out.put((char)((value >> (8 * i)) & 0xFF));
+}
+
+static bool readBytes(std::istream& in, unsigned int& value, int bytes) {
+    value = 0;
+    for (int i = 0; i < bytes; ++i) {
+        int c = in.get();
+        if (c == EOF) return false;
+        value |= (unsigned int)(c & 0xFF) << (8 * i);
+    }
+    return true;
+}
+
+static unsigned int floatBits(float value) {
+    unsigned int bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+static float bitsFloat(unsigned int bits) {
+    float value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+Input::Input() : started(false), origin(0.0), replaying(false), logStep(0.0f), nextEvent(0) {
+    std::memset(keys, 0, sizeof(keys));
+}
+
+void Input::attach(GLFWwindow* window) {
+    glfwSetWindowUserPointer(window, this);
+    glfwSetKeyCallback(window, keyCallback);
+    glfwSetCursorPosCallback(window, cursorCallback);
+}
+
+bool Input::startRecording(const char* path, float stepSeconds) {
+    recording.open(path, std::ios::binary);
+    if (!recording) {
+        std::cerr << "Cannot write input log " << path << std::endl;
+        return false;
+    }
+    recording.write(LOG_MAGIC, sizeof(LOG_MAGIC));
+    writeBytes(recording, LOG_VERSION, 2);
+    writeBytes(recording, floatBits(stepSeconds), 4);
+    std::cout << "Recording input to " << path << std::endl;
+    return true;
+}
+
+bool Input::startReplay(const char* path) {
+    std::ifstream in(path, std::ios::binary);
+    char magic[sizeof(LOG_MAGIC)];
+    unsigned int version = 0, step = 0;
+    if (!in.read(magic, sizeof(magic)) || std::memcmp(magic, LOG_MAGIC, sizeof(magic)) != 0
+        || !readBytes(in, version, 2) || version != LOG_VERSION || !readBytes(in, step, 4)) {
+        std::cerr << "Not an input log: " << path << std::endl;
+        return false;
+    }
+    logStep = bitsFloat(step);
+
+    replayEvents.clear();
+    for (;;) {
+        Event event;
+        unsigned int type = 0;
+        if (!readBytes(in, event.timeUs, 4)) break;
+        if (!readBytes(in, type, 1)) return false;
+        event.type = (EventType)type;
+        event.key = 0;
+        event.pressed = false;
+        event.x = event.y = 0.0f;
+        unsigned int a = 0, b = 0;
+        if (type == KEY_EVENT && readBytes(in, a, 2) && readBytes(in, b, 1)) {
+            event.key = (int)a;
+            event.pressed = b != 0;
+        } else if (type == CURSOR_EVENT && readBytes(in, a, 4) && readBytes(in, b, 4)) {
+            event.x = bitsFloat(a);
+            event.y = bitsFloat(b);
+        } else {
+            std::cerr << "Input log is truncated or corrupt after " << replayEvents.size() << " events" << std::endl;
+            return false;
+        }
+        replayEvents.push_back(event);
+    }
+    replaying = true;
+    nextEvent = 0;
+    std::cout << "Replaying " << replayEvents.size() << " input events from " << path << std::endl;
+    return true;
+}
+
+void Input::update(double time) {
+    if (!started) {
+        origin = time;
+        started = true;
+    }
+    // Rounded so the recorded time of an event is exactly the frame time it was applied on
+    unsigned int now = (unsigned int)((time - origin) * 1.0e6 + 0.5);
+    cursor.clear();
+
+    if (replaying) {
+        while (nextEvent < replayEvents.size() && replayEvents[nextEvent].timeUs <= now) {
+            apply(replayEvents[nextEvent++]);
+        }
+        return;
+    }
+    for (size_t i = 0; i < pending.size(); ++i) {
+        pending[i].timeUs = now;
+        apply(pending[i]);
+        if (recording.is_open()) writeEvent(pending[i]);
+    }
+    pending.clear();
+}
+
+void Input::apply(const Event& event) {
+    if (event.type == KEY_EVENT) {
+        if (event.key >= 0 && event.key < KEY_COUNT) keys[event.key] = event.pressed;
+    } else {
+        CursorPosition position = {event.x, event.y};
+        cursor.push_back(position);
+    }
+}
+
+void Input::writeEvent(const Event& event) {
+    writeBytes(recording, event.timeUs, 4);
+    writeBytes(recording, (unsigned int)event.type, 1);
+    if (event.type == KEY_EVENT) {
+        writeBytes(recording, (unsigned int)event.key, 2);
+        writeBytes(recording, event.pressed ? 1 : 0, 1);
+    } else {
+        writeBytes(recording, floatBits(event.x), 4);
+        writeBytes(recording, floatBits(event.y), 4);
+    }
+}
+
+void Input::keyCallback(GLFWwindow* window, int key, int, int action, int) {
+    Input* input = (Input*)glfwGetWindowUserPointer(window);
+    // Repeats change nothing; unknown keys arrive as -1
+    if (input->replaying || action == GLFW_REPEAT || key < 0 || key >= KEY_COUNT) return;
+    Event event = {0, KEY_EVENT, key, action == GLFW_PRESS, 0.0f, 0.0f};
+    input->pending.push_back(event);
+}
+
+void Input::cursorCallback(GLFWwindow* window, double x, double y) {
+    Input* input = (Input*)glfwGetWindowUserPointer(window);
+    if (input->replaying) return;
+    Event event = {0, CURSOR_EVENT, 0, false, (float)x, (float)y};
+    input->pending.push_back(event);
+}
@@ -0,0 +1,863 @@
+#include "lightmap.h"
+#include "gl_state.h"
+#include "render_stats.h"
+#include "stb_image.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <unordered_map>
+
+namespace {
+
+const int CHART_PADDING = 2; // texels around each chart, filled by dilation after the bake
+
+struct Chart {
+    glm::vec3 normal;
+    float plane;
+    glm::vec3 axisU, axisV;
+    glm::vec2 boundsMin, boundsMax; // in the plane, world units
+    std::vector<GLuint> triangles;  // first index of each triangle
+    int x, y;                       // atlas corner, padding included
+};
+
+// Shelf packing, tallest charts first
+bool packCharts(std::vector<Chart>& charts, int size, float density) {
+    std::vector<size_t> order(charts.size());
+    std::vector<int> widths(charts.size()), heights(charts.size());
+    for (size_t i = 0; i < charts.size(); ++i) {
+        glm::vec2 extent = (charts[i].boundsMax - charts[i].boundsMin) * density;
+        widths[i] = (int)std::ceil(extent.x) + 2 * CHART_PADDING;
+        heights[i] = (int)std::ceil(extent.y) + 2 * CHART_PADDING;
+        order[i] = i;
+    }
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b) { return heights[a] > heights[b]; });
+
+    int shelfX = 0, shelfY = 0, shelfHeight = 0;
+    for (size_t i = 0; i < order.size(); ++i) {
+        size_t c = order[i];
+        if (widths[c] > size) return false;
+        if (shelfX + widths[c] > size) {
+            shelfY += shelfHeight;
+            shelfX = 0;
+            shelfHeight = 0;
+        }
+        if (shelfY + heights[c] > size) return false;
+        charts[c].x = shelfX;
+        charts[c].y = shelfY;
+        shelfX += widths[c];
+        shelfHeight = std::max(shelfHeight, heights[c]);
+    }
+    return true;
+}
+
+float smoothStep(float edge0, float edge1, float x) {
+    float t = glm::clamp((x - edge0) / (edge1 - edge0), 0.0f, 1.0f);
+    return t * t * (3.0f - 2.0f * t);
+}
+
+float cross2(const glm::vec2& a, const glm::vec2& b) {
+    return a.x * b.y - a.y * b.x;
+}
+
+glm::vec2 closestOnSegment(const glm::vec2& p, const glm::vec2& a, const glm::vec2& b) {
+    glm::vec2 ab = b - a;
+    float t = glm::clamp(glm::dot(p - a, ab) / std::max(glm::dot(ab, ab), 1e-12f), 0.0f, 1.0f);
+    return a + ab * t;
+}
+
+// Barycentric weights of p in triangle uv, scaled by twice its signed area
+glm::vec3 barycentric(const glm::vec2& p, const glm::vec2 uv[3], float area) {
+    return glm::vec3(cross2(uv[1] - p, uv[2] - p), cross2(uv[2] - p, uv[0] - p), cross2(uv[0] - p, uv[1] - p)) / area;
+}
+
+// Seeds a Random from a texel or probe index, so bakes repeat across thread counts
+uint32_t hashIndex(uint32_t x) {
+    x ^= x >> 16;
+    x *= 0x7feb352du;
+    x ^= x >> 15;
+    x *= 0x846ca68bu;
+    x ^= x >> 16;
+    return x | 1u;
+}
+
+// FNV-1a, continued from hash over size bytes
+unsigned long long hashBytes(unsigned long long hash, const void* data, size_t size) {
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+// u1 and u2 uniform in [0, 1)
+glm::vec3 cosineDirection(const glm::vec3& normal, float u1, float u2) {
+    float phi = 6.28318531f * u1;
+    float r2 = u2;
+    float r = std::sqrt(r2);
+    glm::vec3 helper = std::fabs(normal.x) > 0.5f ? glm::vec3(0.0f, 1.0f, 0.0f) : glm::vec3(1.0f, 0.0f, 0.0f);
+    glm::vec3 tangent = glm::normalize(glm::cross(helper, normal));
+    glm::vec3 bitangent = glm::cross(normal, tangent);
+    return tangent * (r * std::cos(phi)) + bitangent * (r * std::sin(phi)) + normal * std::sqrt(1.0f - r2);
+}
+
+// Shadow rays sharing a triangle mask, traced four at a time
+struct ShadowBatch {
+    RayPacket packet;
+    glm::vec3 light[4];
+    int lane[4];
+    int count;
+
+    explicit ShadowBatch(unsigned int mask) : count(0) { packet.mask = mask; }
+
+    void add(const TriangleBVH& bvh, const glm::vec3& origin, const glm::vec3& direction, float length,
+             const glm::vec3& contribution, int target, glm::vec3 result[4], unsigned long long& rays) {
+        packet.setRay(count, origin, direction, length);
+        light[count] = contribution;
+        lane[count] = target;
+        if (++count == 4) flush(bvh, result, rays);
+    }
+
+    void flush(const TriangleBVH& bvh, glm::vec3 result[4], unsigned long long& rays) {
+        if (count == 0) return;
+        int blocked = bvh.occluded(packet);
+        for (int i = 0; i < count; ++i) {
+            if (!(blocked & (1 << i))) result[lane[i]] += light[i];
+        }
+        rays += count;
+        unsigned int mask = packet.mask;
+        packet = RayPacket();
+        packet.mask = mask;
+        count = 0;
+    }
+};
+
+} // namespace
+
+// Small xorshift generator, one per texel or probe
+struct LightmapBaker::Random {
+    uint32_t state;
+    explicit Random(uint32_t seed) : state(seed * 747796405u + 2891336453u) {}
+    float next() {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return (state >> 8) * (1.0f / 16777216.0f);
+    }
+    // Cosine-weighted about normal
+    glm::vec3 hemisphere(const glm::vec3& normal) {
+        float u1 = next();
+        float u2 = next();
+        return cosineDirection(normal, u1, u2);
+    }
+    // Uniform over the sphere
+    glm::vec3 sphere() {
+        float z = 1.0f - 2.0f * next();
+        float phi = 6.28318531f * next();
+        float r = std::sqrt(std::max(0.0f, 1.0f - z * z));
+        return glm::vec3(r * std::cos(phi), r * std::sin(phi), z);
+    }
+};
+
+LightmapAtlas unwrapLightmap(StaticMeshBuilder& builder, int size, float maxTexelsPerUnit) {
+    const std::vector<Vertex>& vertices = builder.getVertices();
+    const std::vector<GLuint>& indices = builder.getIndices();
+    const std::vector<SubMesh>& subMeshes = builder.getSubMeshes();
+
+    // Group each submesh's triangles by plane
+    std::vector<Chart> charts;
+    for (size_t s = 0; s < subMeshes.size(); ++s) {
+        size_t firstChart = charts.size();
+        GLuint end = subMeshes[s].firstIndex + (GLuint)subMeshes[s].indexCount;
+        for (GLuint i = subMeshes[s].firstIndex; i < end; i += 3) {
+            const glm::vec3& a = vertices[indices[i]].position;
+            glm::vec3 normal = glm::cross(vertices[indices[i + 1]].position - a, vertices[indices[i + 2]].position - a);
+            float length = glm::length(normal);
+            normal = length > 0.0f ? normal / length : vertices[indices[i]].normal;
+            float plane = glm::dot(normal, a);
+
+            size_t chart = firstChart;
+            while (chart < charts.size()
+                   && !(glm::dot(charts[chart].normal, normal) > 0.999f && std::fabs(charts[chart].plane - plane) < 1e-3f)) {
+                ++chart;
+            }
+            if (chart == charts.size()) {
+                Chart created;
+                created.normal = normal;
+                created.plane = plane;
+                glm::vec3 up = std::fabs(normal.y) > 0.9f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+                created.axisU = glm::normalize(glm::cross(up, normal));
+                created.axisV = glm::cross(normal, created.axisU);
+                created.boundsMin = glm::vec2(1e30f);
+                created.boundsMax = glm::vec2(-1e30f);
+                created.x = created.y = 0;
+                charts.push_back(created);
+            }
+            Chart& owner = charts[chart];
+            owner.triangles.push_back(i);
+            for (int k = 0; k < 3; ++k) {
+                const glm::vec3& p = vertices[indices[i + k]].position;
+                glm::vec2 projected(glm::dot(p, owner.axisU), glm::dot(p, owner.axisV));
+                owner.boundsMin = glm::min(owner.boundsMin, projected);
+                owner.boundsMax = glm::max(owner.boundsMax, projected);
+            }
+        }
+    }
+
+    // Highest density that packs
+    float density = maxTexelsPerUnit;
+    while (!packCharts(charts, size, density)) {
+        density *= 0.9f;
+        if (density < 1e-3f) {
+            std::cerr << "Lightmap atlas: " << charts.size() << " charts do not fit in " << size << "x" << size << std::endl;
+            break;
+        }
+    }
+
+    // Each chart gets its own copy of the vertices it uses
+    std::vector<Vertex> chartVertices;
+    std::vector<GLuint> chartIndices(indices.size());
+    std::unordered_map<GLuint, GLuint> remap;
+    for (size_t c = 0; c < charts.size(); ++c) {
+        const Chart& chart = charts[c];
+        glm::vec2 corner((float)(chart.x + CHART_PADDING), (float)(chart.y + CHART_PADDING));
+        remap.clear();
+        for (size_t t = 0; t < chart.triangles.size(); ++t) {
+            for (GLuint k = 0; k < 3; ++k) {
+                GLuint slot = chart.triangles[t] + k;
+                GLuint old = indices[slot];
+                std::unordered_map<GLuint, GLuint>::iterator it = remap.find(old);
+                if (it == remap.end()) {
+                    Vertex vertex = vertices[old];
+                    glm::vec2 projected(glm::dot(vertex.position, chart.axisU), glm::dot(vertex.position, chart.axisV));
+                    vertex.lightmapUV = (corner + (projected - chart.boundsMin) * density) / (float)size;
+                    it = remap.insert(std::make_pair(old, (GLuint)chartVertices.size())).first;
+                    chartVertices.push_back(vertex);
+                }
+                chartIndices[slot] = it->second;
+            }
+        }
+    }
+    builder.setGeometry(chartVertices, chartIndices);
+
+    LightmapAtlas atlas;
+    atlas.size = size;
+    atlas.texelsPerUnit = density;
+    atlas.chartCount = (int)charts.size();
+    std::cout << "Lightmap atlas: " << charts.size() << " charts in " << size << "x" << size << ", "
+              << density << " texels per unit" << std::endl;
+    return atlas;
+}
+
+void LightmapBaker::setScene(const StaticMeshBuilder& builder, const glm::mat4& model,
+                             const std::vector<Material>& materials) {
+    const std::vector<Vertex>& vertices = builder.getVertices();
+    const std::vector<GLuint>& indices = builder.getIndices();
+    const std::vector<SubMesh>& subMeshes = builder.getSubMeshes();
+
+    triangles.clear();
+    std::vector<BVHTriangle> bvhTriangles;
+    glm::vec3 lo(1e30f), hi(-1e30f);
+    for (size_t s = 0; s < subMeshes.size(); ++s) {
+        int materialId = subMeshes[s].materialId;
+        Material material = { glm::vec3(0.5f), true };
+        if (materialId >= 0 && materialId < (int)materials.size()) material = materials[materialId];
+
+        GLuint end = subMeshes[s].firstIndex + (GLuint)subMeshes[s].indexCount;
+        for (GLuint i = subMeshes[s].firstIndex; i < end; i += 3) {
+            Triangle triangle;
+            for (int k = 0; k < 3; ++k) {
+                const Vertex& vertex = vertices[indices[i + k]];
+                triangle.positions[k] = glm::vec3(model * glm::vec4(vertex.position, 1.0f));
+                triangle.uvs[k] = vertex.lightmapUV;
+                lo = glm::min(lo, triangle.positions[k]);
+                hi = glm::max(hi, triangle.positions[k]);
+            }
+            glm::vec3 normal = glm::cross(triangle.positions[1] - triangle.positions[0],
+                                          triangle.positions[2] - triangle.positions[0]);
+            if (glm::length(normal) <= 0.0f) continue;
+            triangle.normal = glm::normalize(normal);
+            triangle.albedo = material.albedo;
+            triangles.push_back(triangle);
+
+            BVHTriangle bvhTriangle;
+            bvhTriangle.v0 = triangle.positions[0];
+            bvhTriangle.v1 = triangle.positions[1];
+            bvhTriangle.v2 = triangle.positions[2];
+            bvhTriangle.mask = RAY_ANY | (material.castsShadows ? RAY_SHADOW : 0);
+            bvhTriangles.push_back(bvhTriangle);
+        }
+    }
+    bvh.build(bvhTriangles);
+    rayOffset = std::max(1e-3f, 1e-5f * glm::length(hi - lo));
+}
+
+void LightmapBaker::setLights(const DirectionalLight& sunLight, const std::vector<SpotLight>& spotLights) {
+    sun = sunLight;
+    spots = spotLights;
+    spotCosOuter.resize(spots.size());
+    spotCosInner.resize(spots.size());
+    for (size_t i = 0; i < spots.size(); ++i) {
+        spots[i].direction = glm::normalize(spots[i].direction);
+        spotCosOuter[i] = std::cos(glm::radians(spots[i].outerAngle));
+        spotCosInner[i] = std::cos(glm::radians(spots[i].innerAngle));
+    }
+
+    // Each triangle keeps the lights whose range reaches its bounding box
+    for (size_t t = 0; t < triangles.size(); ++t) {
+        Triangle& triangle = triangles[t];
+        glm::vec3 lo = glm::min(triangle.positions[0], glm::min(triangle.positions[1], triangle.positions[2]));
+        glm::vec3 hi = glm::max(triangle.positions[0], glm::max(triangle.positions[1], triangle.positions[2]));
+        triangle.spots.clear();
+        for (size_t i = 0; i < spots.size() && i <= 0xFFFF; ++i) {
+            glm::vec3 offset = glm::clamp(spots[i].position, lo, hi) - spots[i].position;
+            if (glm::dot(offset, offset) < spots[i].range * spots[i].range) triangle.spots.push_back((uint16_t)i);
+        }
+    }
+}
+
+void LightmapBaker::rasterize(const LightmapAtlas& atlas, std::vector<Texel>& texels) const {
+    int size = atlas.size;
+    Texel empty;
+    empty.position = glm::vec3(0.0f);
+    empty.triangle = -1;
+    empty.inside = false;
+    texels.assign((size_t)size * size, empty);
+
+    for (size_t t = 0; t < triangles.size(); ++t) {
+        const Triangle& triangle = triangles[t];
+        glm::vec2 uv[3] = { triangle.uvs[0] * (float)size, triangle.uvs[1] * (float)size, triangle.uvs[2] * (float)size };
+        float area = cross2(uv[1] - uv[0], uv[2] - uv[0]);
+        if (std::fabs(area) < 1e-8f) continue;
+
+        glm::vec2 lo = glm::min(uv[0], glm::min(uv[1], uv[2])), hi = glm::max(uv[0], glm::max(uv[1], uv[2]));
+        int x0 = std::max(0, (int)std::floor(lo.x) - 1), x1 = std::min(size - 1, (int)std::ceil(hi.x) + 1);
+        int y0 = std::max(0, (int)std::floor(lo.y) - 1), y1 = std::min(size - 1, (int)std::ceil(hi.y) + 1);
+        for (int y = y0; y <= y1; ++y) {
+            for (int x = x0; x <= x1; ++x) {
+                Texel& texel = texels[(size_t)y * size + x];
+                if (texel.inside) continue;
+                glm::vec2 center(x + 0.5f, y + 0.5f);
+                glm::vec3 weights = barycentric(center, uv, area);
+                bool inside = weights.x >= 0.0f && weights.y >= 0.0f && weights.z >= 0.0f;
+                if (!inside) {
+                    // Texels the triangle only partly covers sample its nearest point
+                    if (texel.triangle >= 0) continue;
+                    glm::vec2 nearest = closestOnSegment(center, uv[0], uv[1]);
+                    glm::vec2 candidates[2] = { closestOnSegment(center, uv[1], uv[2]), closestOnSegment(center, uv[2], uv[0]) };
+                    for (int i = 0; i < 2; ++i) {
+                        if (glm::length(candidates[i] - center) < glm::length(nearest - center)) nearest = candidates[i];
+                    }
+                    if (glm::length(nearest - center) > 0.75f) continue;
+                    weights = glm::max(barycentric(nearest, uv, area), glm::vec3(0.0f));
+                    weights /= weights.x + weights.y + weights.z;
+                }
+                texel.position = triangle.positions[0] * weights.x + triangle.positions[1] * weights.y
+                               + triangle.positions[2] * weights.z;
+                texel.triangle = (int)t;
+                texel.inside = inside;
+            }
+        }
+    }
+}
+
+// Sun and spot light reaching each active point, without the ambient term
+void LightmapBaker::directLight(const glm::vec3 points[4], const int hitTriangles[4], int active, glm::vec3 result[4],
+                                unsigned long long& rays) const {
+    ShadowBatch sunRays(RAY_SHADOW), spotRays(RAY_SHADOW);
+    glm::vec3 toSun = -glm::normalize(sun.direction);
+    for (int lane = 0; lane < 4; ++lane) {
+        result[lane] = glm::vec3(0.0f);
+        if (!(active & (1 << lane))) continue;
+        const Triangle& triangle = triangles[hitTriangles[lane]];
+        const glm::vec3& point = points[lane];
+
+        float sunFacing = glm::dot(triangle.normal, toSun);
+        if (sunFacing > 0.0f) sunRays.add(bvh, point, toSun, 1e30f, sun.diffuse * sunFacing, lane, result, rays);
+
+        // Same falloff and cone as CalcSpotLights, diffuse only
+        for (size_t i = 0; i < triangle.spots.size(); ++i) {
+            int s = triangle.spots[i];
+            const SpotLight& spot = spots[s];
+            glm::vec3 toLight = spot.position - point;
+            float distance = glm::length(toLight);
+            if (distance >= spot.range || distance <= 0.0f) continue;
+            glm::vec3 lightDir = toLight / distance;
+            float diff = glm::dot(triangle.normal, lightDir);
+            if (diff <= 0.0f) continue;
+            float cone = smoothStep(spotCosOuter[s], spotCosInner[s], glm::dot(-lightDir, spot.direction));
+            if (cone <= 0.0f) continue;
+            float falloff = 1.0f - (distance * distance) / (spot.range * spot.range);
+            spotRays.add(bvh, point, lightDir, distance - rayOffset, spot.color * (diff * falloff * falloff * cone),
+                         lane, result, rays);
+        }
+    }
+    sunRays.flush(bvh, result, rays);
+    spotRays.flush(bvh, result, rays);
+}
+
+// One path per lane; each bounce adds the direct light at the hit, filtered
+// by the albedos so far. Returns the lanes whose first hit is a back face.
+int LightmapBaker::tracePaths(RayPacket& packet, int bounces, Random& random, glm::vec3 radiance[4],
+                              unsigned long long& rays) const {
+    glm::vec3 throughput[4];
+    for (int lane = 0; lane < 4; ++lane) {
+        radiance[lane] = glm::vec3(0.0f);
+        throughput[lane] = glm::vec3(1.0f);
+    }
+    int backFaces = 0;
+    for (int bounce = 0; bounce < bounces && packet.active; ++bounce) {
+        bvh.intersect(packet);
+        for (int lane = 0; lane < 4; ++lane) rays += (packet.active >> lane) & 1;
+
+        glm::vec3 hits[4], normals[4];
+        int hitTriangles[4] = { 0, 0, 0, 0 };
+        int hitMask = 0;
+        for (int lane = 0; lane < 4; ++lane) {
+            if (!(packet.active & (1 << lane)) || packet.triangle[lane] < 0) continue;
+            const Triangle& hit = triangles[packet.triangle[lane]];
+            glm::vec3 direction(packet.directionX[lane], packet.directionY[lane], packet.directionZ[lane]);
+            // The back of a surface means the path slipped behind the geometry: no light there
+            if (glm::dot(hit.normal, direction) >= 0.0f) {
+                if (bounce == 0) backFaces |= 1 << lane;
+                continue;
+            }
+            glm::vec3 origin(packet.originX[lane], packet.originY[lane], packet.originZ[lane]);
+            hits[lane] = origin + direction * packet.tMax[lane] + hit.normal * rayOffset;
+            normals[lane] = hit.normal;
+            hitTriangles[lane] = packet.triangle[lane];
+            throughput[lane] *= hit.albedo;
+            hitMask |= 1 << lane;
+        }
+        if (!hitMask) break;
+
+        glm::vec3 light[4];
+        directLight(hits, hitTriangles, hitMask, light, rays);
+        RayPacket next;
+        for (int lane = 0; lane < 4; ++lane) {
+            if (!(hitMask & (1 << lane))) continue;
+            radiance[lane] += throughput[lane] * light[lane];
+            next.setRay(lane, hits[lane], random.hemisphere(normals[lane]), 1e30f);
+        }
+        packet = next;
+    }
+    return backFaces;
+}
+
+void LightmapBaker::traceTexel(const Texel& texel, int x, int y, int size, const Settings& settings,
+                               glm::vec3& direct, glm::vec3& indirect, unsigned long long& rays) const {
+    const Triangle& triangle = triangles[texel.triangle];
+    glm::vec2 uv[3] = { triangle.uvs[0] * (float)size, triangle.uvs[1] * (float)size, triangle.uvs[2] * (float)size };
+    float area = cross2(uv[1] - uv[0], uv[2] - uv[0]);
+    Random random(hashIndex((uint32_t)(y * size + x)));
+
+    direct = glm::vec3(0.0f);
+    indirect = glm::vec3(0.0f);
+    int groups = std::max(1, (settings.samples + 3) / 4);
+    for (int g = 0; g < groups; ++g) {
+        // Four points spread over the texel, kept on the triangle
+        glm::vec3 points[4];
+        int owners[4] = { texel.triangle, texel.triangle, texel.triangle, texel.triangle };
+        for (int lane = 0; lane < 4; ++lane) {
+            glm::vec3 position = texel.position;
+            if (texel.inside) {
+                glm::vec2 jittered(x + random.next(), y + random.next());
+                glm::vec3 weights = barycentric(jittered, uv, area);
+                if (weights.x >= 0.0f && weights.y >= 0.0f && weights.z >= 0.0f) {
+                    position = triangle.positions[0] * weights.x + triangle.positions[1] * weights.y
+                             + triangle.positions[2] * weights.z;
+                }
+            }
+            points[lane] = position + triangle.normal * rayOffset;
+        }
+        glm::vec3 light[4];
+        directLight(points, owners, 0xF, light, rays);
+        for (int lane = 0; lane < 4; ++lane) direct += light[lane];
+
+        RayPacket packet;
+        for (int lane = 0; lane < 4; ++lane) {
+            packet.setRay(lane, points[lane], random.hemisphere(triangle.normal), 1e30f);
+        }
+        // Cosine-weighted directions: the mean radiance is the irradiance
+        glm::vec3 radiance[4];
+        tracePaths(packet, settings.bounces, random, radiance, rays);
+        for (int lane = 0; lane < 4; ++lane) indirect += radiance[lane];
+    }
+    direct /= (float)(groups * 4);
+    indirect /= (float)(groups * 4);
+}
+
+// A-trous wavelet filter: three 5x5 passes with growing gaps, each tap
+// weighted down by distance in the world and by normal, so charts that
+// sit side by side in the atlas but not in the room do not mix
+void LightmapBaker::denoise(const LightmapAtlas& atlas, const std::vector<Texel>& texels,
+                            std::vector<glm::vec3>& values) {
+    const float KERNEL[5] = { 1.0f / 16.0f, 1.0f / 4.0f, 3.0f / 8.0f, 1.0f / 4.0f, 1.0f / 16.0f };
+    int size = atlas.size;
+    float texelSize = 1.0f / std::max(atlas.texelsPerUnit, 1e-6f);
+    std::vector<glm::vec3> filtered(values.size());
+
+    for (int step = 1; step <= 4; step *= 2) {
+        float sigma = 2.0f * step * texelSize;
+        float positionScale = 1.0f / (2.0f * sigma * sigma);
+        workers.parallelFor((size_t)size, [&](size_t begin, size_t end) {
+            for (size_t y = begin; y < end; ++y) {
+                for (int x = 0; x < size; ++x) {
+                    size_t index = y * size + x;
+                    const Texel& center = texels[index];
+                    filtered[index] = values[index];
+                    if (center.triangle < 0) continue;
+                    const glm::vec3& normal = triangles[center.triangle].normal;
+
+                    glm::vec3 sum(0.0f);
+                    float weightSum = 0.0f;
+                    for (int j = -2; j <= 2; ++j) {
+                        int ty = (int)y + j * step;
+                        if (ty < 0 || ty >= size) continue;
+                        for (int i = -2; i <= 2; ++i) {
+                            int tx = x + i * step;
+                            if (tx < 0 || tx >= size) continue;
+                            const Texel& tap = texels[(size_t)ty * size + tx];
+                            if (tap.triangle < 0) continue;
+                            glm::vec3 offset = tap.position - center.position;
+                            float facing = std::max(0.0f, glm::dot(normal, triangles[tap.triangle].normal));
+                            float weight = KERNEL[i + 2] * KERNEL[j + 2] * std::exp(-glm::dot(offset, offset) * positionScale)
+                                         * std::pow(facing, 16.0f);
+                            sum += values[(size_t)ty * size + tx] * weight;
+                            weightSum += weight;
+                        }
+                    }
+                    if (weightSum > 0.0f) filtered[index] = sum / weightSum;
+                }
+            }
+        });
+        values.swap(filtered);
+    }
+}
+
+void LightmapBaker::bake(const LightmapAtlas& atlas, const Settings& settings, std::vector<float>& output) {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    int size = atlas.size;
+    std::vector<Texel> texels;
+    rasterize(atlas, texels);
+
+    size_t covered = 0;
+    for (size_t i = 0; i < texels.size(); ++i) covered += texels[i].triangle >= 0;
+    std::cout << "Baking lightmap: " << covered << " texels, " << settings.samples << " samples, "
+              << settings.bounces << " bounces, " << triangles.size() << " triangles, " << workers.threadCount()
+              << " thread(s)" << std::endl;
+
+    std::vector<glm::vec3> direct(texels.size(), glm::vec3(0.0f)), indirect(texels.size(), glm::vec3(0.0f));
+    std::atomic<unsigned long long> totalRays(0);
+    std::atomic<int> rowsDone(0);
+    workers.parallelFor((size_t)size, [&](size_t begin, size_t end) {
+        unsigned long long rays = 0;
+        for (size_t y = begin; y < end; ++y) {
+            for (int x = 0; x < size; ++x) {
+                size_t index = y * size + x;
+                if (texels[index].triangle < 0) continue;
+                traceTexel(texels[index], x, (int)y, size, settings, direct[index], indirect[index], rays);
+            }
+            int done = ++rowsDone;
+            if (done * 10 / size != (done - 1) * 10 / size) {
+                std::printf("  %d%%\n", done * 100 / size);
+                std::fflush(stdout);
+            }
+        }
+        totalRays += rays;
+    });
+
+    // Direct light converges quickly; the indirect part is what needs smoothing
+    denoise(atlas, texels, indirect);
+
+    output.assign(texels.size() * 3, 0.0f);
+    std::vector<char> filled(texels.size(), 0);
+    for (size_t i = 0; i < texels.size(); ++i) {
+        if (texels[i].triangle < 0) continue;
+        glm::vec3 value = sun.ambient + direct[i] + indirect[i];
+        output[3 * i] = value.r;
+        output[3 * i + 1] = value.g;
+        output[3 * i + 2] = value.b;
+        filled[i] = 1;
+    }
+
+    // Grow charts into their padding so bilinear filtering at the edges never reads an empty texel
+    for (int pass = 0; pass < CHART_PADDING; ++pass) {
+        std::vector<char> grown = filled;
+        for (int y = 0; y < size; ++y) {
+            for (int x = 0; x < size; ++x) {
+                size_t index = (size_t)y * size + x;
+                if (filled[index]) continue;
+                glm::vec3 sum(0.0f);
+                int count = 0;
+                for (int j = std::max(0, y - 1); j <= std::min(size - 1, y + 1); ++j) {
+                    for (int i = std::max(0, x - 1); i <= std::min(size - 1, x + 1); ++i) {
+                        size_t neighbour = (size_t)j * size + i;
+                        if (!filled[neighbour]) continue;
+                        sum += glm::vec3(output[3 * neighbour], output[3 * neighbour + 1], output[3 * neighbour + 2]);
+                        count++;
+                    }
+                }
+                if (count == 0) continue;
+                sum /= (float)count;
+                output[3 * index] = sum.r;
+                output[3 * index + 1] = sum.g;
+                output[3 * index + 2] = sum.b;
+                grown[index] = 1;
+            }
+        }
+        filled.swap(grown);
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "Lightmap baked in " << seconds << " s: " << totalRays.load() / 1e6 << " M rays ("
+              << totalRays.load() / 1e6 / std::max(seconds, 1e-3) << " M rays/s)" << std::endl;
+}
+
+void LightmapBaker::bakeProbes(const ProbeGrid& grid, const Settings& settings, std::vector<ProbeSH>& probes) {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    size_t count = grid.size();
+    int nx = grid.counts.x, ny = grid.counts.y;
+    int groups = std::max(1, (settings.probeSamples + 3) / 4);
+    float samples = (float)(groups * 4);
+    probes.assign(count, ProbeSH());
+    std::vector<char> valid(count, 0);
+    std::atomic<unsigned long long> totalRays(0);
+
+    workers.parallelFor(count, [&](size_t begin, size_t end) {
+        unsigned long long rays = 0;
+        for (size_t i = begin; i < end; ++i) {
+            glm::vec3 position = grid.probePosition((int)(i % nx), (int)(i / nx % ny), (int)(i / ((size_t)nx * ny)));
+            Random random(hashIndex((uint32_t)i ^ 0x5bd1e995u));
+
+            // Uniform directions: the mean radiance is the constant band and
+            // twice the radiance-weighted mean direction the linear band, once
+            // both are convolved with the cosine lobe
+            glm::vec3 mean(0.0f), red(0.0f), green(0.0f), blue(0.0f);
+            int backFaces = 0;
+            for (int g = 0; g < groups; ++g) {
+                RayPacket packet;
+                glm::vec3 directions[4];
+                for (int lane = 0; lane < 4; ++lane) {
+                    directions[lane] = random.sphere();
+                    packet.setRay(lane, position, directions[lane], 1e30f);
+                }
+                glm::vec3 radiance[4];
+                int back = tracePaths(packet, settings.bounces, random, radiance, rays);
+                for (int lane = 0; lane < 4; ++lane) {
+                    backFaces += (back >> lane) & 1;
+                    mean += radiance[lane];
+                    red += directions[lane] * radiance[lane].r;
+                    green += directions[lane] * radiance[lane].g;
+                    blue += directions[lane] * radiance[lane].b;
+                }
+            }
+            // A probe that sees the back of a wall along a quarter of its rays is inside one
+            valid[i] = backFaces < groups;
+            mean = mean / samples + sun.ambient;
+            float scale = 2.0f / samples;
+            probes[i].red = glm::vec4(red * scale, mean.r);
+            probes[i].green = glm::vec4(green * scale, mean.g);
+            probes[i].blue = glm::vec4(blue * scale, mean.b);
+        }
+        totalRays += rays;
+    });
+
+    // Probes inside walls take the mean of their valid neighbours, spreading inwards
+    size_t invalid = 0;
+    for (size_t i = 0; i < count; ++i) invalid += !valid[i];
+    size_t remaining = invalid;
+    const int OFFSETS[6][3] = { { -1, 0, 0 }, { 1, 0, 0 }, { 0, -1, 0 }, { 0, 1, 0 }, { 0, 0, -1 }, { 0, 0, 1 } };
+    while (remaining > 0) {
+        std::vector<char> filled = valid;
+        for (size_t i = 0; i < count; ++i) {
+            if (valid[i]) continue;
+            int x = (int)(i % nx), y = (int)(i / nx % ny), z = (int)(i / ((size_t)nx * ny));
+            glm::vec4 red(0.0f), green(0.0f), blue(0.0f);
+            int neighbours = 0;
+            for (int k = 0; k < 6; ++k) {
+                int px = x + OFFSETS[k][0], py = y + OFFSETS[k][1], pz = z + OFFSETS[k][2];
+                if (px < 0 || py < 0 || pz < 0 || px >= nx || py >= ny || pz >= grid.counts.z) continue;
+                size_t neighbour = ((size_t)pz * ny + py) * nx + px;
+                if (!valid[neighbour]) continue;
+                red += probes[neighbour].red;
+                green += probes[neighbour].green;
+                blue += probes[neighbour].blue;
+                neighbours++;
+            }
+            if (neighbours == 0) continue;
+            float weight = 1.0f / neighbours;
+            probes[i].red = red * weight;
+            probes[i].green = green * weight;
+            probes[i].blue = blue * weight;
+            filled[i] = 1;
+            remaining--;
+        }
+        if (filled == valid) break; // nothing valid to grow from
+        valid.swap(filled);
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "Probes baked in " << seconds << " s: " << count << " probes (" << invalid << " inside geometry), "
+              << totalRays.load() / 1e6 << " M rays" << std::endl;
+}
+
+unsigned long long lightmapLayoutHash(const StaticMeshBuilder& builder, const glm::mat4& model, int size) {
+    unsigned long long hash = hashBytes(0xcbf29ce484222325ull, &size, sizeof(size));
+    hash = hashBytes(hash, &model[0][0], 16 * sizeof(float));
+    const std::vector<Vertex>& vertices = builder.getVertices();
+    for (size_t i = 0; i < vertices.size(); ++i) {
+        hash = hashBytes(hash, &vertices[i].position[0], 3 * sizeof(float));
+        hash = hashBytes(hash, &vertices[i].normal[0], 3 * sizeof(float));
+        hash = hashBytes(hash, &vertices[i].lightmapUV[0], 2 * sizeof(float));
+    }
+    const std::vector<GLuint>& indices = builder.getIndices();
+    if (!indices.empty()) hash = hashBytes(hash, &indices[0], indices.size() * sizeof(GLuint));
+    const std::vector<SubMesh>& subMeshes = builder.getSubMeshes();
+    for (size_t i = 0; i < subMeshes.size(); ++i) {
+        hash = hashBytes(hash, &subMeshes[i].firstIndex, sizeof(GLuint));
+        hash = hashBytes(hash, &subMeshes[i].indexCount, sizeof(GLsizei));
+        hash = hashBytes(hash, &subMeshes[i].materialId, sizeof(int));
+    }
+    return hash;
+}
+
+unsigned long long lightmapLightsHash(unsigned long long layoutHash, const DirectionalLight& sun,
+                                      const std::vector<SpotLight>& spots) {
+    unsigned long long hash = hashBytes(layoutHash, &sun.direction[0], 3 * sizeof(float));
+    hash = hashBytes(hash, &sun.ambient[0], 3 * sizeof(float));
+    hash = hashBytes(hash, &sun.diffuse[0], 3 * sizeof(float));
+    for (size_t i = 0; i < spots.size(); ++i) {
+        const SpotLight& spot = spots[i];
+        hash = hashBytes(hash, &spot.position[0], 3 * sizeof(float));
+        hash = hashBytes(hash, &spot.direction[0], 3 * sizeof(float));
+        hash = hashBytes(hash, &spot.color[0], 3 * sizeof(float));
+        float shape[3] = { spot.range, spot.innerAngle, spot.outerAngle };
+        hash = hashBytes(hash, shape, sizeof(shape));
+    }
+    return hash;
+}
+
+bool saveLightmap(const std::string& path, int size, const std::vector<float>& texels, unsigned long long hash) {
+    FILE* file = std::fopen(path.c_str(), "wb");
+    if (!file) {
+        std::cerr << "Failed to write lightmap: " << path << std::endl;
+        return false;
+    }
+    std::fprintf(file, "#?RADIANCE\nFORMAT=32-bit_rle_rgbe\n\n-Y %d +X %d\n", size, size);
+
+    // Run-length scanlines made of literal runs only: each channel's bytes in runs of up to 128
+    std::vector<unsigned char> rgbe(4 * size);
+    for (int y = 0; y < size; ++y) {
+        for (int x = 0; x < size; ++x) {
+            const float* rgb = &texels[3 * ((size_t)y * size + x)];
+            float largest = std::max(rgb[0], std::max(rgb[1], rgb[2]));
+            unsigned char* out = &rgbe[4 * x];
+            if (largest < 1e-32f) {
+                out[0] = out[1] = out[2] = out[3] = 0;
+                continue;
+            }
+            int exponent;
+            float scale = std::frexp(largest, &exponent) * 256.0f / largest;
+            for (int c = 0; c < 3; ++c) out[c] = (unsigned char)std::max(0.0f, rgb[c] * scale);
+            out[3] = (unsigned char)(exponent + 128);
+        }
+        unsigned char header[4] = { 2, 2, (unsigned char)(size >> 8), (unsigned char)(size & 0xFF) };
+        std::fwrite(header, 1, 4, file);
+        for (int c = 0; c < 4; ++c) {
+            for (int x = 0; x < size; x += 128) {
+                unsigned char run = (unsigned char)std::min(128, size - x);
+                std::fputc(run, file);
+                for (int i = 0; i < run; ++i) std::fputc(rgbe[4 * (x + i) + c], file);
+            }
+        }
+    }
+    bool ok = std::ferror(file) == 0;
+    ok = std::fclose(file) == 0 && ok;
+    ok = ok && saveBakeHash(path, hash);
+    if (ok) {
+        std::cout << "Lightmap saved: " << path << std::endl;
+    } else {
+        std::cerr << "Failed to write lightmap: " << path << std::endl;
+    }
+    return ok;
+}
+
+bool saveBakeHash(const std::string& path, unsigned long long hash) {
+    FILE* file = std::fopen((path + ".hash").c_str(), "w");
+    bool ok = file && std::fprintf(file, "%016llx\n", hash) > 0;
+    if (file) ok = std::fclose(file) == 0 && ok;
+    return ok;
+}
+
+bool bakeHashMatches(const std::string& path, unsigned long long hash) {
+    unsigned long long bakedHash = 0;
+    FILE* file = std::fopen((path + ".hash").c_str(), "r");
+    bool match = file && std::fscanf(file, "%llx", &bakedHash) == 1 && bakedHash == hash;
+    if (file) std::fclose(file);
+    return match;
+}
+
+bool bakeIsStale(const std::string& path, unsigned long long hash) {
+    FILE* file = std::fopen(path.c_str(), "rb");
+    if (!file) return false;
+    std::fclose(file);
+    return !bakeHashMatches(path, hash);
+}
+
+GLuint loadLightmap(const std::string& path, int size, unsigned long long hash) {
+    int width, height, channels;
+    float* data = stbi_loadf(path.c_str(), &width, &height, &channels, 3);
+    if (!data) {
+        std::cout << "No baked lightmap at " << path << " (--bake-lightmap creates one)" << std::endl;
+        return 0;
+    }
+    if (width != size || height != size) {
+        std::cerr << "Lightmap " << path << " is " << width << "x" << height << ", expected " << size << "x" << size
+                  << "; bake it again" << std::endl;
+        stbi_image_free(data);
+        return 0;
+    }
+    // The same atlas size is no proof of the same charts; the fingerprint is
+    if (!bakeHashMatches(path, hash)) {
+        std::cerr << "Lightmap " << path << " was baked for another layout or light set; bake it again" << std::endl;
+        stbi_image_free(data);
+        return 0;
+    }
+
+    GLuint texture;
+    glGenTextures(1, &texture);
+    glState().bindTexture(GL_TEXTURE_2D, texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB16F, width, height, 0, GL_RGB, GL_FLOAT, data);
+    renderStats().countTextureUpload((size_t)width * height * 3 * sizeof(float));
+    // No mipmaps: smaller levels would blend neighbouring charts
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    stbi_image_free(data);
+    std::cout << "Lightmap: " << path << " (" << width << "x" << height << ")" << std::endl;
+    return texture;
+}
+
+glm::vec3 averageTextureColor(const std::string& path) {
+    int width, height, channels;
+    unsigned char* data = stbi_load(path.c_str(), &width, &height, &channels, 3);
+    if (!data) return glm::vec3(0.5f);
+
+    // Decode sRGB once per byte value rather than per pixel
+    float linear[256];
+    for (int i = 0; i < 256; ++i) {
+        float c = i / 255.0f;
+        linear[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+    }
+    double sum[3] = { 0.0, 0.0, 0.0 };
+    size_t count = (size_t)width * height;
+    for (size_t i = 0; i < 3 * count; ++i) sum[i % 3] += linear[data[i]];
+    stbi_image_free(data);
+    double scale = 1.0 / std::max<size_t>(count, 1);
+    return glm::vec3((float)(sum[0] * scale), (float)(sum[1] * scale), (float)(sum[2] * scale));
+}
@@ -6,19 +6,52 @@
 #include "shader.h"
 #include "texture.h"
 #include "lighting.h"
+#include "painting.h"
+#include "painting_renderer.h"
+#include "gl_state.h"
+#include "transform.h"
+#include "render_queue.h"
+#include "static_mesh.h"
+#include "indirect_renderer.h"
+#include "options.h"
+#include "culling.h"
+#include "frame_stats.h"
+#include "occlusion.h"
+#include "cells.h"
+#include "museum.h"
+#include "clustered_lighting.h"
+#include "deferred_renderer.h"
+#include "shadow_map.h"
+#include "lightmap.h"
+#include "probe_volume.h"
+#include "sculpture.h"
+#include "depth_prepass.h"
+#include "dynamic_resolution.h"
+#include "frame_pacer.h"
+#include "frame_allocator.h"
+#include "render_stats.h"
+#include "gpu_profiler.h"
+#include "profiler.h"
+#include "offscreen_target.h"
+#include "benchmark_report.h"
+#include "input.h"
+#include <sys/stat.h>
+#include <algorithm>
+#include <cmath>
+#include <fstream>
 #include <iostream>
+#include <memory>
+#include <utility>
 #include <vector>
-#define STB_IMAGE_IMPLEMENTATION
-#include "stb_image.h"
 
-const unsigned int SCR_WIDTH = 1280;
-const unsigned int SCR_HEIGHT = 720;
+// Frames a headless run renders before it starts counting, so first-use costs stay out of the report
+const int HEADLESS_WARMUP_FRAMES = 10;
 const char* WINDOW_NAME = "OpenGL Art Gallery";
 
 void checkOpenGLErrors(const char* function);
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
-void mouse_callback(GLFWwindow* window, double xposIn, double yposIn);
-GLFWwindow* initializeWindow();
+GLFWwindow* initializeWindow(const Options& options);
+int runGallery(GLFWwindow* window, const Options& options, BenchmarkReport& report, uint64_t startupBegin);
 
 
 glm::vec2 getImageSize(const std::string& path) {
@@ -41,312 +74,1033 @@ glm::vec2 scaleToFit(glm::vec2 imageSize, float maxWidth, float maxHeight) {
     return imageSize * scale; // Return the scaled size
 }
 
-class Painting {
-public:
-    GLuint VAO, VBO, EBO;
-    GLuint texture;
-    glm::vec3 position;
-    glm::vec2 size;
-
-    Painting(const char* texturePath, const glm::vec3& pos, const glm::vec2& dimensions) 
-        : position(pos), size(dimensions) {
-        setup();
-        texture = loadTexture(texturePath);
-    }
-
-    ~Painting() {
-        glDeleteVertexArrays(1, &VAO);
-        glDeleteBuffers(1, &VBO);
-        glDeleteBuffers(1, &EBO);
-    }
-
-    void draw(Shader& shader) {
-        glm::mat4 model = glm::translate(glm::mat4(1.0f), position);
-        shader.setMat4("model", model);
-        
-        glBindVertexArray(VAO);
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, texture);
-        shader.setInt("material.diffuse", 0);
-        glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
-    }
-
-private:
-    void setup() {
-
-        float vertices[] = {
-            -0.5f,  0.5f, 0.0f, 0.0f, 0.0f, 1.0f,   0.0f, 0.0f,  // Bottom-left
-             0.5f,  0.5f, 0.0f, 0.0f, 0.0f, 1.0f,   1.0f, 0.0f,  // Bottom-right
-             0.5f, -0.5f, 0.0f, 0.0f, 0.0f, 1.0f,   1.0f, 1.0f,  // Top-right
-            -0.5f, -0.5f, 0.0f, 0.0f, 0.0f, 1.0f,   0.0f, 1.0f   // Top-left
-        };
-        unsigned int indices[] = {
-            0, 1, 2,
-            0, 2, 3
-        };
-
-        glGenVertexArrays(1, &VAO);
-        glGenBuffers(1, &VBO);
-        glGenBuffers(1, &EBO);
-
-        glBindVertexArray(VAO);
-        
-        glBindBuffer(GL_ARRAY_BUFFER, VBO);
-        glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
-
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
-
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
-        glEnableVertexAttribArray(0);
-        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
-        glEnableVertexAttribArray(1);
-        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
-        glEnableVertexAttribArray(2);
-    }
+enum RoomMaterial {
+    MATERIAL_FLOOR = 0,
+    MATERIAL_WALL,
+    MATERIAL_CEILING,
+    MATERIAL_COUNT
+};
+
+const char* MATERIAL_PATHS[MATERIAL_COUNT] = {
+    "assets/textures/black_tile.jpg",
+    "assets/textures/gray.png",
+    "assets/textures/gray.png"
+};
+
+// Baked lighting, one file per layout; the size must match the bake
+const char* LIGHTMAP_DIR = "assets/lightmaps";
+const float LIGHTMAP_TEXELS_PER_UNIT = 8.0f;
+
+// The programs geometry is drawn with: lit directly, or writing the G-buffer
+struct SurfaceShaders {
+    Shader* room = NULL;
+    Shader* painting = NULL;
+    Shader* frame = NULL;
+    Shader* indirect = NULL;
+    Shader* sculpture = NULL;
 };
 
 struct ApplicationState {
     Camera camera;
     Shader shader;
-    // Room geometry
-    GLuint planeVAO;
-    GLuint planeVBO;
-    GLuint planeTexture;
-    GLuint wallVAO;
-    GLuint wallVBO;
-    GLuint wallTexture;
-    GLuint ceilingVAO;
-    GLuint ceilingVBO;
-    GLuint ceilingTexture;
+    Shader paintingShader;
+    Shader frameShader;
+    Shader sculptureShader;
+    // Room geometry: one mesh, textures indexed by submesh material ID
+    StaticMesh roomMesh;
+    GLuint materialTextures[MATERIAL_COUNT];
+    // GL 4.3+ path: whole room in one multi-draw, materials as array layers
+    bool useIndirect = false;
+    std::unique_ptr<Shader> indirectShader;
+    IndirectRenderer indirect;
+    GLuint materialArray = 0;
     // Lighting
     Light light;
     DirectionalLight dirLight;
-    // Time
+    ClusteredLighting spotLights; // one spot per painting, binned into view-space clusters
+    // Sun shadows: room and paintings are cached, dynamic casters are redrawn over a copy each frame
+    bool useShadows = false;
+    ShadowMap shadows;
+    std::vector<DrawCommand> shadowCasters;
+    // Baked lighting for the room mesh, used instead of the lighting math when loaded
+    bool useLightmap = false;
+    LightmapAtlas lightmapAtlas;
+    unsigned long long lightmapLayout = 0; // lightmapLayoutHash() of the unwrapped geometry
+    std::string lightmapPath;
+    GLuint lightmap = 0;
+    std::unique_ptr<StaticMeshBuilder> bakeGeometry; // kept until setupLightmap() knows whether to bake
+    // Baked indirect light for everything not lightmapped, sampled wherever it moves
+    bool useProbes = false;
+    ProbeGrid probeGrid;
+    std::string probePath;
+    ProbeVolume probes;
+    // Floor, walls and ceiling share one placement
+    Transform roomTransform;
+    // Rooms as cells joined by portals; what the traversal found this frame
+    CellGraph cells;
+    std::vector<int> surfaceCells; // owning cell per submesh
+    bool useCulling = true;
+    Frustum frustum;
+    CellVisibility visibility;
+    std::vector<uint32_t> visibleSurfaces;
+    std::vector<uint32_t> visiblePaintings;
+    std::vector<uint32_t> visibleSculptures;
+    std::vector<uint32_t> shadowSculptures; // in visible rooms, on screen or not
+    std::vector<uint32_t> indirectSurfaces; // what the indirect command buffer holds
+    // Occlusion culling: each cell is a query group (same index), each painting a node in it
+    bool useOcclusion = false;
+    OcclusionCuller occlusion;
+    std::vector<int> paintingNodes;
+    std::vector<int> paintingCells;
+    std::vector<GLuint> cellConditions; // query a cell's draws are conditional on, if any
+    std::vector<char> cellsHidden;
+    FrameStats stats;
+    // Shading path, switchable at runtime; the G-buffer programs are the same sources built with GBUFFER
+    bool useDeferred = false;
+    DeferredRenderer deferred;
+    SurfaceShaders forwardShaders;
+    SurfaceShaders gbufferShaders;
+    std::vector<std::unique_ptr<Shader> > gbufferPrograms;
+    // Depth-only pass first, so the lit pass shades each pixel once
+    bool useDepthPrepass = false;
+    DepthPrepass prepass;
+    // Offscreen rendering at a scale that holds the GPU frame budget
+    bool useDynamicResolution = false;
+    DynamicResolution resolution;
+    // Swap interval, frame limiter and input latency
+    FramePacer pacer;
+    // Keyboard and mouse, live or replayed from a log
+    Input input;
+    // Time; a fixed step replaces the clock so replays and benchmarks repeat exactly
     float deltaTime = 0.0f;
     float lastFrame = 0.0f;
+    float fixedDeltaTime = 0.0f;
 
-    // List of paintings
-    std::vector<Painting> paintings;
+    // All paintings, drawn instanced
+    PaintingRenderer paintings;
+    // Turning sculptures, one per room: the dynamic objects lit by the probes
+    SculptureRenderer sculptures;
+
+    RenderQueue renderQueue;
+    // Per-frame uniform ring the queue writes draw transforms into
+    FrameAllocator frameData;
+    // GPU and CPU time per pass, a few frames late
+    GpuProfiler gpuProfiler;
+    // Stands in for the window when running headless
+    OffscreenTarget offscreen;
 
     ApplicationState() : camera(glm::vec3(0.0f, 2.0f, 5.0f), glm::vec3(0.0f, 1.0f, 0.0f), -90.0f, 0.0f),
-                        shader("shaders/vertex_shader.glsl", "shaders/fragment_shader.glsl") {}
+                        shader("shaders/vertex_shader.glsl", "shaders/fragment_shader.glsl"),
+                        paintingShader("shaders/painting_vs.glsl", "shaders/painting_fs.glsl"),
+                        frameShader("shaders/frame_vs.glsl", "shaders/frame_fs.glsl"),
+                        sculptureShader("shaders/vertex_shader.glsl", "shaders/sculpture_fs.glsl"),
+                        roomTransform(glm::vec3(0.0f, -1.0f, 0.0f)) {}
 };
 
-void setupGeometry(ApplicationState& state) {
-    float planeVertices[] = {
-        -10.0f, 0.0f,  10.0f,  0.0f, 1.0f, 0.0f,   0.0f, 10.0f,
-         10.0f, 0.0f,  10.0f,  0.0f, 1.0f, 0.0f,   10.0f, 10.0f,
-        -10.0f, 0.0f, -10.0f,  0.0f, 1.0f, 0.0f,   0.0f, 0.0f,
-         10.0f, 0.0f,  10.0f,  0.0f, 1.0f, 0.0f,   10.0f, 10.0f,
-         10.0f, 0.0f, -10.0f,  0.0f, 1.0f, 0.0f,   10.0f, 0.0f,
-        -10.0f, 0.0f, -10.0f,  0.0f, 1.0f, 0.0f,   0.0f, 0.0f,
-    };
+void setupSingleRoom(ApplicationState& state, StaticMeshBuilder& builder) {
+    glm::vec3 up(0.0f, 1.0f, 0.0f);
+
+    // Floor
+    builder.beginSubMesh(MATERIAL_FLOOR);
+    builder.addQuad(Vertex(glm::vec3(-10.0f, 0.0f,  10.0f), up, glm::vec2(0.0f, 10.0f)),
+                    Vertex(glm::vec3( 10.0f, 0.0f,  10.0f), up, glm::vec2(10.0f, 10.0f)),
+                    Vertex(glm::vec3( 10.0f, 0.0f, -10.0f), up, glm::vec2(10.0f, 0.0f)),
+                    Vertex(glm::vec3(-10.0f, 0.0f, -10.0f), up, glm::vec2(0.0f, 0.0f)));
+
+    // Walls, wound counter-clockwise as seen from inside the room. Each is
+    // its own submesh so walls behind the camera can be culled.
+    builder.beginSubMesh(MATERIAL_WALL);
+    glm::vec3 n(0.0f, 0.0f, 1.0f); // front wall
+    builder.addQuad(Vertex(glm::vec3(-10.0f,  0.0f, -10.0f), n, glm::vec2(0.0f, 0.0f)),
+                    Vertex(glm::vec3( 10.0f,  0.0f, -10.0f), n, glm::vec2(5.0f, 0.0f)),
+                    Vertex(glm::vec3( 10.0f, 10.0f, -10.0f), n, glm::vec2(5.0f, 10.0f)),
+                    Vertex(glm::vec3(-10.0f, 10.0f, -10.0f), n, glm::vec2(0.0f, 10.0f)));
+    builder.beginSubMesh(MATERIAL_WALL);
+    n = glm::vec3(0.0f, 0.0f, -1.0f); // back wall
+    builder.addQuad(Vertex(glm::vec3(-10.0f,  0.0f, 10.0f), n, glm::vec2(0.0f, 0.0f)),
+                    Vertex(glm::vec3(-10.0f, 10.0f, 10.0f), n, glm::vec2(0.0f, 10.0f)),
+                    Vertex(glm::vec3( 10.0f, 10.0f, 10.0f), n, glm::vec2(5.0f, 10.0f)),
+                    Vertex(glm::vec3( 10.0f,  0.0f, 10.0f), n, glm::vec2(5.0f, 0.0f)));
+    builder.beginSubMesh(MATERIAL_WALL);
+    n = glm::vec3(1.0f, 0.0f, 0.0f); // left wall
+    builder.addQuad(Vertex(glm::vec3(-10.0f,  0.0f,  10.0f), n, glm::vec2(0.0f, 0.0f)),
+                    Vertex(glm::vec3(-10.0f,  0.0f, -10.0f), n, glm::vec2(5.0f, 0.0f)),
+                    Vertex(glm::vec3(-10.0f, 10.0f, -10.0f), n, glm::vec2(5.0f, 10.0f)),
+                    Vertex(glm::vec3(-10.0f, 10.0f,  10.0f), n, glm::vec2(0.0f, 10.0f)));
+    builder.beginSubMesh(MATERIAL_WALL);
+    n = glm::vec3(-1.0f, 0.0f, 0.0f); // right wall
+    builder.addQuad(Vertex(glm::vec3(10.0f,  0.0f,  10.0f), n, glm::vec2(0.0f, 0.0f)),
+                    Vertex(glm::vec3(10.0f, 10.0f,  10.0f), n, glm::vec2(0.0f, 10.0f)),
+                    Vertex(glm::vec3(10.0f, 10.0f, -10.0f), n, glm::vec2(5.0f, 10.0f)),
+                    Vertex(glm::vec3(10.0f,  0.0f, -10.0f), n, glm::vec2(5.0f, 0.0f)));
+
+    // Ceiling
+    builder.beginSubMesh(MATERIAL_CEILING);
+    glm::vec3 down(0.0f, -1.0f, 0.0f);
+    builder.addQuad(Vertex(glm::vec3(-10.0f, 10.0f,  10.0f), down, glm::vec2(0.0f, 10.0f)),
+                    Vertex(glm::vec3(-10.0f, 10.0f, -10.0f), down, glm::vec2(0.0f, 0.0f)),
+                    Vertex(glm::vec3( 10.0f, 10.0f, -10.0f), down, glm::vec2(10.0f, 0.0f)),
+                    Vertex(glm::vec3( 10.0f, 10.0f,  10.0f), down, glm::vec2(10.0f, 10.0f)));
 
-    float wallVertices[] = {
-        // Front wall
-        -10.0f,  0.0f, -10.0f,  0.0f, 0.0f, 1.0f,   0.0f, 0.0f,  // bottom left
-        10.0f,   0.0f, -10.0f,  0.0f, 0.0f, 1.0f,   5.0f, 0.0f,  // bottom right
-        10.0f,   10.0f, -10.0f,  0.0f, 0.0f, 1.0f,   5.0f, 10.0f, // top right
-        -10.0f,  0.0f, -10.0f,  0.0f, 0.0f, 1.0f,   0.0f, 0.0f,  // bottom left
-        10.0f,   10.0f, -10.0f,  0.0f, 0.0f, 1.0f,   5.0f, 10.0f, // top right
-        -10.0f,  10.0f, -10.0f,  0.0f, 0.0f, 1.0f,   0.0f, 10.0f, // top left
-
-        // Back wall
-        -10.0f,  0.0f, 10.0f,   0.0f, 0.0f, -1.0f,  0.0f, 0.0f,
-        10.0f,   0.0f, 10.0f,   0.0f, 0.0f, -1.0f,  5.0f, 0.0f,
-        10.0f,   10.0f, 10.0f,   0.0f, 0.0f, -1.0f,  5.0f, 10.0f,
-        -10.0f,  0.0f, 10.0f,   0.0f, 0.0f, -1.0f,  0.0f, 0.0f,
-        10.0f,   10.0f, 10.0f,   0.0f, 0.0f, -1.0f,  5.0f, 10.0f,
-        -10.0f,  10.0f, 10.0f,   0.0f, 0.0f, -1.0f,  0.0f, 10.0f,
-
-        // Left wall
-        -10.0f,  0.0f,  10.0f,  1.0f, 0.0f, 0.0f,   0.0f, 0.0f,
-        -10.0f,  0.0f, -10.0f,  1.0f, 0.0f, 0.0f,   5.0f, 0.0f,
-        -10.0f,  10.0f, -10.0f,  1.0f, 0.0f, 0.0f,   5.0f, 10.0f,
-        -10.0f,  0.0f,  10.0f,  1.0f, 0.0f, 0.0f,   0.0f, 0.0f,
-        -10.0f,  10.0f, -10.0f,  1.0f, 0.0f, 0.0f,   5.0f, 10.0f,
-        -10.0f,  10.0f,  10.0f,  1.0f, 0.0f, 0.0f,   0.0f, 10.0f,
-
-        // Right wall
-        10.0f,  0.0f,  10.0f,   -1.0f, 0.0f, 0.0f,  0.0f, 0.0f,
-        10.0f,  0.0f, -10.0f,   -1.0f, 0.0f, 0.0f,  5.0f, 0.0f,
-        10.0f,  10.0f, -10.0f,   -1.0f, 0.0f, 0.0f,  5.0f, 10.0f,
-        10.0f,  0.0f,  10.0f,   -1.0f, 0.0f, 0.0f,  0.0f, 0.0f,
-        10.0f,  10.0f, -10.0f,   -1.0f, 0.0f, 0.0f,  5.0f, 10.0f,
-        10.0f,  10.0f,  10.0f,   -1.0f, 0.0f, 0.0f,  0.0f, 10.0f,
+    // The whole room is one cell without portals
+    glm::vec3 offset = state.roomTransform.getPosition();
+    int cell = state.cells.addCell(glm::vec3(-10.0f, 0.0f, -10.0f) + offset, glm::vec3(10.0f, 10.0f, 10.0f) + offset);
+    for (size_t i = 0; i < builder.getSubMeshes().size(); ++i) {
+        state.cells.addSurface(cell, (uint32_t)i);
+    }
+
+    glm::vec2 imageSize = getImageSize("assets/textures/otter.jpg");
+    float maxWidth = 10.0f;
+    float maxHeight = 5.0f;
+
+    glm::vec2 scaledSize = scaleToFit(imageSize, maxWidth*2, maxHeight*2);
+    
+    state.cells.addPainting(cell, (uint32_t)state.paintings.getPaintings().size());
+    state.paintings.add(Painting(
+        "assets/textures/otter.jpg",
+        glm::vec3(0.0f, 4.3f, -9.9f),  
+        scaledSize
+    ));
+}
+
+void setupMuseum(ApplicationState& state, StaticMeshBuilder& builder) {
+    const char* images[] = {
+        "assets/textures/mona.jpg",
+        "assets/textures/otter.jpg",
+        "assets/textures/wave.jpg",
+        "assets/textures/otter2.jpg"
     };
+    std::vector<Artwork> artworks;
+    for (size_t i = 0; i < sizeof(images) / sizeof(images[0]); ++i) {
+        Artwork art;
+        art.path = images[i];
+        art.imageSize = getImageSize(images[i]);
+        if (art.imageSize.x > 0.0f && art.imageSize.y > 0.0f) artworks.push_back(art);
+    }
+
+    MuseumLayout layout;
+    MuseumMaterials materials;
+    materials.floor = MATERIAL_FLOOR;
+    materials.wall = MATERIAL_WALL;
+    materials.ceiling = MATERIAL_CEILING;
+
+    std::vector<Painting> paintings;
+    buildMuseum(layout, materials, artworks, state.roomTransform.getPosition(), builder, state.cells, paintings);
+    for (size_t i = 0; i < paintings.size(); ++i) {
+        state.paintings.add(paintings[i]);
+    }
 
-    float ceilingVertices[] = {
-        -10.0f, 10.0f,  10.0f,  0.0f, -1.0f, 0.0f,   0.0f, 10.0f,
-         10.0f, 10.0f,  10.0f,  0.0f, -1.0f, 0.0f,   10.0f, 10.0f,
-        -10.0f, 10.0f, -10.0f,  0.0f, -1.0f, 0.0f,   0.0f, 0.0f,
-         10.0f, 10.0f,  10.0f,  0.0f, -1.0f, 0.0f,   10.0f, 10.0f,
-         10.0f, 10.0f, -10.0f,  0.0f, -1.0f, 0.0f,   10.0f, 0.0f,
-        -10.0f, 10.0f, -10.0f,  0.0f, -1.0f, 0.0f,   0.0f, 0.0f,
+    // Walls and doorways replace the single-room box
+    float half = layout.roomSize * 0.5f;
+    state.camera.setBounds(glm::vec3(-half, 2.0f, -half - (layout.rows - 1) * layout.roomSize),
+                           glm::vec3(half + (layout.columns - 1) * layout.roomSize, 2.0f, half));
+    CellGraph* cells = &state.cells;
+    state.camera.constrain = [cells](const glm::vec3& from, const glm::vec3& to) {
+        return cells->constrainMove(from, to, 0.3f);
     };
+    std::cout << "Museum: " << state.cells.size() << " rooms, " << paintings.size() << " paintings" << std::endl;
+}
 
-    // Setup floor VAO/VBO
-    glGenVertexArrays(1, &state.planeVAO);
-    glGenBuffers(1, &state.planeVBO);
-    
-    glBindVertexArray(state.planeVAO);
-    glBindBuffer(GL_ARRAY_BUFFER, state.planeVBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(planeVertices), planeVertices, GL_STATIC_DRAW);
-    
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
-    glEnableVertexAttribArray(2);
-
-    // Setup wall VAO/VBO
-    glGenVertexArrays(1, &state.wallVAO);
-    glGenBuffers(1, &state.wallVBO);
-    
-    glBindVertexArray(state.wallVAO);
-    glBindBuffer(GL_ARRAY_BUFFER, state.wallVBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(wallVertices), wallVertices, GL_STATIC_DRAW);
-    
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
-    glEnableVertexAttribArray(2);
-
-    glGenVertexArrays(1, &state.ceilingVAO);
-    glGenBuffers(1, &state.ceilingVBO);
-    
-    glBindVertexArray(state.ceilingVAO);
-    glBindBuffer(GL_ARRAY_BUFFER, state.ceilingVBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(ceilingVertices), ceilingVertices, GL_STATIC_DRAW);
-    
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
-    glEnableVertexAttribArray(2);
+// One indexed mesh for all rooms; each surface is a submesh with its own material.
+// The mesh gets lightmap UVs either way, and the geometry is kept for a bake.
+void setupGeometry(ApplicationState& state, bool museum) {
+    PROFILE_FUNCTION();
+    StaticMeshBuilder builder;
+    if (museum) {
+        setupMuseum(state, builder);
+    } else {
+        setupSingleRoom(state, builder);
+    }
+    state.lightmapAtlas = unwrapLightmap(builder, museum ? 2048 : 512, LIGHTMAP_TEXELS_PER_UNIT);
+    state.lightmapLayout = lightmapLayoutHash(builder, state.roomTransform.getModelMatrix(), state.lightmapAtlas.size);
+    state.lightmapPath = std::string(LIGHTMAP_DIR) + (museum ? "/museum.hdr" : "/room.hdr");
+    state.probePath = std::string(LIGHTMAP_DIR) + (museum ? "/museum_probes.bin" : "/room_probes.bin");
+    state.roomMesh.upload(builder);
+    state.bakeGeometry.reset(new StaticMeshBuilder(std::move(builder)));
+    state.paintings.build();
+    state.cells.buildBounds(state.roomMesh.getSubMeshes(), state.roomTransform.getModelMatrix(),
+                            state.paintings.getPaintings());
+
+    state.surfaceCells.assign(state.roomMesh.getSubMeshes().size(), 0);
+    for (size_t c = 0; c < state.cells.size(); ++c) {
+        const std::vector<uint32_t>& surfaces = state.cells.getCell((int)c).surfaces;
+        for (size_t i = 0; i < surfaces.size(); ++i) state.surfaceCells[surfaces[i]] = (int)c;
+    }
+    state.cellConditions.assign(state.cells.size(), 0);
+    state.cellsHidden.assign(state.cells.size(), 0);
+}
+
+// Box around every room
+void sceneBounds(const ApplicationState& state, glm::vec3& lo, glm::vec3& hi) {
+    lo = glm::vec3(1e30f);
+    hi = glm::vec3(-1e30f);
+    for (size_t c = 0; c < state.cells.size(); ++c) {
+        const Cell& cell = state.cells.getCell((int)c);
+        lo = glm::min(lo, cell.boundsMin);
+        hi = glm::max(hi, cell.boundsMax);
+    }
+}
+
+// A sculpture on the floor of each room, off centre towards the back left corner
+void setupSculptures(ApplicationState& state) {
+    PROFILE_FUNCTION();
+    for (size_t c = 0; c < state.cells.size(); ++c) {
+        const Cell& cell = state.cells.getCell((int)c);
+        glm::vec3 center = (cell.boundsMin + cell.boundsMax) * 0.5f;
+        state.sculptures.add(glm::vec3(center.x - 4.0f, cell.boundsMin.y, center.z - 4.0f), (int)c);
+    }
+    state.sculptures.build();
+}
+
+void setupMaterials(ApplicationState& state) {
+    PROFILE_FUNCTION();
+    for (int i = 0; i < MATERIAL_COUNT; ++i) {
+        state.materialTextures[i] = 0;
+        for (int j = 0; j < i; ++j) {
+            // Materials sharing an image share the texture
+            if (std::string(MATERIAL_PATHS[j]) == MATERIAL_PATHS[i]) state.materialTextures[i] = state.materialTextures[j];
+        }
+        if (!state.materialTextures[i]) state.materialTextures[i] = loadTexture(MATERIAL_PATHS[i]);
+    }
+}
+
+void setupIndirect(ApplicationState& state) {
+    PROFILE_FUNCTION();
+    state.indirectShader.reset(new Shader("shaders/indirect_vs.glsl", "shaders/indirect_fs.glsl"));
+    if (!state.indirectShader->isLinked()) {
+        std::cerr << "Indirect shader failed to build, using the regular draw path" << std::endl;
+        state.indirectShader.reset();
+        return;
+    }
+
+    // Material ID doubles as the array layer
+    state.materialArray = createTextureArray(512, 512, MATERIAL_COUNT);
+    for (int i = 0; i < MATERIAL_COUNT; ++i) {
+        loadTextureLayer(state.materialArray, i, MATERIAL_PATHS[i], 512, 512);
+    }
+    glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+
+    // Commands are filled in per frame from the visible submeshes
+    state.indirect.setMesh(state.roomMesh);
+    state.useIndirect = true;
+    std::cout << "Using multi-draw indirect backend (up to " << state.roomMesh.getSubMeshes().size()
+              << " draws per pass)" << std::endl;
+}
+
+// Both shading paths are built up front so the G key can switch between them
+void setupShading(ApplicationState& state, bool deferred) {
+    PROFILE_FUNCTION();
+    state.forwardShaders.room = &state.shader;
+    state.forwardShaders.painting = &state.paintingShader;
+    state.forwardShaders.frame = &state.frameShader;
+    state.forwardShaders.indirect = state.indirectShader.get();
+    state.forwardShaders.sculpture = &state.sculptureShader;
+
+    const char* GBUFFER = "#define GBUFFER\n";
+    std::vector<std::unique_ptr<Shader> >& programs = state.gbufferPrograms;
+    programs.push_back(std::unique_ptr<Shader>(new Shader("shaders/vertex_shader.glsl", "shaders/fragment_shader.glsl", GBUFFER)));
+    programs.push_back(std::unique_ptr<Shader>(new Shader("shaders/painting_vs.glsl", "shaders/painting_fs.glsl", GBUFFER)));
+    programs.push_back(std::unique_ptr<Shader>(new Shader("shaders/frame_vs.glsl", "shaders/frame_fs.glsl", GBUFFER)));
+    state.gbufferShaders.room = programs[0].get();
+    state.gbufferShaders.painting = programs[1].get();
+    state.gbufferShaders.frame = programs[2].get();
+    programs.push_back(std::unique_ptr<Shader>(new Shader("shaders/vertex_shader.glsl", "shaders/sculpture_fs.glsl", GBUFFER)));
+    state.gbufferShaders.sculpture = programs[3].get();
+    if (state.useIndirect) {
+        programs.push_back(std::unique_ptr<Shader>(new Shader("shaders/indirect_vs.glsl", "shaders/indirect_fs.glsl", GBUFFER)));
+        state.gbufferShaders.indirect = programs[4].get();
+        if (!state.gbufferShaders.indirect->isLinked()) {
+            std::cerr << "Indirect G-buffer shader failed to build, using the regular draw path" << std::endl;
+            state.useIndirect = false;
+        }
+    }
+
+    state.deferred.init();
+    state.useDeferred = deferred;
+    std::cout << "Shading: " << (deferred ? "deferred" : "forward") << " (G toggles)" << std::endl;
+}
+
+// Programs are built either way so the Z key can switch the pre-pass on
+void setupDepthPrepass(ApplicationState& state, bool enabled) {
+    PROFILE_FUNCTION();
+    state.prepass.init(state.useIndirect);
+    state.useDepthPrepass = enabled;
+    std::cout << "Depth pre-pass: " << (enabled ? "on" : "off") << " (Z toggles)" << std::endl;
+}
+
+void setupOcclusion(ApplicationState& state) {
+    PROFILE_FUNCTION();
+    state.occlusion.init();
+
+    for (size_t c = 0; c < state.cells.size(); ++c) {
+        const Cell& cell = state.cells.getCell((int)c);
+        state.occlusion.addGroup(cell.boundsMin, cell.boundsMax);
+    }
+
+    const std::vector<Painting>& paintings = state.paintings.getPaintings();
+    state.paintingNodes.assign(paintings.size(), -1);
+    state.paintingCells.assign(paintings.size(), 0);
+    for (size_t c = 0; c < state.cells.size(); ++c) {
+        const std::vector<uint32_t>& cellPaintings = state.cells.getCell((int)c).paintings;
+        for (size_t i = 0; i < cellPaintings.size(); ++i) {
+            // Box around the painting quad and its frame
+            const Painting& painting = paintings[cellPaintings[i]];
+            const glm::mat4& model = painting.getTransform().getModelMatrix();
+            glm::vec2 half = painting.getSize() * 0.5f + glm::vec2(Painting::FRAME_WIDTH);
+            glm::vec3 lo(1e30f), hi(-1e30f);
+            for (int corner = 0; corner < 8; ++corner) {
+                glm::vec4 local((corner & 1) ? half.x : -half.x, (corner & 2) ? half.y : -half.y,
+                                (corner & 4) ? Painting::FRAME_DEPTH : 0.0f, 1.0f);
+                glm::vec3 world(model * local);
+                lo = glm::min(lo, world);
+                hi = glm::max(hi, world);
+            }
+            state.paintingNodes[cellPaintings[i]] = state.occlusion.addNode((int)c, lo, hi);
+            state.paintingCells[cellPaintings[i]] = (int)c;
+        }
+    }
+    state.useOcclusion = true;
+
+    std::cout << "Occlusion queries: " << (OcclusionCuller::queryTarget() == GL_ANY_SAMPLES_PASSED_CONSERVATIVE
+                                           ? "conservative" : "exact") << " any-samples-passed" << std::endl;
 }
 
 void setupLighting(ApplicationState& state) {
+    PROFILE_FUNCTION();
     state.dirLight.direction = glm::vec3(1.0f, -10.0f, 0.0f);  
     state.dirLight.ambient = glm::vec3(0.7f, 0.83f, 0.80f);    // Increased ambient for brighter overall illumination
     state.dirLight.diffuse = glm::vec3(1.2f, 1.15f, 0.8f);     // Intensified warm sunlight
     state.dirLight.specular = glm::vec3(1.0f, 1.0f, 1.0f);     // Increased specular for stronger highlights
 }
 
+// A ceiling spot in front of and above each painting, its cone just covering the frame
+void setupSpotLights(ApplicationState& state) {
+    PROFILE_FUNCTION();
+    const std::vector<Painting>& paintings = state.paintings.getPaintings();
+    std::vector<SpotLight> lights;
+    for (size_t i = 0; i < paintings.size(); ++i) {
+        const Painting& painting = paintings[i];
+        glm::vec3 facing = glm::mat3(painting.getTransform().getModelMatrix()) * glm::vec3(0.0f, 0.0f, 1.0f);
+        glm::vec2 size = painting.getSize();
+        float extent = 0.5f * std::max(size.x, size.y) + Painting::FRAME_WIDTH;
+
+        SpotLight light;
+        light.position = painting.getPosition() + facing * (0.6f * size.y + 1.5f)
+                       + glm::vec3(0.0f, 0.5f * size.y + 1.0f, 0.0f);
+        glm::vec3 toPainting = painting.getPosition() - light.position;
+        float distance = glm::length(toPainting);
+        light.direction = toPainting / distance;
+        light.color = glm::vec3(1.0f, 0.88f, 0.7f);
+        light.range = distance + 2.0f * extent;
+        light.outerAngle = glm::clamp(glm::degrees(std::atan(1.2f * extent / distance)), 15.0f, 60.0f);
+        light.innerAngle = 0.7f * light.outerAngle;
+        lights.push_back(light);
+    }
+    state.spotLights.init();
+    state.spotLights.setLights(lights);
+}
+
+// The sun's shadow map covers every room; the ceilings are left out or nothing inside would be lit
+void setupShadows(ApplicationState& state) {
+    PROFILE_FUNCTION();
+    glm::vec3 lo, hi;
+    sceneBounds(state, lo, hi);
+    state.shadows.init();
+    state.shadows.setSceneBounds(lo, hi);
+    state.shadows.setLightDirection(state.dirLight.direction);
+    state.useShadows = true;
+}
+
+// Bakes the lightmap and probes if asked, or if rebakeStale and the bake on disk was
+// made for another layout or light set, then loads the bakes for this layout if there are any
+void setupLightmap(ApplicationState& state, bool bake, bool rebakeStale) {
+    PROFILE_FUNCTION();
+    glm::vec3 lo, hi;
+    sceneBounds(state, lo, hi);
+    state.probeGrid = makeProbeGrid(lo, hi, 2.0f);
+    unsigned long long bakeHash = lightmapLightsHash(state.lightmapLayout, state.dirLight, state.spotLights.getLights());
+    if (!bake && (bakeIsStale(state.lightmapPath, bakeHash) || bakeIsStale(state.probePath, bakeHash))) {
+        if (rebakeStale) {
+            std::cout << "Baked lighting in " << LIGHTMAP_DIR << " is out of date, baking it again" << std::endl;
+            bake = true;
+        } else {
+            std::cerr << "Baked lighting in " << LIGHTMAP_DIR << " is out of date and not baked again here"
+                      << " (--bake-lightmap does)" << std::endl;
+        }
+    }
+    if (bake) {
+        // Flat albedo per material; ceilings cast no shadows, as in the shadow map
+        std::vector<LightmapBaker::Material> materials(MATERIAL_COUNT);
+        for (int i = 0; i < MATERIAL_COUNT; ++i) {
+            materials[i].albedo = averageTextureColor(MATERIAL_PATHS[i]);
+            materials[i].castsShadows = i != MATERIAL_CEILING;
+        }
+        std::vector<float> texels;
+        std::vector<ProbeSH> probes;
+        LightmapBaker::Settings settings;
+        LightmapBaker baker;
+        baker.setScene(*state.bakeGeometry, state.roomTransform.getModelMatrix(), materials);
+        baker.setLights(state.dirLight, state.spotLights.getLights());
+        baker.bake(state.lightmapAtlas, settings, texels);
+        baker.bakeProbes(state.probeGrid, settings, probes);
+        mkdir(LIGHTMAP_DIR, 0755);
+        saveLightmap(state.lightmapPath, state.lightmapAtlas.size, texels, bakeHash);
+        saveProbes(state.probePath, state.probeGrid, probes, bakeHash);
+    }
+    state.lightmap = loadLightmap(state.lightmapPath, state.lightmapAtlas.size, bakeHash);
+    state.useLightmap = state.lightmap != 0;
+    if (state.useLightmap) std::cout << "Lighting: baked (L toggles)" << std::endl;
+    state.useProbes = state.probes.load(state.probePath, state.probeGrid, bakeHash);
+    if (state.useProbes) std::cout << "Ambient: probes (P toggles)" << std::endl;
+}
+
+// Distance in front of the camera, used for sort keys
+float viewDepth(const glm::mat4& view, const glm::vec3& worldPos) {
+    return -(view * glm::vec4(worldPos, 1.0f)).z;
+}
+
+DrawCommand roomDrawCommand(ApplicationState& state, Shader& shader, const SubMesh& subMesh) {
+    DrawCommand cmd;
+    cmd.shader = &shader;
+    cmd.vao = state.roomMesh.getVAO();
+    cmd.textureTarget = GL_TEXTURE_2D;
+    cmd.texture = state.materialTextures[subMesh.materialId];
+    cmd.transform = &state.roomTransform;
+    cmd.mode = GL_TRIANGLES;
+    cmd.count = subMesh.indexCount;
+    cmd.indexType = state.roomMesh.getIndexType();
+    cmd.first = state.roomMesh.indexOffset(subMesh);
+    cmd.instanceCount = 0;
+    cmd.condition = 0;
+    cmd.depthShader = state.useDepthPrepass ? &state.prepass.meshShader() : NULL;
+    cmd.depthVao = state.roomMesh.getDepthVAO();
+    return cmd;
+}
+
+// Finds the rooms visible through portals and their surfaces and paintings
+// inside the narrowed frustums, then drops what occlusion queries hid
+void cullScene(ApplicationState& state, const glm::mat4& viewProjection, float pixelScale) {
+    PROFILE_FUNCTION();
+    CellVisibility& visibility = state.visibility;
+    state.frustum.extract(viewProjection);
+    if (state.useCulling) {
+        state.cells.findVisible(viewProjection, state.camera.position, visibility);
+    } else {
+        visibility.cells.clear();
+        visibility.surfaces.clear();
+        visibility.paintings.clear();
+        for (size_t c = 0; c < state.cells.size(); ++c) {
+            const Cell& cell = state.cells.getCell((int)c);
+            visibility.cells.push_back((int)c);
+            visibility.surfaces.insert(visibility.surfaces.end(), cell.surfaces.begin(), cell.surfaces.end());
+            visibility.paintings.insert(visibility.paintings.end(), cell.paintings.begin(), cell.paintings.end());
+        }
+    }
+
+    state.visibleSurfaces = visibility.surfaces;
+    state.visiblePaintings = visibility.paintings;
+    if (state.useOcclusion) {
+        // Results from earlier frames only; nothing here waits on the GPU
+        state.occlusion.collectResults(state.camera.position);
+        for (size_t i = 0; i < visibility.cells.size(); ++i) {
+            int cell = visibility.cells[i];
+            state.cellConditions[cell] = 0;
+            state.cellsHidden[cell] = 0;
+            if (!state.occlusion.isGroupVisible(cell)) {
+                // Hidden last we knew: let the GPU decide if a newer result is in flight
+                state.cellConditions[cell] = state.occlusion.conditionFor(cell);
+                state.cellsHidden[cell] = state.cellConditions[cell] == 0;
+            }
+        }
+
+        size_t kept = 0;
+        for (size_t i = 0; i < state.visibleSurfaces.size(); ++i) {
+            uint32_t surface = state.visibleSurfaces[i];
+            if (!state.cellsHidden[state.surfaceCells[surface]]) state.visibleSurfaces[kept++] = surface;
+        }
+        state.visibleSurfaces.resize(kept);
+
+        // Paintings cannot be drawn conditionally, as a batch spans rooms; in a room
+        // whose result is still pending they are kept, so they appear with its walls
+        kept = 0;
+        for (size_t i = 0; i < state.visiblePaintings.size(); ++i) {
+            uint32_t painting = state.visiblePaintings[i];
+            if (state.occlusion.isNodeVisible(state.paintingNodes[painting])
+                || state.cellConditions[state.paintingCells[painting]]) {
+                state.visiblePaintings[kept++] = painting;
+            }
+        }
+        state.stats.paintingsOccluded = (unsigned int)(state.visiblePaintings.size() - kept);
+        state.visiblePaintings.resize(kept);
+    }
+    state.paintings.setVisible(state.visiblePaintings);
+    state.paintings.updateLODs(state.camera.position, pixelScale);
+
+    // Sculptures in the rooms reached; all of them cast shadows, those in view are drawn
+    state.visibleSculptures.clear();
+    state.shadowSculptures.clear();
+    for (size_t i = 0; i < state.sculptures.size(); ++i) {
+        int cell = state.sculptures.getCell(i);
+        if (std::find(visibility.cells.begin(), visibility.cells.end(), cell) == visibility.cells.end()) continue;
+        state.shadowSculptures.push_back((uint32_t)i);
+        if (state.useOcclusion && state.cellsHidden[cell]) continue;
+        glm::vec3 lo, hi;
+        state.sculptures.getBounds(i, lo, hi);
+        if (!state.useCulling || state.frustum.intersectsBox(lo, hi)) state.visibleSculptures.push_back((uint32_t)i);
+    }
+    state.shadowCasters.clear();
+    state.sculptures.addShadowCasters(state.shadowSculptures, state.shadowCasters);
+
+    size_t surfaceCount = state.roomMesh.getSubMeshes().size();
+    size_t paintingCount = state.paintings.getPaintings().size();
+    state.stats.cellsVisible = (unsigned int)visibility.cells.size();
+    state.stats.cellCount = (unsigned int)state.cells.size();
+    state.stats.portalsTested = visibility.portalsTested;
+    state.stats.surfacesVisible = (unsigned int)state.visibleSurfaces.size();
+    state.stats.surfacesCulled = (unsigned int)(surfaceCount - state.visibleSurfaces.size());
+    state.stats.paintingsVisible = (unsigned int)state.visiblePaintings.size();
+    state.stats.paintingsCulled = (unsigned int)(paintingCount - state.visiblePaintings.size());
+    for (int level = 0; level < PaintingRenderer::LOD_COUNT; ++level) {
+        state.stats.paintingLODs[level] = state.paintings.lodCount(level);
+    }
+    const ClusteredLighting::Stats& lightStats = state.spotLights.getStats();
+    state.stats.lightsInView = lightStats.lightsInView;
+    state.stats.lightIndices = lightStats.lightIndices;
+    state.stats.maxClusterLights = lightStats.maxClusterLights;
+}
+
+// Uniforms shared by every lit program for this frame
+void setFrameUniforms(Shader& shader, ApplicationState& state, const glm::mat4& view, const glm::mat4& projection) {
+    shader.setVec3("dirLight.direction", state.dirLight.direction);
+    shader.setVec3("dirLight.ambient", state.dirLight.ambient);
+    shader.setVec3("dirLight.diffuse", state.dirLight.diffuse);
+    shader.setVec3("dirLight.specular", state.dirLight.specular);
+
+    shader.setFloat("material.shininess", 16.0f);
+    shader.setVec3("viewPos", state.camera.position);
+
+    shader.setMat4("view", view);
+    shader.setMat4("projection", projection);
+    state.spotLights.apply(shader);
+    state.shadows.apply(shader, state.useShadows);
+
+    // Set even when unused so the sampler never shares a unit with one of another type
+    shader.setInt("lightmap", (int)LIGHTMAP_UNIT);
+    shader.setInt("useLightmap", state.useLightmap);
+    if (state.useLightmap) glState().bindTextureUnit(LIGHTMAP_UNIT, GL_TEXTURE_2D, state.lightmap);
+    state.probes.apply(shader, state.useProbes);
+}
+
+// Redraws the cached static shadow map only if the light or bounds changed,
+// then draws this frame's dynamic casters over a copy of it
+void renderShadows(ApplicationState& state) {
+    PROFILE_FUNCTION();
+    ShadowMap& shadows = state.shadows;
+    shadows.beginFrame();
+    if (!state.useShadows) return;
+    shadows.setLightDirection(state.dirLight.direction);
+
+    Shader& depth = shadows.depthShader();
+    if (shadows.needsStaticUpdate()) {
+        shadows.beginStatic();
+        depth.use();
+        depth.setMat4("model", state.roomTransform.getModelMatrix());
+        glState().bindVertexArray(state.roomMesh.getDepthVAO());
+        const std::vector<SubMesh>& subMeshes = state.roomMesh.getSubMeshes();
+        for (size_t i = 0; i < subMeshes.size(); ++i) {
+            if (subMeshes[i].materialId == MATERIAL_CEILING) continue;
+            glDrawElements(GL_TRIANGLES, subMeshes[i].indexCount, state.roomMesh.getIndexType(),
+                           (void*)state.roomMesh.indexOffset(subMeshes[i]));
+            renderStats().countDraw(GL_TRIANGLES, subMeshes[i].indexCount);
+        }
+        state.paintings.drawShadowCasters(shadows.instancedDepthShader());
+        shadows.endStatic();
+        state.stats.shadowMapRendered = true;
+    }
+
+    if (!state.shadowCasters.empty()) {
+        shadows.beginDynamic();
+        depth.use();
+        for (size_t i = 0; i < state.shadowCasters.size(); ++i) {
+            const DrawCommand& cmd = state.shadowCasters[i];
+            depth.setMat4("model", cmd.transform ? cmd.transform->getModelMatrix() : glm::mat4(1.0f));
+            glState().bindVertexArray(cmd.depthVao ? cmd.depthVao : cmd.vao);
+            if (cmd.indexType) {
+                glDrawElements(cmd.mode, cmd.count, cmd.indexType, (void*)cmd.first);
+            } else {
+                glDrawArrays(cmd.mode, (GLint)cmd.first, cmd.count);
+            }
+            renderStats().countDraw(cmd.mode, cmd.count);
+        }
+        shadows.endDynamic();
+    }
+    state.stats.shadowsEnabled = true;
+    state.stats.shadowCasters = (unsigned int)state.shadowCasters.size();
+    state.stats.shadowMapRenders = shadows.staticRenders();
+}
+
 void render(GLFWwindow* window, ApplicationState& state) {
-    float currentFrame = glfwGetTime();
+    PROFILE_FUNCTION();
+    float currentFrame = state.fixedDeltaTime > 0.0f ? state.lastFrame + state.fixedDeltaTime : (float)glfwGetTime();
     state.deltaTime = currentFrame - state.lastFrame;
     state.lastFrame = currentFrame;
 
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-    state.camera.processKeyboardInput(window, state.deltaTime);
+    glState().beginFrame();
 
+    // Before anything per frame is opened, so an empty frame has nothing to close
     int width, height;
     glfwGetFramebufferSize(window, &width, &height);
-    if (width == 0 || height == 0) return;
+    if (width == 0 || height == 0) {
+        glfwPollEvents(); // minimised: nothing to draw, but keep handling events
+        return;
+    }
 
-    state.shader.use();
-    
-    state.shader.setVec3("dirLight.direction", state.dirLight.direction);
-    state.shader.setVec3("dirLight.ambient", state.dirLight.ambient);
-    state.shader.setVec3("dirLight.diffuse", state.dirLight.diffuse);
-    state.shader.setVec3("dirLight.specular", state.dirLight.specular);
-    
-    state.shader.setFloat("material.shininess", 16.0f);
-    state.shader.setVec3("viewPos", state.camera.position);
+    state.frameData.beginFrame();
+    GpuProfiler& profiler = state.gpuProfiler;
+    profiler.beginFrame();
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    int framePass = profiler.begin("frame");
+
+    // The scene may be drawn offscreen at a lower resolution and scaled up at the end
+    int renderWidth = width, renderHeight = height;
+    if (state.useDynamicResolution) {
+        state.resolution.beginFrame(width, height);
+        renderWidth = state.resolution.renderWidth();
+        renderHeight = state.resolution.renderHeight();
+    }
+
+    // Sample input as late as possible: the mouse callback and the movement
+    // keys land just before the view is built, not a whole frame earlier
+    glfwPollEvents();
+    state.input.update(currentFrame);
+    state.pacer.inputSampled();
+    const std::vector<Input::CursorPosition>& cursorMoves = state.input.cursorMoves();
+    for (size_t i = 0; i < cursorMoves.size(); ++i) {
+        state.camera.processMouseMovement(cursorMoves[i].x, cursorMoves[i].y);
+    }
+    state.camera.processKeyboardInput(state.input, state.deltaTime);
 
     // Set matrices
     glm::mat4 view = state.camera.getViewMatrix();
-    glm::mat4 projection = glm::perspective(glm::radians(45.0f), (float)width / height, 0.1f, 100.0f);
-    state.shader.setMat4("view", view);
-    state.shader.setMat4("projection", projection);
+    float fovY = glm::radians(45.0f);
+    glm::mat4 projection = glm::perspective(fovY, (float)width / height, 0.1f, 100.0f);
+    state.spotLights.update(view, projection, 0.1f, 100.0f, renderWidth, renderHeight);
+    state.stats.reset();
+    state.sculptures.update(currentFrame);
 
-    // Render floor
-    glm::mat4 model = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, -1.0f, 0.0f));
-    state.shader.setMat4("model", model);
-    
-    glBindVertexArray(state.planeVAO);
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, state.planeTexture);
-    state.shader.setInt("material.diffuse", 0);
-    glDrawArrays(GL_TRIANGLES, 0, 6);
-
-    // Render walls
-    model = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, -1.0f, 0.0f));
-    state.shader.setMat4("model", model);
-    
-    glBindVertexArray(state.wallVAO);
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, state.wallTexture);
-    state.shader.setInt("material.diffuse", 0);
-    glDrawArrays(GL_TRIANGLES, 0, 24); // 4 walls * 2 triangles * 3 vertices
-
-    model = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, -1.0f, 0.0f));
-    state.shader.setMat4("model", model);
-    
-    glBindVertexArray(state.ceilingVAO);
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, state.ceilingTexture);
-    state.shader.setInt("material.diffuse", 0);
-    glDrawArrays(GL_TRIANGLES, 0, 6);
+    // Pixels covered by one world unit at unit distance, for painting LOD
+    int pass = profiler.begin("culling");
+    cullScene(state, projection * view, height / (2.0f * std::tan(fovY * 0.5f)));
+    profiler.end(pass);
+    pass = profiler.begin("shadows");
+    renderShadows(state);
+    profiler.end(pass);
+    if (state.useDynamicResolution) state.resolution.bindTarget();
+    const SurfaceShaders& shaders = state.useDeferred ? state.gbufferShaders : state.forwardShaders;
+    setFrameUniforms(*shaders.room, state, view, projection);
+    setFrameUniforms(*shaders.painting, state, view, projection);
+    setFrameUniforms(*shaders.frame, state, view, projection);
+    setFrameUniforms(*shaders.sculpture, state, view, projection);
+    const std::vector<SubMesh>& subMeshes = state.roomMesh.getSubMeshes();
+
+    // Queue every visible draw, then sort so draws sharing state run back to back
+    RenderQueue& queue = state.renderQueue;
+    queue.clear();
+    queue.setDepthRange(100.0f);
+    glm::vec3 roomOffset = state.roomTransform.getPosition();
+    if (state.useDeferred) state.deferred.beginGeometry(renderWidth, renderHeight);
+    if (state.useIndirect) {
+        // The room goes out as one multi-draw instead of through the queue
+        setFrameUniforms(*shaders.indirect, state, view, projection);
+        if (state.indirectSurfaces != state.visibleSurfaces) {
+            // Rebuild the command buffer only when the visible set changes
+            state.indirect.clear();
+            for (size_t i = 0; i < state.visibleSurfaces.size(); ++i) {
+                const SubMesh& subMesh = subMeshes[state.visibleSurfaces[i]];
+                state.indirect.add(subMesh, state.roomTransform, subMesh.materialId);
+            }
+            state.indirectSurfaces = state.visibleSurfaces;
+        }
+    } else {
+        for (size_t i = 0; i < state.visibleSurfaces.size(); ++i) {
+            const SubMesh& subMesh = subMeshes[state.visibleSurfaces[i]];
+            DrawCommand cmd = roomDrawCommand(state, *shaders.room, subMesh);
+            if (state.useOcclusion) cmd.condition = state.cellConditions[state.surfaceCells[state.visibleSurfaces[i]]];
+            glm::vec3 center = roomOffset + (subMesh.boundsMin + subMesh.boundsMax) * 0.5f;
+            queue.submit(PASS_OPAQUE, cmd, viewDepth(view, center));
+        }
+    }
+
+    DepthPrepass& prepass = state.prepass;
+    bool prepassOn = state.useDepthPrepass;
+    state.paintings.submit(queue, *shaders.painting, *shaders.frame, view,
+                           prepassOn ? &prepass.paintingShader() : NULL, prepassOn ? &prepass.frameShader() : NULL);
+    state.sculptures.submit(queue, *shaders.sculpture, state.visibleSculptures, view, state.cellConditions,
+                            prepassOn ? &prepass.meshShader() : NULL);
+
+    shaders.room->setInt("material.diffuse", 0);
+    queue.sort();
+    queue.writeObjects(state.frameData);
+    state.frameData.flush();
+    if (prepassOn) {
+        pass = profiler.begin("depth pre-pass");
+        prepass.setMatrices(view, projection);
+        prepass.begin();
+        if (state.useIndirect) {
+            state.indirect.submitDepth(prepass.multiDrawShader());
+            state.stats.prepassDraws = 1;
+        }
+        state.stats.prepassDraws += queue.executeDepth();
+        prepass.end();
+        profiler.end(pass);
+    }
+    pass = profiler.begin(state.useDeferred ? "geometry" : "opaque");
+    prepass.beginCount(renderWidth * renderHeight);
+    // One multi-draw cannot be conditional per room; rooms awaiting a result are drawn
+    if (state.useIndirect) state.indirect.submit(*shaders.indirect, state.materialArray);
+    queue.execute();
+    state.frameData.endFrame();
+    state.stats.frameDataBytes = (unsigned int)state.frameData.frameBytes();
+    state.stats.frameDataStalls = state.frameData.stalls();
+    prepass.endCount();
+    profiler.end(pass);
+    if (prepassOn) prepass.restore();
+    state.stats.depthPrepass = prepassOn;
+    state.stats.shadedCounted = prepass.hasCount();
+    state.stats.shadedSamples = prepass.shadedSamples();
+    state.stats.samplesPerPixel = prepass.samplesPerPixel();
 
-    // Render all paintings
-    for (auto& painting : state.paintings) {
-        painting.draw(state.shader);
+    // Test bounding boxes against this frame's depth (the G-buffer's when deferred); read back next frame or later
+    if (state.useOcclusion) {
+        pass = profiler.begin("occlusion");
+        state.occlusion.issueQueries(state.frustum, state.camera.position, view, projection, &state.visibility.cells);
+        profiler.end(pass);
+        state.stats.occlusionQueries = state.occlusion.getStats().queriesIssued;
     }
+
+    if (state.useDeferred) {
+        state.deferred.endGeometry(state.useDynamicResolution ? state.resolution.framebuffer()
+                                                               : glState().defaultFramebuffer());
+        setFrameUniforms(state.deferred.lightingShader(), state, view, projection);
+        pass = profiler.begin("lighting");
+        state.deferred.resolve(view, projection);
+        profiler.end(pass);
+    }
+    state.stats.deferredShading = state.useDeferred;
+
+    if (state.useDynamicResolution) {
+        pass = profiler.begin("upscale");
+        state.resolution.endFrame();
+        profiler.end(pass);
+        state.stats.dynamicResolution = true;
+        state.stats.renderScale = state.resolution.scale();
+        state.stats.renderWidth = renderWidth;
+        state.stats.renderHeight = renderHeight;
+        state.stats.gpuFrameMs = state.resolution.gpuMs();
+    }
+    profiler.end(framePass);
+    profiler.endFrame();
 }
 
-int main() {
-    GLFWwindow* window = initializeWindow();
+int main(int argc, char** argv) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) return 1;
+    if (options.traceFile) Profiler::start();
+    Profiler::setThreadName("main");
+    uint64_t startupBegin = Profiler::now();
+    BenchmarkReport report;
+    bool headless = options.headlessFrames > 0;
+    if (headless) {
+        // Nothing to sync to; frames go as fast as the renderer allows unless --fps-limit says otherwise
+        options.swapInterval = SWAP_UNCAPPED;
+    }
+
+    GLFWwindow* window = initializeWindow(options);
     if (!window) return -1;
+    report.markPhase("context");
 
+    int status = runGallery(window, options, report, startupBegin);
+    glfwTerminate();
+    return status;
+}
+
+// Everything that owns GL objects lives in here, so it is all deleted while
+// the context is still current, before main() terminates GLFW
+int runGallery(GLFWwindow* window, const Options& options, BenchmarkReport& report, uint64_t startupBegin) {
+    bool headless = options.headlessFrames > 0;
     ApplicationState state;
-    glfwSetWindowUserPointer(window, &state.camera);
+    if (headless) {
+        if (!state.offscreen.init(options.width, options.height)) return -1;
+        report.setTarget((const char*)glGetString(GL_RENDERER), options.width, options.height);
+    }
+    state.input.attach(window);
+    if (options.timestepMs > 0.0f) state.fixedDeltaTime = options.timestepMs / 1000.0f;
+    if (options.replayFile) {
+        if (!state.input.startReplay(options.replayFile)) return -1;
+        // Unless told otherwise, step the way the log was recorded so the camera retraces its path
+        if (state.fixedDeltaTime == 0.0f) {
+            state.fixedDeltaTime = state.input.recordedStep() > 0.0f ? state.input.recordedStep() : 1.0f / 60.0f;
+        }
+    }
+    if (options.recordFile && !state.input.startRecording(options.recordFile, state.fixedDeltaTime)) return -1;
     glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
-    glfwSetCursorPosCallback(window, mouse_callback);
     glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
     glEnable(GL_DEPTH_TEST);
+    state.useCulling = options.useCulling;
+    state.paintings.setForcedLOD(options.forceLOD);
 
-    setupGeometry(state);
+    setupGeometry(state, options.museum);
+    setupSculptures(state);
     setupLighting(state);
+    setupSpotLights(state);
+    // Headless runs are unattended benchmarks and never start a bake of their own
+    if (options.useBakedLighting) {
+        setupLightmap(state, options.bakeLightmap, !headless);
+    } else {
+        std::cout << "Lighting: dynamic, baked lighting ignored" << std::endl;
+    }
+    state.bakeGeometry.reset();
+    report.markPhase("scene");
 
     // load textures 
-    state.planeTexture = loadTexture("assets/textures/black_tile.jpg");
-    state.wallTexture = loadTexture("assets/textures/gray.png");
-    state.ceilingTexture = loadTexture("assets/textures/gray.png"); // New: load ceiling texture
+    setupMaterials(state);
+    if (options.useIndirect && !options.forceGL33 && IndirectRenderer::isSupported()) {
+        setupIndirect(state);
+    }
+    report.markPhase("textures");
 
-    glm::vec2 imageSize = getImageSize("assets/textures/otter.jpg");
-    float maxWidth = 10.0f;
-    float maxHeight = 5.0f;
+    setupShading(state, options.deferred);
+    setupDepthPrepass(state, options.depthPrepass);
+    if (options.frameBudgetMs > 0.0f) {
+        DynamicResolution::Settings settings;
+        settings.budgetMs = options.frameBudgetMs;
+        state.resolution.init(settings);
+        state.useDynamicResolution = true;
+    }
+    if (options.useShadows) {
+        setupShadows(state);
+    }
 
-    glm::vec2 scaledSize = scaleToFit(imageSize, maxWidth*2, maxHeight*2);
-    
-    state.paintings.emplace_back(
-        "assets/textures/otter.jpg",
-        glm::vec3(0.0f, 4.3f, -9.9f),  
-        scaledSize
-    );
+    if (state.useCulling && options.useOcclusion) {
+        setupOcclusion(state);
+    }
+    state.pacer.init(options.swapInterval, options.fpsLimit);
+    state.gpuProfiler.init();
+    // Room for a few hundred draw transforms a frame; the queue grows it if needed
+    state.frameData.init(GL_UNIFORM_BUFFER, 64 * 1024, !options.forceGL33);
+    report.markPhase("renderer");
 
+    // Everything uploaded so far was loading; frames count from here
+    const FrameWork& startup = renderStats().currentFrame();
+    std::cout << "Startup uploads: " << startup[FrameWork::BUFFER_BYTES] / 1024 << " KB buffers, "
+              << startup[FrameWork::TEXTURE_BYTES] / 1024 << " KB textures" << std::endl;
+    report.setStartupUploads(startup[FrameWork::BUFFER_BYTES], startup[FrameWork::TEXTURE_BYTES]);
+    renderStats().discardFrame();
+    if (Profiler::isEnabled()) Profiler::record("startup", startupBegin, Profiler::now());
+    std::ofstream statsCsv;
+    if (options.statsCsv) {
+        statsCsv.open(options.statsCsv);
+        if (statsCsv) RenderStats::writeCsvHeader(statsCsv);
+        else std::cerr << "Cannot write " << options.statsCsv << std::endl;
+    }
+
+    float lastStatsTime = 0.0f;
+    int headlessFrame = 0;
+    bool toggleWasPressed = false;
+    bool lightmapWasPressed = false;
+    bool probesWasPressed = false;
+    bool prepassWasPressed = false;
     while (!glfwWindowShouldClose(window)) {
-        if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS) {
+        if (state.input.isKeyDown(GLFW_KEY_ESCAPE) || state.input.replayFinished()) {
             glfwSetWindowShouldClose(window, true);
         }
+        bool togglePressed = state.input.isKeyDown(GLFW_KEY_G);
+        if (togglePressed && !toggleWasPressed) {
+            state.useDeferred = !state.useDeferred;
+            std::cout << "Shading: " << (state.useDeferred ? "deferred" : "forward") << std::endl;
+        }
+        toggleWasPressed = togglePressed;
+        bool lightmapPressed = state.input.isKeyDown(GLFW_KEY_L);
+        if (lightmapPressed && !lightmapWasPressed && state.lightmap) {
+            state.useLightmap = !state.useLightmap;
+            std::cout << "Lighting: " << (state.useLightmap ? "baked" : "dynamic") << std::endl;
+        }
+        lightmapWasPressed = lightmapPressed;
+        bool probesPressed = state.input.isKeyDown(GLFW_KEY_P);
+        if (probesPressed && !probesWasPressed && state.probes.isLoaded()) {
+            state.useProbes = !state.useProbes;
+            std::cout << "Ambient: " << (state.useProbes ? "probes" : "flat") << std::endl;
+        }
+        probesWasPressed = probesPressed;
+        bool prepassPressed = state.input.isKeyDown(GLFW_KEY_Z);
+        if (prepassPressed && !prepassWasPressed) {
+            state.useDepthPrepass = !state.useDepthPrepass;
+            std::cout << "Depth pre-pass: " << (state.useDepthPrepass ? "on" : "off") << std::endl;
+        }
+        prepassWasPressed = prepassPressed;
 
+        PROFILE_SCOPE("frame");
+        // Wait out the frame limit before render() samples input
+        {
+            PROFILE_SCOPE("frame limiter");
+            state.pacer.waitForFrame();
+        }
         render(window, state);
-        glfwSwapBuffers(window);
-        glfwPollEvents();
+        if (headless) {
+            // No surface to present; wait for the GPU so each frame's time covers its rendering
+            PROFILE_SCOPE("finish");
+            glFinish();
+        } else {
+            PROFILE_SCOPE("swap buffers");
+            glfwSwapBuffers(window);
+        }
+        state.pacer.frameSwapped();
+        state.stats.swapInterval = state.pacer.swapInterval();
+        state.stats.frameMs = state.pacer.frameMs();
+        state.stats.limiterWaitMs = state.pacer.waitMs();
+        state.stats.inputLatencyMs = state.pacer.inputLatencyMs();
+        // glState() still holds this frame's counters until the next render()
+        renderStats().endFrame(glState().currentFrame());
+        if (statsCsv.is_open()) renderStats().writeCsvRow(statsCsv);
+        if (headless) {
+            if (headlessFrame >= HEADLESS_WARMUP_FRAMES) report.addFrame(state.pacer.frameMs(), renderStats().lastFrame());
+            if (++headlessFrame == HEADLESS_WARMUP_FRAMES + options.headlessFrames) glfwSetWindowShouldClose(window, true);
+        }
+
+        if ((options.printStats || statsCsv.is_open()) && state.lastFrame - lastStatsTime >= 1.0f) {
+            if (options.printStats) {
+                printFrameStats(std::cout, state.stats);
+                renderStats().printSummary(std::cout);
+                state.gpuProfiler.print(std::cout);
+            }
+            statsCsv.flush();
+            lastStatsTime = state.lastFrame;
+        }
     }
 
-    glDeleteVertexArrays(1, &state.planeVAO);
-    glDeleteBuffers(1, &state.planeVBO);
-    glfwTerminate();
-    return 0;
+    std::cout << "Last frame: ";
+    printFrameStats(std::cout, state.stats);
+    renderStats().printSummary(std::cout);
+    state.gpuProfiler.print(std::cout);
+    if (options.traceFile) Profiler::writeChromeTrace(options.traceFile);
+    // A benchmark whose outputs could not be written fails, so scripts never read stale files
+    int status = 0;
+    if (headless) {
+        std::cout << "Headless: " << report.frameCount() << " frames, median " << report.framePercentile(50.0f)
+                  << " ms, 99th percentile " << report.framePercentile(99.0f) << " ms" << std::endl;
+        if (options.reportFile) {
+            std::ofstream out(options.reportFile);
+            report.writeJson(out);
+            if (!out) {
+                std::cerr << "Cannot write " << options.reportFile << std::endl;
+                status = 1;
+            }
+        } else {
+            report.writeJson(std::cout);
+        }
+        if (options.captureFile && !state.offscreen.writePPM(options.captureFile)) status = 1;
+    }
+    return status;
 }
 
 // Helper functions
@@ -364,23 +1118,48 @@ void framebuffer_size_callback(GLFWwindow* window, int width, int height) {
     }
 }
 
-void mouse_callback(GLFWwindow* window, double xposIn, double yposIn) {
-    Camera* camera = (Camera*)glfwGetWindowUserPointer(window);
-    camera->processMouseMovement(xposIn, yposIn);
+// Prefer 4.3 for multi-draw indirect; 3.3 remains the baseline
+GLFWwindow* createContextWindow(const Options& options) {
+    GLFWwindow* window = NULL;
+    if (!options.forceGL33) {
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+        window = glfwCreateWindow(options.width, options.height, WINDOW_NAME, NULL, NULL);
+    }
+    if (!window) {
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+        window = glfwCreateWindow(options.width, options.height, WINDOW_NAME, NULL, NULL);
+    }
+    return window;
 }
 
-GLFWwindow* initializeWindow() {
+GLFWwindow* initializeWindow(const Options& options) {
+    PROFILE_FUNCTION();
+    bool headless = options.headlessFrames > 0;
+#ifdef GLFW_PLATFORM_NULL
+    // GLFW 3.4's null platform needs no display server at all
+    if (headless) glfwInitHint(GLFW_PLATFORM, GLFW_PLATFORM_NULL);
+#endif
     if (!glfwInit()) {
         std::cerr << "GLFW initialization failed!" << std::endl;
         return nullptr;
     }
 
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
     glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+    if (headless) {
+        // Surfaceless EGL (Mesa's llvmpipe on GPU-less hosts); rendering goes to an offscreen target
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+        glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_EGL_CONTEXT_API);
+    }
 
-    GLFWwindow* window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, WINDOW_NAME, NULL, NULL);
+    GLFWwindow* window = createContextWindow(options);
+    if (!window && headless) {
+        std::cerr << "No EGL context; trying OSMesa" << std::endl;
+        glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_OSMESA_CONTEXT_API);
+        window = createContextWindow(options);
+    }
     if (!window) {
         std::cerr << "GLFW window creation failed!" << std::endl;
         glfwTerminate();
@@ -389,6 +1168,7 @@ GLFWwindow* initializeWindow() {
 
     glfwMakeContextCurrent(window);
     
+    glewExperimental = GL_TRUE; // core profiles need this for GLEW to load every entry point
     if (glewInit() != GLEW_OK) {
         std::cerr << "GLEW initialization failed!" << std::endl;
         return nullptr;
@@ -0,0 +1,150 @@
+#include "museum.h"
+#include <algorithm>
+#include <cmath>
+
+enum WallSide { SIDE_NORTH = 0, SIDE_EAST, SIDE_SOUTH, SIDE_WEST }; // north is -Z
+
+// Texture coordinates follow world position so tiling lines up across rooms
+static glm::vec2 surfaceUV(const glm::vec3& p, const glm::vec3& normal) {
+    if (std::fabs(normal.y) > 0.5f) return glm::vec2((p.x + 10.0f) * 0.5f, (p.z + 10.0f) * 0.5f);
+    if (std::fabs(normal.z) > 0.5f) return glm::vec2((p.x + 10.0f) * 0.25f, p.y);
+    return glm::vec2((10.0f - p.z) * 0.25f, p.y);
+}
+
+// Adds a quad given in either winding, turned so it faces along 'normal'
+static void addFace(StaticMeshBuilder& builder, const glm::vec3& a, const glm::vec3& b, const glm::vec3& c,
+                    const glm::vec3& d, const glm::vec3& normal) {
+    Vertex va(a, normal, surfaceUV(a, normal)), vb(b, normal, surfaceUV(b, normal));
+    Vertex vc(c, normal, surfaceUV(c, normal)), vd(d, normal, surfaceUV(d, normal));
+    if (glm::dot(glm::cross(b - a, c - a), normal) >= 0.0f) {
+        builder.addQuad(va, vb, vc, vd);
+    } else {
+        builder.addQuad(va, vd, vc, vb);
+    }
+}
+
+// Point on a wall: 'along' runs the length of the wall, 'line' is the
+// wall's fixed coordinate
+static glm::vec3 wallPoint(WallSide side, float along, float line, float y) {
+    return (side == SIDE_NORTH || side == SIDE_SOUTH) ? glm::vec3(along, y, line) : glm::vec3(line, y, along);
+}
+
+static glm::vec3 sideNormal(WallSide side) {
+    switch (side) {
+        case SIDE_NORTH: return glm::vec3(0.0f, 0.0f, 1.0f);
+        case SIDE_SOUTH: return glm::vec3(0.0f, 0.0f, -1.0f);
+        case SIDE_WEST:  return glm::vec3(1.0f, 0.0f, 0.0f);
+        default:         return glm::vec3(-1.0f, 0.0f, 0.0f);
+    }
+}
+
+static void addWallSegment(StaticMeshBuilder& builder, WallSide side, float line, float a0, float a1, float y0, float y1) {
+    if (a1 - a0 <= 0.0f || y1 - y0 <= 0.0f) return;
+    addFace(builder, wallPoint(side, a0, line, y0), wallPoint(side, a1, line, y0),
+            wallPoint(side, a1, line, y1), wallPoint(side, a0, line, y1), sideNormal(side));
+}
+
+// Offset of the doorway in a room's north (dir 1) or east (dir 0) wall: -1, 0 or +1 quarter rooms
+static float doorOffset(int column, int row, int dir, float roomSize) {
+    return (float)((column * 7 + row * 3 + dir * 5) % 3 - 1) * roomSize * 0.25f;
+}
+
+void buildMuseum(const MuseumLayout& layout, const MuseumMaterials& materials, const std::vector<Artwork>& artworks,
+                 const glm::vec3& origin, StaticMeshBuilder& builder, CellGraph& cells, std::vector<Painting>& paintings) {
+    const float half = layout.roomSize * 0.5f;
+    const float inset = layout.wallThickness * 0.5f;
+    const float height = layout.roomHeight;
+
+    // Cells first so portals can refer to neighbours by index
+    int firstCell = (int)cells.size();
+    for (int row = 0; row < layout.rows; ++row) {
+        for (int column = 0; column < layout.columns; ++column) {
+            glm::vec3 center(column * layout.roomSize, 0.0f, -row * layout.roomSize);
+            cells.addCell(origin + center + glm::vec3(-half + inset, 0.0f, -half + inset),
+                          origin + center + glm::vec3(half - inset, height, half - inset));
+        }
+    }
+
+    for (int row = 0; row < layout.rows; ++row) {
+        for (int column = 0; column < layout.columns; ++column) {
+            int cell = firstCell + row * layout.columns + column;
+            glm::vec3 center(column * layout.roomSize, 0.0f, -row * layout.roomSize);
+            float x0 = center.x - half + inset, x1 = center.x + half - inset;
+            float z0 = center.z - half + inset, z1 = center.z + half - inset;
+
+            cells.addSurface(cell, builder.beginSubMesh(materials.floor));
+            addFace(builder, glm::vec3(x0, 0.0f, z0), glm::vec3(x1, 0.0f, z0), glm::vec3(x1, 0.0f, z1),
+                    glm::vec3(x0, 0.0f, z1), glm::vec3(0.0f, 1.0f, 0.0f));
+            cells.addSurface(cell, builder.beginSubMesh(materials.ceiling));
+            addFace(builder, glm::vec3(x0, height, z0), glm::vec3(x1, height, z0), glm::vec3(x1, height, z1),
+                    glm::vec3(x0, height, z1), glm::vec3(0.0f, -1.0f, 0.0f));
+
+            for (int s = 0; s < 4; ++s) {
+                WallSide side = (WallSide)s;
+                bool alongX = (side == SIDE_NORTH || side == SIDE_SOUTH);
+                float line = side == SIDE_NORTH ? z0 : side == SIDE_SOUTH ? z1 : side == SIDE_WEST ? x0 : x1;
+                float a0 = alongX ? x0 : z0, a1 = alongX ? x1 : z1;
+                float mid = alongX ? center.x : center.z;
+
+                // Doorways are owned by the room to the south or west of them
+                bool door = false;
+                float offset = 0.0f;
+                if (side == SIDE_NORTH && row + 1 < layout.rows) { door = true; offset = doorOffset(column, row, 1, layout.roomSize); }
+                if (side == SIDE_SOUTH && row > 0) { door = true; offset = doorOffset(column, row - 1, 1, layout.roomSize); }
+                if (side == SIDE_EAST && column + 1 < layout.columns) { door = true; offset = doorOffset(column, row, 0, layout.roomSize); }
+                if (side == SIDE_WEST && column > 0) { door = true; offset = doorOffset(column - 1, row, 0, layout.roomSize); }
+                float d0 = mid + offset - layout.doorWidth * 0.5f, d1 = mid + offset + layout.doorWidth * 0.5f;
+
+                cells.addSurface(cell, builder.beginSubMesh(materials.wall));
+                if (!door) {
+                    addWallSegment(builder, side, line, a0, a1, 0.0f, height);
+                } else {
+                    addWallSegment(builder, side, line, a0, d0, 0.0f, height);
+                    addWallSegment(builder, side, line, d1, a1, 0.0f, height);
+                    addWallSegment(builder, side, line, d0, d1, layout.doorHeight, height);
+                }
+
+                bool owner = door && (side == SIDE_NORTH || side == SIDE_EAST);
+                if (owner) {
+                    // Jambs and head spanning the wall thickness
+                    float wall = side == SIDE_NORTH ? center.z - half : center.x + half;
+                    float in = wall + (side == SIDE_NORTH ? inset : -inset);
+                    float out = wall - (side == SIDE_NORTH ? inset : -inset);
+                    glm::vec3 alongAxis = alongX ? glm::vec3(1.0f, 0.0f, 0.0f) : glm::vec3(0.0f, 0.0f, 1.0f);
+                    addFace(builder, wallPoint(side, d0, in, 0.0f), wallPoint(side, d0, out, 0.0f),
+                            wallPoint(side, d0, out, layout.doorHeight), wallPoint(side, d0, in, layout.doorHeight), alongAxis);
+                    addFace(builder, wallPoint(side, d1, in, 0.0f), wallPoint(side, d1, out, 0.0f),
+                            wallPoint(side, d1, out, layout.doorHeight), wallPoint(side, d1, in, layout.doorHeight), -alongAxis);
+                    addFace(builder, wallPoint(side, d0, in, layout.doorHeight), wallPoint(side, d1, in, layout.doorHeight),
+                            wallPoint(side, d1, out, layout.doorHeight), wallPoint(side, d0, out, layout.doorHeight),
+                            glm::vec3(0.0f, -1.0f, 0.0f));
+
+                    glm::vec3 corners[4] = {
+                        origin + wallPoint(side, d0, wall, 0.0f), origin + wallPoint(side, d1, wall, 0.0f),
+                        origin + wallPoint(side, d1, wall, layout.doorHeight), origin + wallPoint(side, d0, wall, layout.doorHeight)
+                    };
+                    int neighbour = side == SIDE_NORTH ? cell + layout.columns : cell + 1;
+                    cells.addPortal(cell, neighbour, corners, layout.wallThickness);
+                }
+
+                // One painting per wall, on the longer stretch beside any doorway
+                if (artworks.empty()) continue;
+                float h0 = a0, h1 = a1;
+                if (door) {
+                    if (d0 - a0 >= a1 - d1) h1 = d0; else h0 = d1;
+                }
+                float space = h1 - h0 - 2.0f;
+                if (space < 3.0f) continue;
+
+                const Artwork& art = artworks[(cell * 4 + s) % artworks.size()];
+                float scale = std::min(std::min(space, 7.0f) / art.imageSize.x, 4.0f / art.imageSize.y);
+                glm::vec3 normal = sideNormal(side);
+                glm::vec3 position = origin + wallPoint(side, (h0 + h1) * 0.5f, line, 3.5f) + normal * 0.1f;
+                float yaw = side == SIDE_NORTH ? 0.0f : side == SIDE_SOUTH ? 180.0f : side == SIDE_WEST ? 90.0f : -90.0f;
+
+                cells.addPainting(cell, (uint32_t)paintings.size());
+                paintings.push_back(Painting(art.path.c_str(), position, art.imageSize * scale, yaw));
+            }
+        }
+    }
+}
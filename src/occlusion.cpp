@@ -0,0 +1,217 @@
+#include "occlusion.h"
+#include "gl_state.h"
+#include "render_stats.h"
+
+// Query boxes are grown slightly so coplanar geometry (a painting on a
+// wall) is not hidden by the surface it sits on
+static const float BOX_MARGIN = 0.05f;
+// Distance within which the camera counts as inside a box; covers the near plane
+static const float EYE_MARGIN = 0.5f;
+
+OcclusionCuller::OcclusionCuller()
+    : target(GL_ANY_SAMPLES_PASSED), boxVAO(0), boxVBO(0), boxEBO(0), frame(0) {
+    stats.queriesIssued = stats.groupsHidden = stats.nodesHidden = 0;
+}
+
+OcclusionCuller::~OcclusionCuller() {
+    clear();
+    if (boxVAO) {
+        glState().forgetVertexArray(boxVAO);
+        glDeleteVertexArrays(1, &boxVAO);
+        glDeleteBuffers(1, &boxVBO);
+        glDeleteBuffers(1, &boxEBO);
+    }
+}
+
+GLenum OcclusionCuller::queryTarget() {
+    if (GLEW_VERSION_4_3 || GLEW_ARB_ES3_compatibility) return GL_ANY_SAMPLES_PASSED_CONSERVATIVE;
+    return GL_ANY_SAMPLES_PASSED;
+}
+
+void OcclusionCuller::init() {
+    target = queryTarget();
+    boxShader.reset(new Shader("shaders/simple_vs.glsl", "shaders/simple_fs.glsl"));
+
+    // Unit cube centered on the origin
+    float vertices[] = {
+        -0.5f, -0.5f, -0.5f,   0.5f, -0.5f, -0.5f,   0.5f,  0.5f, -0.5f,  -0.5f,  0.5f, -0.5f,
+        -0.5f, -0.5f,  0.5f,   0.5f, -0.5f,  0.5f,   0.5f,  0.5f,  0.5f,  -0.5f,  0.5f,  0.5f
+    };
+    unsigned short indices[] = {
+        0, 1, 2, 0, 2, 3,   4, 6, 5, 4, 7, 6,   0, 4, 5, 0, 5, 1,
+        3, 2, 6, 3, 6, 7,   0, 3, 7, 0, 7, 4,   1, 5, 6, 1, 6, 2
+    };
+    glGenVertexArrays(1, &boxVAO);
+    glGenBuffers(1, &boxVBO);
+    glGenBuffers(1, &boxEBO);
+    glState().bindVertexArray(boxVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, boxVBO);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+    renderStats().countBufferUpload(sizeof(vertices));
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, boxEBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
+    renderStats().countBufferUpload(sizeof(indices));
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+}
+
+int OcclusionCuller::addEntry(int group, const glm::vec3& minCorner, const glm::vec3& maxCorner) {
+    Entry entry;
+    entry.minCorner = minCorner - glm::vec3(BOX_MARGIN);
+    entry.maxCorner = maxCorner + glm::vec3(BOX_MARGIN);
+    entry.query = 0;
+    entry.pending = false;
+    entry.visible = true;
+    // Stagger re-queries of visible objects across frames
+    entry.lastQueried = frame - (unsigned int)(entries.size() % REQUERY_INTERVAL);
+    entry.group = group;
+    glGenQueries(1, &entry.query);
+    entries.push_back(entry);
+    return (int)entries.size() - 1;
+}
+
+int OcclusionCuller::addGroup(const glm::vec3& minCorner, const glm::vec3& maxCorner) {
+    groups.push_back(addEntry(-1, minCorner, maxCorner));
+    return (int)groups.size() - 1;
+}
+
+int OcclusionCuller::addNode(int group, const glm::vec3& minCorner, const glm::vec3& maxCorner) {
+    int index = addEntry(groups[group], minCorner, maxCorner);
+    entries[groups[group]].children.push_back(index);
+    nodes.push_back(index);
+    return (int)nodes.size() - 1;
+}
+
+void OcclusionCuller::clear() {
+    for (size_t i = 0; i < entries.size(); ++i) {
+        glDeleteQueries(1, &entries[i].query);
+    }
+    entries.clear();
+    groups.clear();
+    nodes.clear();
+}
+
+bool OcclusionCuller::isNodeVisible(int node) const {
+    const Entry& entry = entries[nodes[node]];
+    return entry.visible && entries[entry.group].visible;
+}
+
+GLuint OcclusionCuller::conditionFor(int group) const {
+    const Entry& entry = entries[groups[group]];
+    return (!entry.visible && entry.pending) ? entry.query : 0;
+}
+
+void OcclusionCuller::setSubtreeVisible(Entry& entry) {
+    entry.visible = true;
+    for (size_t i = 0; i < entry.children.size(); ++i) {
+        entries[entry.children[i]].visible = true;
+    }
+}
+
+void OcclusionCuller::collectResults(const glm::vec3& eye) {
+    for (size_t i = 0; i < entries.size(); ++i) {
+        Entry& entry = entries[i];
+        if (!entry.pending) continue;
+
+        GLuint available = 0;
+        glGetQueryObjectuiv(entry.query, GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) continue;
+
+        GLuint passed = 0;
+        glGetQueryObjectuiv(entry.query, GL_QUERY_RESULT, &passed);
+        entry.pending = false;
+        if (entry.group < 0 && passed && !entry.visible) {
+            // Group came back into view: give its nodes a chance before they are tested
+            setSubtreeVisible(entry);
+        } else {
+            entry.visible = passed != 0;
+        }
+    }
+
+    stats.groupsHidden = stats.nodesHidden = 0;
+    for (size_t g = 0; g < groups.size(); ++g) {
+        Entry& group = entries[groups[g]];
+        // A result from before the camera walked in is already out of date
+        if (contains(group, eye)) group.visible = true;
+        if (!group.visible) stats.groupsHidden++;
+    }
+    for (size_t n = 0; n < nodes.size(); ++n) {
+        if (!isNodeVisible((int)n)) stats.nodesHidden++;
+    }
+}
+
+bool OcclusionCuller::contains(const Entry& entry, const glm::vec3& point) const {
+    glm::vec3 lo = entry.minCorner - glm::vec3(EYE_MARGIN);
+    glm::vec3 hi = entry.maxCorner + glm::vec3(EYE_MARGIN);
+    return point.x >= lo.x && point.y >= lo.y && point.z >= lo.z &&
+           point.x <= hi.x && point.y <= hi.y && point.z <= hi.z;
+}
+
+void OcclusionCuller::issue(Entry& entry) {
+    glm::vec3 size = entry.maxCorner - entry.minCorner;
+    glm::mat4 model(1.0f);
+    model[0][0] = size.x;
+    model[1][1] = size.y;
+    model[2][2] = size.z;
+    model[3] = glm::vec4((entry.minCorner + entry.maxCorner) * 0.5f, 1.0f);
+    boxShader->setMat4("model", model);
+
+    glBeginQuery(target, entry.query);
+    glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_SHORT, 0);
+    renderStats().countDraw(GL_TRIANGLES, 36);
+    glEndQuery(target);
+
+    entry.pending = true;
+    entry.lastQueried = frame;
+    stats.queriesIssued++;
+}
+
+void OcclusionCuller::issueQueries(const Frustum& frustum, const glm::vec3& eye, const glm::mat4& view, const glm::mat4& projection,
+                                   const std::vector<int>* groupsInView) {
+    frame++;
+    stats.queriesIssued = 0;
+    if (entries.empty() || !boxShader) return;
+
+    inView.assign(groups.size(), groupsInView ? 0 : 1);
+    if (groupsInView) {
+        for (size_t i = 0; i < groupsInView->size(); ++i) inView[(*groupsInView)[i]] = 1;
+    }
+
+    boxShader->use();
+    boxShader->setMat4("view", view);
+    boxShader->setMat4("projection", projection);
+    glState().bindVertexArray(boxVAO);
+    glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+    glDepthMask(GL_FALSE);
+
+    for (size_t g = 0; g < groups.size(); ++g) {
+        Entry& group = entries[groups[g]];
+        if (!inView[g] || !frustum.intersectsBox(group.minCorner, group.maxCorner)) {
+            // Results go stale off screen; assume visible on the way back in
+            setSubtreeVisible(group);
+            continue;
+        }
+        if (contains(group, eye)) {
+            group.visible = true;
+        } else if (!group.visible) {
+            // One query stands in for every node in the group
+            if (!group.pending) issue(group);
+            continue;
+        } else if (!group.pending && frame - group.lastQueried >= REQUERY_INTERVAL) {
+            issue(group);
+        }
+
+        for (size_t i = 0; i < group.children.size(); ++i) {
+            Entry& node = entries[group.children[i]];
+            if (node.pending) continue;
+            if (!frustum.intersectsBox(node.minCorner, node.maxCorner) || contains(node, eye)) {
+                node.visible = true;
+                continue;
+            }
+            if (!node.visible || frame - node.lastQueried >= REQUERY_INTERVAL) issue(node);
+        }
+    }
+
+    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+    glDepthMask(GL_TRUE);
+}
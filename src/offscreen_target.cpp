@@ -0,0 +1,72 @@
+#include "offscreen_target.h"
+#include "gl_state.h"
+#include <cstdio>
+#include <iostream>
+#include <vector>
+
+OffscreenTarget::OffscreenTarget() : fbo(0), colorBuffer(0), depthBuffer(0), targetWidth(0), targetHeight(0) {}
+
+OffscreenTarget::~OffscreenTarget() {
+    if (fbo) {
+        glDeleteFramebuffers(1, &fbo);
+        glDeleteRenderbuffers(1, &colorBuffer);
+        glDeleteRenderbuffers(1, &depthBuffer);
+    }
+}
+
+bool OffscreenTarget::init(int width, int height) {
+    targetWidth = width;
+    targetHeight = height;
+
+    glGenFramebuffers(1, &fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    // Same formats a window would get: 8-bit linear colour, 24-bit depth
+    glGenRenderbuffers(1, &colorBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, colorBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorBuffer);
+    glGenRenderbuffers(1, &depthBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthBuffer);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        std::cerr << "Offscreen framebuffer is incomplete" << std::endl;
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        return false;
+    }
+
+    // Left bound: it is the window from here on
+    glState().setDefaultFramebuffer(fbo);
+    glViewport(0, 0, width, height);
+    std::cout << "Offscreen target: " << width << "x" << height << std::endl;
+    return true;
+}
+
+bool OffscreenTarget::writePPM(const char* path) const {
+    std::vector<unsigned char> pixels((size_t)targetWidth * targetHeight * 3);
+    // Framebuffers are not in the state cache; put back whatever was bound
+    GLint savedReadFramebuffer = 0, savedPackAlignment = 4;
+    glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &savedReadFramebuffer);
+    glGetIntegerv(GL_PACK_ALIGNMENT, &savedPackAlignment);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, fbo);
+    glReadBuffer(GL_COLOR_ATTACHMENT0);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, targetWidth, targetHeight, GL_RGB, GL_UNSIGNED_BYTE, &pixels[0]);
+    glPixelStorei(GL_PACK_ALIGNMENT, savedPackAlignment);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, (GLuint)savedReadFramebuffer);
+
+    FILE* file = std::fopen(path, "wb");
+    if (!file) {
+        std::cerr << "Cannot write " << path << std::endl;
+        return false;
+    }
+    std::fprintf(file, "P6\n%d %d\n255\n", targetWidth, targetHeight);
+    // GL rows run bottom to top
+    for (int y = targetHeight - 1; y >= 0; --y) {
+        std::fwrite(&pixels[(size_t)y * targetWidth * 3], 1, (size_t)targetWidth * 3, file);
+    }
+    bool ok = std::ferror(file) == 0;
+    ok = std::fclose(file) == 0 && ok;
+    if (!ok) std::cerr << "Cannot write " << path << std::endl;
+    return ok;
+}
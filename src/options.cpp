@@ -0,0 +1,152 @@
+#include "options.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+static void printUsage(const char* program) {
+    std::cout << "Usage: " << program << " [options]\n"
+              << "  --gl33         Request a GL 3.3 context even if 4.3 is available\n"
+              << "  --no-indirect  Disable the multi-draw indirect backend\n"
+              << "  --museum       Load the 40-room museum instead of a single room\n"
+              << "  --no-culling   Disable frustum culling\n"
+              << "  --no-occlusion Disable occlusion queries\n"
+              << "  --lod N        Draw every painting at level of detail N (0 = full)\n"
+              << "  --deferred     Start with deferred shading (G switches at runtime)\n"
+              << "  --no-shadows   Disable directional light shadows\n"
+              << "  --bake-lightmap Bake the static lighting before starting (L toggles it)\n"
+              << "  --no-baked-lighting Ignore baked lightmaps and probes; light everything dynamically\n"
+              << "  --depth-prepass Draw depth first and light each pixel once (Z toggles)\n"
+              << "  --dynamic-resolution [MS] Scale the render resolution to hold a GPU frame budget\n"
+              << "                 (default 16.6 ms)\n"
+              << "  --swap MODE    Swap interval: vsync (default), adaptive or uncapped\n"
+              << "  --fps-limit N  Hold the frame rate to N frames a second\n"
+              << "  --size WxH     Window size, or the offscreen size when headless (default 1280x720)\n"
+              << "  --headless [N] Render N frames (default 600) offscreen with no window and report\n"
+              << "                 frame times, render work and startup phases as JSON\n"
+              << "  --report FILE  Write the --headless report to FILE instead of stdout\n"
+              << "  --capture FILE Save the last --headless frame to FILE (PPM)\n"
+              << "  --record FILE  Record keyboard and mouse input to FILE\n"
+              << "  --replay FILE  Replay recorded input from FILE, then exit\n"
+              << "  --timestep MS  Advance MS per frame instead of following the clock\n"
+              << "                 (replays default to the log's step, or 16.67)\n"
+              << "  --stats        Print frame statistics once a second\n"
+              << "  --stats-csv FILE Write per-frame draw, bind, upload counters to FILE\n"
+              << "  --trace FILE   Record CPU scopes and write a Chrome/Perfetto trace on exit\n"
+              << "  --help         Show this message" << std::endl;
+}
+
+bool parseOptions(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+        if (std::strcmp(arg, "--gl33") == 0) {
+            options.forceGL33 = true;
+        } else if (std::strcmp(arg, "--no-indirect") == 0) {
+            options.useIndirect = false;
+        } else if (std::strcmp(arg, "--museum") == 0) {
+            options.museum = true;
+        } else if (std::strcmp(arg, "--no-culling") == 0) {
+            options.useCulling = false;
+        } else if (std::strcmp(arg, "--no-occlusion") == 0) {
+            options.useOcclusion = false;
+        } else if (std::strcmp(arg, "--lod") == 0 && i + 1 < argc
+                   && argv[i + 1][0] >= '0' && argv[i + 1][0] <= '2' && argv[i + 1][1] == '\0') {
+            options.forceLOD = argv[++i][0] - '0';
+        } else if (std::strcmp(arg, "--deferred") == 0) {
+            options.deferred = true;
+        } else if (std::strcmp(arg, "--no-shadows") == 0) {
+            options.useShadows = false;
+        } else if (std::strcmp(arg, "--bake-lightmap") == 0) {
+            options.bakeLightmap = true;
+        } else if (std::strcmp(arg, "--no-baked-lighting") == 0) {
+            options.useBakedLighting = false;
+        } else if (std::strcmp(arg, "--depth-prepass") == 0) {
+            options.depthPrepass = true;
+        } else if (std::strcmp(arg, "--dynamic-resolution") == 0) {
+            options.frameBudgetMs = 16.6f;
+            char* end = NULL;
+            float budget = i + 1 < argc ? std::strtof(argv[i + 1], &end) : 0.0f;
+            if (end && *end == '\0' && budget > 0.0f) {
+                options.frameBudgetMs = budget;
+                ++i;
+            }
+        } else if (std::strcmp(arg, "--swap") == 0 && i + 1 < argc
+                   && (std::strcmp(argv[i + 1], "vsync") == 0 || std::strcmp(argv[i + 1], "adaptive") == 0
+                       || std::strcmp(argv[i + 1], "uncapped") == 0)) {
+            const char* mode = argv[++i];
+            options.swapInterval = mode[0] == 'v' ? 1 : mode[0] == 'a' ? -1 : 0;
+        } else if (std::strcmp(arg, "--fps-limit") == 0 && i + 1 < argc) {
+            char* end = NULL;
+            float limit = std::strtof(argv[i + 1], &end);
+            if (*end != '\0' || limit <= 0.0f) {
+                std::cerr << "--fps-limit needs a positive rate" << std::endl;
+                printUsage(argv[0]);
+                return false;
+            }
+            options.fpsLimit = limit;
+            ++i;
+        } else if (std::strcmp(arg, "--size") == 0 && i + 1 < argc) {
+            int width = 0, height = 0;
+            char extra = 0;
+            if (std::sscanf(argv[i + 1], "%dx%d%c", &width, &height, &extra) != 2 || width <= 0 || height <= 0) {
+                std::cerr << "--size needs WIDTHxHEIGHT" << std::endl;
+                printUsage(argv[0]);
+                return false;
+            }
+            options.width = width;
+            options.height = height;
+            ++i;
+        } else if (std::strcmp(arg, "--headless") == 0) {
+            options.headlessFrames = 600;
+            char* end = NULL;
+            long frames = i + 1 < argc ? std::strtol(argv[i + 1], &end, 10) : 0;
+            if (end && *end == '\0' && frames > 0) {
+                options.headlessFrames = (int)frames;
+                ++i;
+            }
+        } else if (std::strcmp(arg, "--report") == 0 && i + 1 < argc) {
+            options.reportFile = argv[++i];
+        } else if (std::strcmp(arg, "--capture") == 0 && i + 1 < argc) {
+            options.captureFile = argv[++i];
+        } else if (std::strcmp(arg, "--record") == 0 && i + 1 < argc) {
+            options.recordFile = argv[++i];
+        } else if (std::strcmp(arg, "--replay") == 0 && i + 1 < argc) {
+            options.replayFile = argv[++i];
+        } else if (std::strcmp(arg, "--timestep") == 0 && i + 1 < argc) {
+            char* end = NULL;
+            float step = std::strtof(argv[i + 1], &end);
+            if (*end != '\0' || step <= 0.0f) {
+                std::cerr << "--timestep needs a positive number of milliseconds" << std::endl;
+                printUsage(argv[0]);
+                return false;
+            }
+            options.timestepMs = step;
+            ++i;
+        } else if (std::strcmp(arg, "--stats") == 0) {
+            options.printStats = true;
+        } else if (std::strcmp(arg, "--stats-csv") == 0 && i + 1 < argc) {
+            options.statsCsv = argv[++i];
+        } else if (std::strcmp(arg, "--trace") == 0 && i + 1 < argc) {
+            options.traceFile = argv[++i];
+        } else {
+            if (std::strcmp(arg, "--help") != 0) {
+                std::cerr << "Unknown option: " << arg << std::endl;
+            }
+            printUsage(argv[0]);
+            return false;
+        }
+    }
+    if (options.captureFile && options.headlessFrames == 0) {
+        std::cerr << "--capture needs --headless" << std::endl;
+        return false;
+    }
+    if (options.recordFile && options.replayFile) {
+        std::cerr << "--record and --replay cannot be combined" << std::endl;
+        return false;
+    }
+    if (options.bakeLightmap && !options.useBakedLighting) {
+        std::cerr << "--bake-lightmap and --no-baked-lighting cannot be combined" << std::endl;
+        return false;
+    }
+    return true;
+}
@@ -1,61 +1,13 @@
-#include <GL/glew.h>
 #include "painting.h"
-#include "texture.h" 
 
-Painting::Painting(const char* texturePath, const glm::vec3& pos, const glm::vec2& dimensions) 
-    : position(pos), size(dimensions) {
-    setupGeometry();
-    texture = loadTexture(texturePath);
-}
+const float Painting::FRAME_WIDTH = 0.15f;
+const float Painting::FRAME_DEPTH = 0.08f;
 
-void Painting::setupGeometry() {
-    float vertices[] = {
-        -0.5f,  0.5f, 0.0f, 0.0f, 0.0f, 1.0f,   0.0f, 0.0f,  // Bottom-left UV changed
-        0.5f,  0.5f, 0.0f, 0.0f, 0.0f, 1.0f,   1.0f, 0.0f,  // Bottom-right UV changed
-        0.5f, -0.5f, 0.0f, 0.0f, 0.0f, 1.0f,   1.0f, 1.0f,  // Top-right UV changed
-        -0.5f, -0.5f, 0.0f, 0.0f, 0.0f, 1.0f,   0.0f, 1.0f   // Top-left UV changed
-    };
-    unsigned int indices[] = {
-        0, 1, 2,
-        0, 2, 3
-    };
-    glGenVertexArrays(1, &VAO);
-    glGenBuffers(1, &VBO);
-    glGenBuffers(1, &EBO);
-    
-    glBindVertexArray(VAO);
-    
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
-    
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
-    
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
-    glEnableVertexAttribArray(2);
+Painting::Painting(const char* path, const glm::vec3& pos, const glm::vec2& dimensions, float yawDegrees)
+    : texturePath(path), position(pos), size(dimensions), transform(pos) {
+    transform.setRotation(glm::vec3(0.0f, yawDegrees, 0.0f));
 }
 
-void Painting::draw(Shader& shader) {
-    glm::mat4 model = glm::translate(glm::mat4(1.0f), position);
-    model = glm::scale(model, glm::vec3(size.x, size.y, 1.0f));
-    
-    shader.setMat4("model", model);
-    
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, texture);
-    shader.setInt("material.diffuse", 0);
-    
-    glBindVertexArray(VAO);
-    glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+float Painting::getBoundingRadius() const {
+    return 0.5f * glm::length(size + glm::vec2(2.0f * FRAME_WIDTH)) + FRAME_DEPTH;
 }
-
-Painting::~Painting() {
-    glDeleteVertexArrays(1, &VAO);
-    glDeleteBuffers(1, &VBO);
-    glDeleteBuffers(1, &EBO);
-    glDeleteTextures(1, &texture);
-}
\ No newline at end of file
@@ -0,0 +1,466 @@
+#include "painting_renderer.h"
+#include "texture.h"
+#include "gl_state.h"
+#include "render_stats.h"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+const float PaintingRenderer::LOD_THRESHOLDS[LOD_COUNT - 1] = { 160.0f, 48.0f };
+const float PaintingRenderer::LOD_HYSTERESIS = 0.2f;
+
+static const char* FRAME_TEXTURE_PATH = "assets/textures/wood_sl.jpeg";
+
+PaintingRenderer::PaintingRenderer(int textureSize, int proxyTextureSize)
+    : forcedLOD(-1), layerSize(textureSize), proxySize(proxyTextureSize), texturesDirty(false),
+      instancesDirty(false), visibleDirty(false), quadVBO(0), quadEBO(0), instanceVBO(0), shadowVBO(0),
+      shadowQuadVAO(0), shadowFrameVAO(0), frameTexture(0) {
+    GLint limit = 256;
+    glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &limit);
+    maxLayers = std::min(limit, 256);
+    for (int level = 0; level < LOD_COUNT; ++level) lodCounts[level] = 0;
+    for (int mesh = 0; mesh < FRAME_MESH_COUNT; ++mesh) {
+        frameMeshes[mesh].vbo = 0;
+        frameMeshes[mesh].vertexCount = 0;
+    }
+}
+
+PaintingRenderer::~PaintingRenderer() {
+    releaseBatches();
+    glDeleteBuffers(1, &quadVBO);
+    glDeleteBuffers(1, &quadEBO);
+    glDeleteBuffers(1, &instanceVBO);
+    glState().forgetVertexArray(shadowQuadVAO);
+    glState().forgetVertexArray(shadowFrameVAO);
+    glDeleteVertexArrays(1, &shadowQuadVAO);
+    glDeleteVertexArrays(1, &shadowFrameVAO);
+    glDeleteBuffers(1, &shadowVBO);
+    for (int mesh = 0; mesh < FRAME_MESH_COUNT; ++mesh) glDeleteBuffers(1, &frameMeshes[mesh].vbo);
+    glState().forgetTexture(frameTexture);
+    glDeleteTextures(1, &frameTexture);
+}
+
+void PaintingRenderer::add(const Painting& painting) {
+    const std::string& path = painting.getTexturePath();
+    if (imageSlots.find(path) == imageSlots.end()) {
+        if (batches.empty() || (int)batches.back().layers.size() >= maxLayers) {
+            Batch batch;
+            for (int level = 0; level < LOD_COUNT; ++level) {
+                batch.quadVAOs[level] = 0;
+                batch.visibleCounts[level] = 0;
+            }
+            for (int mesh = 0; mesh < FRAME_MESH_COUNT; ++mesh) batch.frameVAOs[mesh] = 0;
+            batch.textureArray = 0;
+            batch.proxyArray = 0;
+            batch.firstInstance = 0;
+            batch.instanceCount = 0;
+            batch.center = glm::vec3(0.0f);
+            batches.push_back(batch);
+        }
+        Batch& batch = batches.back();
+        imageSlots[path] = std::make_pair((int)batches.size() - 1, (int)batch.layers.size());
+        batch.layers.push_back(path);
+        texturesDirty = true;
+    }
+    paintings.push_back(painting);
+    lods.push_back(0);
+    instancesDirty = true;
+}
+
+void PaintingRenderer::build() {
+    if (quadVBO == 0) {
+        createQuad();
+        createFrames();
+    }
+    if (texturesDirty) buildTextures();
+    if (instancesDirty) uploadInstances();
+}
+
+void PaintingRenderer::createQuad() {
+    float vertices[] = {
+        -0.5f,  0.5f, 0.0f, 0.0f, 0.0f, 1.0f,   0.0f, 0.0f,  // Bottom-left UV changed
+        0.5f,  0.5f, 0.0f, 0.0f, 0.0f, 1.0f,   1.0f, 0.0f,  // Bottom-right UV changed
+        0.5f, -0.5f, 0.0f, 0.0f, 0.0f, 1.0f,   1.0f, 1.0f,  // Top-right UV changed
+        -0.5f, -0.5f, 0.0f, 0.0f, 0.0f, 1.0f,   0.0f, 1.0f   // Top-left UV changed
+    };
+    unsigned int indices[] = {
+        0, 1, 2,
+        0, 2, 3
+    };
+    glGenBuffers(1, &quadVBO);
+    glGenBuffers(1, &quadEBO);
+    glGenBuffers(1, &instanceVBO);
+
+    glBindBuffer(GL_ARRAY_BUFFER, quadVBO);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+    renderStats().countBufferUpload(sizeof(vertices));
+    // Element data is uploaded through the array target; it is attached to each batch VAO later
+    glBindBuffer(GL_ARRAY_BUFFER, quadEBO);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
+    renderStats().countBufferUpload(sizeof(indices));
+}
+
+// Cross-section of one side of a frame: distance out from the image edge
+// and height in front of the image plane, in world units
+struct ProfilePoint {
+    float out;
+    float z;
+};
+
+// Sweeps a profile around the four image edges. Vertices are a corner of
+// the unit image quad (scaled by the painting size in the shader) plus an
+// offset that does not scale, so the moulding keeps its width on any size;
+// corner offsets run along both sides' outward directions to form mitres.
+static std::vector<float> sweepFrameProfile(const ProfilePoint* profile, int count) {
+    static const float OUTWARD[4][2] = { { 0.0f, 1.0f }, { -1.0f, 0.0f }, { 0.0f, -1.0f }, { 1.0f, 0.0f } };
+
+    float length = 0.0f;
+    for (int i = 0; i + 1 < count; ++i) {
+        length += glm::length(glm::vec2(profile[i + 1].out - profile[i].out, profile[i + 1].z - profile[i].z));
+    }
+
+    std::vector<float> vertices;
+    for (int side = 0; side < 4; ++side) {
+        glm::vec2 outward(OUTWARD[side][0], OUTWARD[side][1]);
+        glm::vec2 along(-outward.y, outward.x);
+        glm::vec2 anchors[2] = { 0.5f * (outward - along), 0.5f * (outward + along) };
+        glm::vec2 mitres[2] = { outward - along, outward + along };
+
+        float v = 0.0f;
+        for (int i = 0; i + 1 < count; ++i) {
+            const ProfilePoint& p = profile[i];
+            const ProfilePoint& q = profile[i + 1];
+            float step = glm::length(glm::vec2(q.out - p.out, q.z - p.z));
+            // Perpendicular to the profile segment, facing away from the moulding
+            glm::vec3 normal = glm::normalize(glm::vec3(outward * -(q.z - p.z), q.out - p.out));
+
+            // Quad corners as (end of the edge, profile point)
+            const int corners[4][2] = { { 0, 0 }, { 1, 0 }, { 1, 1 }, { 0, 1 } };
+            glm::vec3 positions[4];
+            for (int c = 0; c < 4; ++c) {
+                const ProfilePoint& point = corners[c][1] ? q : p;
+                positions[c] = glm::vec3(anchors[corners[c][0]] + mitres[corners[c][0]] * point.out, point.z);
+            }
+            // Wind counter-clockwise as seen from the normal side (the unit quad is enough for the sign)
+            bool flip = glm::dot(glm::cross(positions[1] - positions[0], positions[2] - positions[0]), normal) < 0.0f;
+            const int order[6] = { 0, 1, 2, 0, 2, 3 };
+            for (int k = 0; k < 6; ++k) {
+                int c = order[flip ? 5 - k : k];
+                const ProfilePoint& point = corners[c][1] ? q : p;
+                glm::vec2 anchor = anchors[corners[c][0]];
+                glm::vec2 offset = mitres[corners[c][0]] * point.out;
+                float uv[2] = { (float)corners[c][0], 0.25f * (v + (corners[c][1] ? step : 0.0f)) / length };
+                float vertex[11] = { anchor.x, anchor.y, 0.0f, normal.x, normal.y, normal.z,
+                                     uv[0], uv[1], offset.x, offset.y, point.z };
+                vertices.insert(vertices.end(), vertex, vertex + 11);
+            }
+            v += step;
+        }
+    }
+    return vertices;
+}
+
+void PaintingRenderer::createFrames() {
+    const float W = Painting::FRAME_WIDTH;
+    const float D = Painting::FRAME_DEPTH;
+    // Level 0: bevelled lip into the image, rounded-off top and an outer side
+    const ProfilePoint detailed[] = {
+        { 0.0f, 0.0f }, { 0.2f * W, 0.75f * D }, { 0.35f * W, D },
+        { 0.85f * W, D }, { W, 0.75f * D }, { W, 0.0f }
+    };
+    // Level 1: just the front face, one quad per side
+    const ProfilePoint flat[] = { { 0.0f, D }, { W, D } };
+
+    const ProfilePoint* profiles[FRAME_MESH_COUNT] = { detailed, flat };
+    const int counts[FRAME_MESH_COUNT] = { (int)(sizeof(detailed) / sizeof(detailed[0])),
+                                           (int)(sizeof(flat) / sizeof(flat[0])) };
+    for (int mesh = 0; mesh < FRAME_MESH_COUNT; ++mesh) {
+        std::vector<float> vertices = sweepFrameProfile(profiles[mesh], counts[mesh]);
+        glGenBuffers(1, &frameMeshes[mesh].vbo);
+        glBindBuffer(GL_ARRAY_BUFFER, frameMeshes[mesh].vbo);
+        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), &vertices[0], GL_STATIC_DRAW);
+        renderStats().countBufferUpload(vertices.size() * sizeof(float));
+        frameMeshes[mesh].vertexCount = (GLsizei)(vertices.size() / 11);
+    }
+
+    frameTexture = loadTexture(FRAME_TEXTURE_PATH);
+}
+
+void PaintingRenderer::buildTextures() {
+    for (size_t b = 0; b < batches.size(); ++b) {
+        Batch& batch = batches[b];
+        if (batch.textureArray) {
+            glState().forgetTexture(batch.textureArray);
+            glDeleteTextures(1, &batch.textureArray);
+        }
+        if (batch.proxyArray) {
+            glState().forgetTexture(batch.proxyArray);
+            glDeleteTextures(1, &batch.proxyArray);
+        }
+        int layers = (int)batch.layers.size();
+        batch.textureArray = createTextureArray(layerSize, layerSize, layers);
+        for (int layer = 0; layer < layers; ++layer) {
+            loadTextureLayer(batch.textureArray, layer, batch.layers[layer], layerSize, layerSize);
+        }
+        glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+
+        // Proxies come from the mip level of the proxy size so images are decoded once
+        int level = 0;
+        while ((layerSize >> level) > proxySize) ++level;
+        if ((layerSize >> level) == proxySize) {
+            batch.proxyArray = createTextureArrayFromLevel(batch.textureArray, level, proxySize, proxySize, layers);
+        } else {
+            batch.proxyArray = createTextureArray(proxySize, proxySize, layers);
+            for (int layer = 0; layer < layers; ++layer) {
+                loadTextureLayer(batch.proxyArray, layer, batch.layers[layer], proxySize, proxySize);
+            }
+            glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+        }
+    }
+    std::cout << "Painting textures: " << imageSlots.size() << " images in " << batches.size()
+              << " texture array(s), " << proxySize << "px proxies" << std::endl;
+    texturesDirty = false;
+}
+
+void PaintingRenderer::uploadInstances() {
+    // Group instances by batch so each batch is one contiguous range
+    instances.clear();
+    instances.reserve(paintings.size());
+    instanceSlots.assign(paintings.size(), 0);
+    paintingBatches.assign(paintings.size(), 0);
+    for (size_t b = 0; b < batches.size(); ++b) {
+        Batch& batch = batches[b];
+        batch.firstInstance = (GLsizei)instances.size();
+        batch.center = glm::vec3(0.0f);
+
+        for (size_t i = 0; i < paintings.size(); ++i) {
+            const Painting& painting = paintings[i];
+            const std::pair<int, int>& slot = imageSlots[painting.getTexturePath()];
+            if (slot.first != (int)b) continue;
+
+            Instance instance;
+            std::memcpy(instance.model, &painting.getTransform().getModelMatrix()[0][0], sizeof(instance.model));
+            instance.params[0] = painting.getSize().x;
+            instance.params[1] = painting.getSize().y;
+            instance.params[2] = (float)slot.second;
+            instance.params[3] = 0.0f;
+            instanceSlots[i] = (uint32_t)instances.size();
+            paintingBatches[i] = (uint32_t)b;
+            instances.push_back(instance);
+            batch.center += painting.getPosition();
+        }
+        batch.instanceCount = (GLsizei)instances.size() - batch.firstInstance;
+        if (batch.instanceCount > 0) batch.center /= (float)batch.instanceCount;
+    }
+
+    // Room for every instance at every level; filled by uploadVisible()
+    glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+    glBufferData(GL_ARRAY_BUFFER, LOD_COUNT * instances.size() * sizeof(Instance), NULL, GL_DYNAMIC_DRAW);
+
+    // One VAO per batch, level and mesh with the instance attributes pointing at that level's range
+    for (size_t b = 0; b < batches.size(); ++b) {
+        Batch& batch = batches[b];
+        for (int level = 0; level < LOD_COUNT; ++level) {
+            if (batch.quadVAOs[level] == 0) glGenVertexArrays(1, &batch.quadVAOs[level]);
+            glState().bindVertexArray(batch.quadVAOs[level]);
+
+            glBindBuffer(GL_ARRAY_BUFFER, quadVBO);
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, quadEBO);
+            glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
+            glEnableVertexAttribArray(0);
+            glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
+            glEnableVertexAttribArray(1);
+            glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
+            glEnableVertexAttribArray(2);
+            setInstanceAttributes(instanceVBO, batch.rangeStart(level));
+
+            if (level >= FRAME_MESH_COUNT) continue;
+            if (batch.frameVAOs[level] == 0) glGenVertexArrays(1, &batch.frameVAOs[level]);
+            glState().bindVertexArray(batch.frameVAOs[level]);
+
+            glBindBuffer(GL_ARRAY_BUFFER, frameMeshes[level].vbo);
+            glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 11 * sizeof(float), (void*)0);
+            glEnableVertexAttribArray(0);
+            glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 11 * sizeof(float), (void*)(3 * sizeof(float)));
+            glEnableVertexAttribArray(1);
+            glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 11 * sizeof(float), (void*)(6 * sizeof(float)));
+            glEnableVertexAttribArray(2);
+            glVertexAttribPointer(11, 3, GL_FLOAT, GL_FALSE, 11 * sizeof(float), (void*)(8 * sizeof(float)));
+            glEnableVertexAttribArray(11);
+            setInstanceAttributes(instanceVBO, batch.rangeStart(level));
+        }
+    }
+
+    // Shadow casters never change with the view, so they get their own copy of every instance
+    if (shadowVBO == 0) {
+        glGenBuffers(1, &shadowVBO);
+        glGenVertexArrays(1, &shadowQuadVAO);
+        glGenVertexArrays(1, &shadowFrameVAO);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, shadowVBO);
+    glBufferData(GL_ARRAY_BUFFER, instances.size() * sizeof(Instance), instances.empty() ? NULL : &instances[0],
+                 GL_STATIC_DRAW);
+    renderStats().countBufferUpload(instances.size() * sizeof(Instance));
+    glState().bindVertexArray(shadowQuadVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, quadVBO);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, quadEBO);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+    setInstanceAttributes(shadowVBO, 0);
+    glState().bindVertexArray(shadowFrameVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, frameMeshes[FRAME_DETAILED].vbo);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 11 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(11, 3, GL_FLOAT, GL_FALSE, 11 * sizeof(float), (void*)(8 * sizeof(float)));
+    glEnableVertexAttribArray(11);
+    setInstanceAttributes(shadowVBO, 0);
+
+    // Everything is visible until the first setVisible()
+    visible.resize(paintings.size());
+    for (size_t i = 0; i < visible.size(); ++i) visible[i] = (uint32_t)i;
+    visibleDirty = true;
+    instancesDirty = false;
+}
+
+void PaintingRenderer::setInstanceAttributes(GLuint buffer, GLsizei firstInstance) {
+    glBindBuffer(GL_ARRAY_BUFFER, buffer);
+    size_t base = (size_t)firstInstance * sizeof(Instance);
+    for (int column = 0; column < 4; ++column) {
+        glVertexAttribPointer(3 + column, 4, GL_FLOAT, GL_FALSE, sizeof(Instance),
+                              (void*)(base + column * 4 * sizeof(float)));
+        glEnableVertexAttribArray(3 + column);
+        glVertexAttribDivisor(3 + column, 1);
+    }
+    glVertexAttribPointer(7, 4, GL_FLOAT, GL_FALSE, sizeof(Instance), (void*)(base + 16 * sizeof(float)));
+    glEnableVertexAttribArray(7);
+    glVertexAttribDivisor(7, 1);
+}
+
+void PaintingRenderer::setVisible(const std::vector<uint32_t>& indices) {
+    if (indices == visible) return;
+    visible = indices;
+    visibleDirty = true;
+}
+
+void PaintingRenderer::updateLODs(const glm::vec3& eye, float pixelScale) {
+    for (int level = 0; level < LOD_COUNT; ++level) lodCounts[level] = 0;
+    for (size_t i = 0; i < visible.size(); ++i) {
+        uint32_t index = visible[i];
+        const Painting& painting = paintings[index];
+        int level = lods[index];
+        if (forcedLOD >= 0) {
+            level = std::min(forcedLOD, LOD_COUNT - 1);
+        } else {
+            glm::vec2 size = painting.getSize();
+            float distance = std::max(glm::length(painting.getPosition() - eye), 0.1f);
+            float pixels = std::max(size.x, size.y) * pixelScale / distance;
+            // Drop a level below its threshold, but only come back well above it
+            while (level < LOD_COUNT - 1 && pixels < LOD_THRESHOLDS[level]) ++level;
+            while (level > 0 && pixels > LOD_THRESHOLDS[level - 1] * (1.0f + LOD_HYSTERESIS)) --level;
+        }
+        if (level != lods[index]) {
+            lods[index] = (unsigned char)level;
+            visibleDirty = true;
+        }
+        lodCounts[level]++;
+    }
+}
+
+void PaintingRenderer::uploadVisible() {
+    // Compact each batch's visible instances to the front of their level's range
+    visibleInstances.resize(LOD_COUNT * instances.size());
+    for (size_t b = 0; b < batches.size(); ++b) {
+        for (int level = 0; level < LOD_COUNT; ++level) batches[b].visibleCounts[level] = 0;
+    }
+    for (size_t i = 0; i < visible.size(); ++i) {
+        uint32_t index = visible[i];
+        Batch& batch = batches[paintingBatches[index]];
+        int level = lods[index];
+        visibleInstances[batch.rangeStart(level) + batch.visibleCounts[level]++] = instances[instanceSlots[index]];
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+    for (size_t b = 0; b < batches.size(); ++b) {
+        const Batch& batch = batches[b];
+        for (int level = 0; level < LOD_COUNT; ++level) {
+            if (batch.visibleCounts[level] == 0) continue;
+            GLsizei start = batch.rangeStart(level);
+            glBufferSubData(GL_ARRAY_BUFFER, start * sizeof(Instance),
+                            batch.visibleCounts[level] * sizeof(Instance), &visibleInstances[start]);
+            renderStats().countBufferUpload(batch.visibleCounts[level] * sizeof(Instance));
+        }
+    }
+    visibleDirty = false;
+}
+
+void PaintingRenderer::submit(RenderQueue& queue, Shader& shader, Shader& frameShader, const glm::mat4& view,
+                              Shader* depthShader, Shader* frameDepthShader) {
+    if (visibleDirty) uploadVisible();
+
+    shader.setInt("paintings", 0);
+    frameShader.setInt("frameTexture", 0);
+    for (size_t b = 0; b < batches.size(); ++b) {
+        const Batch& batch = batches[b];
+        float depth = -(view * glm::vec4(batch.center, 1.0f)).z;
+        for (int level = 0; level < LOD_COUNT; ++level) {
+            if (batch.visibleCounts[level] == 0) continue;
+
+            DrawCommand cmd;
+            cmd.shader = &shader;
+            cmd.vao = batch.quadVAOs[level];
+            cmd.textureTarget = GL_TEXTURE_2D_ARRAY;
+            cmd.texture = level == 0 ? batch.textureArray : batch.proxyArray;
+            cmd.transform = NULL;
+            cmd.mode = GL_TRIANGLES;
+            cmd.count = 6;
+            cmd.indexType = GL_UNSIGNED_INT;
+            cmd.first = 0;
+            cmd.instanceCount = batch.visibleCounts[level];
+            cmd.condition = 0;
+            cmd.depthShader = depthShader;
+            cmd.depthVao = 0;
+            queue.submit(PASS_OPAQUE, cmd, depth);
+
+            if (level >= FRAME_MESH_COUNT) continue;
+            cmd.shader = &frameShader;
+            cmd.vao = batch.frameVAOs[level];
+            cmd.textureTarget = GL_TEXTURE_2D;
+            cmd.texture = frameTexture;
+            cmd.count = frameMeshes[level].vertexCount;
+            cmd.indexType = 0;
+            cmd.depthShader = frameDepthShader;
+            queue.submit(PASS_OPAQUE, cmd, depth);
+        }
+    }
+}
+
+void PaintingRenderer::releaseBatches() {
+    for (size_t b = 0; b < batches.size(); ++b) {
+        Batch& batch = batches[b];
+        for (int level = 0; level < LOD_COUNT; ++level) {
+            glState().forgetVertexArray(batch.quadVAOs[level]);
+            glDeleteVertexArrays(1, &batch.quadVAOs[level]);
+        }
+        for (int mesh = 0; mesh < FRAME_MESH_COUNT; ++mesh) {
+            glState().forgetVertexArray(batch.frameVAOs[mesh]);
+            glDeleteVertexArrays(1, &batch.frameVAOs[mesh]);
+        }
+        glState().forgetTexture(batch.textureArray);
+        glState().forgetTexture(batch.proxyArray);
+        glDeleteTextures(1, &batch.textureArray);
+        glDeleteTextures(1, &batch.proxyArray);
+    }
+    batches.clear();
+}
+
+void PaintingRenderer::drawShadowCasters(Shader& depthShader) {
+    if (instances.empty()) return;
+    depthShader.use();
+    GLsizei count = (GLsizei)instances.size();
+    glState().bindVertexArray(shadowQuadVAO);
+    glDrawElementsInstanced(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0, count);
+    renderStats().countDraw(GL_TRIANGLES, 6, count);
+    glState().bindVertexArray(shadowFrameVAO);
+    glDrawArraysInstanced(GL_TRIANGLES, 0, frameMeshes[FRAME_DETAILED].vertexCount, count);
+    renderStats().countDraw(GL_TRIANGLES, frameMeshes[FRAME_DETAILED].vertexCount, count);
+}
@@ -0,0 +1,138 @@
+#include "probe_volume.h"
+#include "gl_state.h"
+#include "lightmap.h"
+#include "render_stats.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+namespace {
+
+const char PROBE_MAGIC[4] = { 'P', 'R', 'B', '1' };
+
+struct ProbeFileHeader {
+    char magic[4];
+    int32_t counts[3];
+    float boundsMin[3], boundsMax[3];
+};
+
+} // namespace
+
+glm::vec3 ProbeGrid::probePosition(int x, int y, int z) const {
+    return boundsMin + glm::vec3(x + 0.5f, y + 0.5f, z + 0.5f) * spacing;
+}
+
+ProbeGrid makeProbeGrid(const glm::vec3& boundsMin, const glm::vec3& boundsMax, float targetSpacing) {
+    ProbeGrid grid;
+    grid.boundsMin = boundsMin;
+    grid.boundsMax = boundsMax;
+    glm::vec3 extent = boundsMax - boundsMin;
+    grid.counts = glm::ivec3(std::max(1, (int)std::ceil(extent.x / targetSpacing - 0.01f)),
+                             std::max(1, (int)std::ceil(extent.y / targetSpacing - 0.01f)),
+                             std::max(1, (int)std::ceil(extent.z / targetSpacing - 0.01f)));
+    grid.spacing = extent / glm::vec3((float)grid.counts.x, (float)grid.counts.y, (float)grid.counts.z);
+    return grid;
+}
+
+ProbeVolume::ProbeVolume() : texture(0) {}
+
+ProbeVolume::~ProbeVolume() {
+    if (texture) {
+        glState().forgetTexture(texture);
+        glDeleteTextures(1, &texture);
+    }
+}
+
+bool ProbeVolume::load(const std::string& path, const ProbeGrid& expected, unsigned long long hash) {
+    FILE* file = std::fopen(path.c_str(), "rb");
+    if (!file) {
+        std::cout << "No baked probes at " << path << " (--bake-lightmap creates them)" << std::endl;
+        return false;
+    }
+
+    ProbeFileHeader header;
+    bool ok = std::fread(&header, sizeof(header), 1, file) == 1 && std::memcmp(header.magic, PROBE_MAGIC, 4) == 0;
+    ok = ok && header.counts[0] == expected.counts.x && header.counts[1] == expected.counts.y
+            && header.counts[2] == expected.counts.z;
+    for (int i = 0; i < 3 && ok; ++i) {
+        ok = std::fabs(header.boundsMin[i] - expected.boundsMin[i]) < 1e-3f
+          && std::fabs(header.boundsMax[i] - expected.boundsMax[i]) < 1e-3f;
+    }
+    std::vector<ProbeSH> probes(expected.size());
+    ok = ok && std::fread(&probes[0], sizeof(ProbeSH), probes.size(), file) == probes.size();
+    std::fclose(file);
+    if (!ok) {
+        std::cerr << "Probes in " << path << " do not match this layout; bake them again" << std::endl;
+        return false;
+    }
+    if (!bakeHashMatches(path, hash)) {
+        std::cerr << "Probes in " << path << " were baked for another layout or light set; bake them again"
+                  << std::endl;
+        return false;
+    }
+
+    // Red, green and blue blocks one after another along z
+    int nx = expected.counts.x, ny = expected.counts.y, nz = expected.counts.z;
+    std::vector<glm::vec4> texels((size_t)nx * ny * nz * 3);
+    for (int z = 0; z < nz; ++z) {
+        for (int y = 0; y < ny; ++y) {
+            for (int x = 0; x < nx; ++x) {
+                const ProbeSH& probe = probes[((size_t)z * ny + y) * nx + x];
+                texels[((size_t)z * ny + y) * nx + x] = probe.red;
+                texels[((size_t)(z + nz) * ny + y) * nx + x] = probe.green;
+                texels[((size_t)(z + 2 * nz) * ny + y) * nx + x] = probe.blue;
+            }
+        }
+    }
+
+    if (!texture) glGenTextures(1, &texture);
+    glState().bindTexture(GL_TEXTURE_3D, texture);
+    glTexImage3D(GL_TEXTURE_3D, 0, GL_RGBA16F, nx, ny, nz * 3, 0, GL_RGBA, GL_FLOAT, &texels[0]);
+    renderStats().countTextureUpload(texels.size() * sizeof(glm::vec4));
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+    grid = expected;
+
+    std::cout << "Irradiance probes: " << nx << "x" << ny << "x" << nz << " from " << path << std::endl;
+    return true;
+}
+
+void ProbeVolume::apply(Shader& shader, bool enabled) const {
+    shader.setInt("probeVolume", (int)PROBE_UNIT);
+    shader.setInt("useProbes", enabled && texture ? 1 : 0);
+    if (!enabled || !texture) return;
+    glState().bindTextureUnit(PROBE_UNIT, GL_TEXTURE_3D, texture);
+    shader.setVec3("probeOrigin", grid.probePosition(0, 0, 0));
+    shader.setVec3("probeScale", glm::vec3(1.0f) / grid.spacing);
+    shader.setVec3("probeCounts", glm::vec3((float)grid.counts.x, (float)grid.counts.y, (float)grid.counts.z));
+}
+
+bool saveProbes(const std::string& path, const ProbeGrid& grid, const std::vector<ProbeSH>& probes,
+                unsigned long long hash) {
+    FILE* file = std::fopen(path.c_str(), "wb");
+    if (!file) {
+        std::cerr << "Failed to write probes: " << path << std::endl;
+        return false;
+    }
+    ProbeFileHeader header;
+    std::memcpy(header.magic, PROBE_MAGIC, 4);
+    header.counts[0] = grid.counts.x;
+    header.counts[1] = grid.counts.y;
+    header.counts[2] = grid.counts.z;
+    for (int i = 0; i < 3; ++i) {
+        header.boundsMin[i] = grid.boundsMin[i];
+        header.boundsMax[i] = grid.boundsMax[i];
+    }
+    bool ok = std::fwrite(&header, sizeof(header), 1, file) == 1
+           && std::fwrite(&probes[0], sizeof(ProbeSH), probes.size(), file) == probes.size();
+    ok = std::fclose(file) == 0 && ok;
+    ok = ok && saveBakeHash(path, hash);
+    if (ok) std::cout << "Probes saved: " << path << std::endl;
+    return ok;
+}
@@ -0,0 +1,128 @@
+#include "profiler.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace {
+
+struct Event {
+    const char* name;
+    uint64_t begin, end;
+};
+
+// Written only by its thread; count is published with release so an
+// export sees whole events
+struct ThreadBuffer {
+    std::vector<Event> events;
+    std::atomic<uint64_t> count;
+    unsigned int id;
+    const char* name;
+};
+
+std::atomic<bool> enabled(false);
+std::chrono::steady_clock::time_point epoch;
+size_t capacity = 0;
+
+// Registration is the only locked step, once per thread
+std::mutex registryMutex;
+std::vector<std::unique_ptr<ThreadBuffer> > registry;
+
+thread_local ThreadBuffer* threadBuffer = NULL;
+thread_local const char* threadName = NULL;
+
+ThreadBuffer* currentBuffer() {
+    if (threadBuffer) return threadBuffer;
+    std::unique_ptr<ThreadBuffer> buffer(new ThreadBuffer());
+    buffer->events.resize(capacity);
+    buffer->count.store(0, std::memory_order_relaxed);
+    buffer->name = threadName;
+    std::lock_guard<std::mutex> lock(registryMutex);
+    buffer->id = (unsigned int)registry.size() + 1;
+    threadBuffer = buffer.get();
+    registry.push_back(std::move(buffer));
+    return threadBuffer;
+}
+
+void writeEscaped(FILE* file, const char* text) {
+    for (const char* c = text; *c; ++c) {
+        if (*c == '"' || *c == '\\') std::fputc('\\', file);
+        if ((unsigned char)*c >= 0x20) std::fputc(*c, file);
+    }
+}
+
+} // namespace
+
+void Profiler::start(size_t eventsPerThread) {
+    if (enabled.load()) return;
+    capacity = std::max<size_t>(eventsPerThread, 1);
+    epoch = std::chrono::steady_clock::now();
+    enabled.store(true);
+}
+
+bool Profiler::isEnabled() {
+    return enabled.load(std::memory_order_relaxed);
+}
+
+void Profiler::setThreadName(const char* name) {
+    threadName = name;
+    if (threadBuffer) threadBuffer->name = name;
+}
+
+uint64_t Profiler::now() {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - epoch).count();
+}
+
+void Profiler::record(const char* name, uint64_t beginNs, uint64_t endNs) {
+    ThreadBuffer* buffer = currentBuffer();
+    uint64_t index = buffer->count.load(std::memory_order_relaxed);
+    Event& event = buffer->events[index % capacity];
+    event.name = name;
+    event.begin = beginNs;
+    event.end = endNs;
+    buffer->count.store(index + 1, std::memory_order_release);
+}
+
+bool Profiler::writeChromeTrace(const std::string& path) {
+    FILE* file = std::fopen(path.c_str(), "w");
+    if (!file) {
+        std::cerr << "Failed to write trace: " << path << std::endl;
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(registryMutex);
+    size_t written = 0;
+    std::fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n", file);
+    for (size_t t = 0; t < registry.size(); ++t) {
+        const ThreadBuffer& buffer = *registry[t];
+        std::fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"",
+                     t ? ",\n" : "", buffer.id);
+        if (buffer.name) {
+            writeEscaped(file, buffer.name);
+        } else {
+            std::fprintf(file, "thread %u", buffer.id);
+        }
+        std::fputs("\"}}", file);
+
+        // The ring holds the newest capacity events; complete ("X") events need no pairing
+        uint64_t count = buffer.count.load(std::memory_order_acquire);
+        uint64_t first = count > capacity ? count - capacity : 0;
+        for (uint64_t i = first; i < count; ++i) {
+            const Event& event = buffer.events[i % capacity];
+            std::fputs(",\n{\"name\":\"", file);
+            writeEscaped(file, event.name);
+            std::fprintf(file, "\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}", buffer.id,
+                         event.begin / 1000.0, (event.end - event.begin) / 1000.0);
+        }
+        written += (size_t)(count - first);
+    }
+    std::fputs("\n]}\n", file);
+    bool ok = std::fclose(file) == 0;
+    if (ok) std::cout << "Trace written: " << path << " (" << written << " events)" << std::endl;
+    return ok;
+}
@@ -0,0 +1,162 @@
+#include "render_queue.h"
+#include "gl_state.h"
+#include "render_stats.h"
+#include <cstring>
+
+uint64_t RenderQueue::makeKey(unsigned int pass, GLuint program, GLuint texture, GLuint vao, float depth01) {
+    if (depth01 < 0.0f) depth01 = 0.0f;
+    if (depth01 > 1.0f) depth01 = 1.0f;
+    uint64_t depth = (uint64_t)(depth01 * 16777215.0f);
+
+    // GL names are masked to their field width; an alias only costs grouping, not correctness
+    uint64_t state = ((uint64_t)(program & 0x3FF) << 26) |
+                     ((uint64_t)(texture & 0x3FFF) << 12) |
+                     (uint64_t)(vao & 0xFFF);
+    uint64_t key = (uint64_t)(pass & 0xF) << 60;
+
+    if (pass >= PASS_TRANSPARENT) {
+        return key | ((0xFFFFFF - depth) << 36) | state;
+    }
+    return key | (state << 24) | depth;
+}
+
+void RenderQueue::clear() {
+    commands.clear();
+    entries.clear();
+}
+
+void RenderQueue::submit(unsigned int pass, const DrawCommand& command, float viewDepth) {
+    Entry entry;
+    entry.key = makeKey(pass, command.shader->ID, command.texture, command.vao, viewDepth * depthScale);
+    entry.payload = (uint32_t)commands.size();
+    commands.push_back(command);
+    entries.push_back(entry);
+}
+
+// LSD radix sort on 8-bit digits; digits that are identical across all keys are skipped
+void RenderQueue::sort() {
+    size_t n = entries.size();
+    if (n < 2) return;
+    scratch.resize(n);
+
+    Entry* src = &entries[0];
+    Entry* dst = &scratch[0];
+    for (int shift = 0; shift < 64; shift += 8) {
+        size_t histogram[256];
+        std::memset(histogram, 0, sizeof(histogram));
+        for (size_t i = 0; i < n; ++i) {
+            histogram[(src[i].key >> shift) & 0xFF]++;
+        }
+        if (histogram[(src[0].key >> shift) & 0xFF] == n) continue;
+
+        size_t offset = 0;
+        for (int d = 0; d < 256; ++d) {
+            size_t count = histogram[d];
+            histogram[d] = offset;
+            offset += count;
+        }
+        for (size_t i = 0; i < n; ++i) {
+            dst[histogram[(src[i].key >> shift) & 0xFF]++] = src[i];
+        }
+        Entry* tmp = src;
+        src = dst;
+        dst = tmp;
+    }
+    if (src != &entries[0]) {
+        std::memcpy(&entries[0], src, n * sizeof(Entry));
+    }
+}
+
+void RenderQueue::writeObjects(FrameAllocator& ring) {
+    GLsizeiptr stride = (sizeof(ObjectBlock) + ring.alignment() - 1) / ring.alignment() * ring.alignment();
+    ring.reserve(stride * commands.size());
+    objectBuffer = ring.buffer();
+    objectOffsets.resize(commands.size());
+
+    // Runs of commands sharing a transform (the room's submeshes) share one block
+    const Transform* last = NULL;
+    GLintptr lastOffset = 0;
+    for (size_t i = 0; i < commands.size(); ++i) {
+        const Transform* transform = commands[i].transform;
+        if (!transform) continue;
+        if (transform != last) {
+            FrameAllocator::Allocation allocation = ring.allocate(sizeof(ObjectBlock));
+            ObjectBlock block;
+            block.model = transform->getModelMatrix();
+            glm::mat3 normalMatrix = transform->getNormalMatrix();
+            for (int column = 0; column < 3; ++column) {
+                block.normalMatrix[column] = glm::vec4(normalMatrix[column], 0.0f);
+            }
+            std::memcpy(allocation.data, &block, sizeof(block));
+            last = transform;
+            lastOffset = allocation.offset;
+        }
+        objectOffsets[i] = lastOffset;
+    }
+}
+
+void RenderQueue::execute() {
+    for (size_t i = 0; i < entries.size(); ++i) {
+        const DrawCommand& cmd = commands[entries[i].payload];
+
+        cmd.shader->use();
+        glState().bindVertexArray(cmd.vao);
+        glState().bindTextureUnit(0, cmd.textureTarget, cmd.texture);
+        if (cmd.transform) {
+            glState().bindUniformBufferRange(OBJECT_BLOCK_BINDING, objectBuffer, objectOffsets[entries[i].payload],
+                                             sizeof(ObjectBlock));
+        }
+
+        // The GPU drops the draw if the query found nothing; a result not yet
+        // available counts as visible rather than stalling
+        if (cmd.condition) glBeginConditionalRender(cmd.condition, GL_QUERY_NO_WAIT);
+
+        if (cmd.instanceCount > 0) {
+            if (cmd.indexType) {
+                glDrawElementsInstanced(cmd.mode, cmd.count, cmd.indexType, (void*)cmd.first, cmd.instanceCount);
+            } else {
+                glDrawArraysInstanced(cmd.mode, (GLint)cmd.first, cmd.count, cmd.instanceCount);
+            }
+        } else if (cmd.indexType) {
+            glDrawElements(cmd.mode, cmd.count, cmd.indexType, (void*)cmd.first);
+        } else {
+            glDrawArrays(cmd.mode, (GLint)cmd.first, cmd.count);
+        }
+        renderStats().countDraw(cmd.mode, cmd.count, cmd.instanceCount);
+
+        if (cmd.condition) glEndConditionalRender();
+    }
+}
+
+unsigned int RenderQueue::executeDepth() {
+    unsigned int draws = 0;
+    for (size_t i = 0; i < entries.size(); ++i) {
+        if ((entries[i].key >> 60) >= PASS_TRANSPARENT) break;
+        const DrawCommand& cmd = commands[entries[i].payload];
+        if (!cmd.depthShader) continue;
+
+        cmd.depthShader->use();
+        glState().bindVertexArray(cmd.depthVao ? cmd.depthVao : cmd.vao);
+        if (cmd.transform) {
+            glState().bindUniformBufferRange(OBJECT_BLOCK_BINDING, objectBuffer, objectOffsets[entries[i].payload],
+                                             sizeof(ObjectBlock));
+        }
+
+        if (cmd.condition) glBeginConditionalRender(cmd.condition, GL_QUERY_NO_WAIT);
+        if (cmd.instanceCount > 0) {
+            if (cmd.indexType) {
+                glDrawElementsInstanced(cmd.mode, cmd.count, cmd.indexType, (void*)cmd.first, cmd.instanceCount);
+            } else {
+                glDrawArraysInstanced(cmd.mode, (GLint)cmd.first, cmd.count, cmd.instanceCount);
+            }
+        } else if (cmd.indexType) {
+            glDrawElements(cmd.mode, cmd.count, cmd.indexType, (void*)cmd.first);
+        } else {
+            glDrawArrays(cmd.mode, (GLint)cmd.first, cmd.count);
+        }
+        renderStats().countDraw(cmd.mode, cmd.count, cmd.instanceCount);
+        if (cmd.condition) glEndConditionalRender();
+        ++draws;
+    }
+    return draws;
+}
@@ -0,0 +1,123 @@
+#include "render_stats.h"
+#include <algorithm>
+#include <cstring>
+
+static const char* COUNTER_NAMES[FrameWork::COUNTER_COUNT] = {
+    "draw_calls", "triangles", "program_binds", "vertex_array_binds", "texture_binds", "buffer_binds",
+    "uniform_uploads", "buffer_bytes", "texture_bytes"
+};
+
+FrameWork::FrameWork() {
+    std::memset(counts, 0, sizeof(counts));
+}
+
+const char* FrameWork::name(Counter counter) {
+    return COUNTER_NAMES[counter];
+}
+
+RenderStats::RenderStats(size_t frames) : windowSize(0), next(0), frames(0) {
+    std::memset(&lastState, 0, sizeof(lastState));
+    setWindow(frames);
+}
+
+void RenderStats::setWindow(size_t frameCount) {
+    windowSize = std::max<size_t>(frameCount, 1);
+    history.clear();
+    history.reserve(windowSize);
+    next = 0;
+}
+
+void RenderStats::countDraw(GLenum mode, GLsizei count, GLsizei instances) {
+    unsigned long long triangles = 0;
+    switch (mode) {
+        case GL_TRIANGLES:      triangles = count / 3; break;
+        case GL_TRIANGLE_STRIP:
+        case GL_TRIANGLE_FAN:   triangles = count > 2 ? count - 2 : 0; break;
+        default:                break;
+    }
+    current.counts[FrameWork::DRAW_CALLS]++;
+    current.counts[FrameWork::TRIANGLES] += triangles * std::max(instances, 1);
+}
+
+void RenderStats::countMultiDraw(unsigned long long triangles) {
+    current.counts[FrameWork::DRAW_CALLS]++;
+    current.counts[FrameWork::TRIANGLES] += triangles;
+}
+
+void RenderStats::endFrame(const GLStateCache::Counters& state) {
+    current.counts[FrameWork::PROGRAM_BINDS] = state.issued[GLStateCache::PROGRAM];
+    current.counts[FrameWork::VERTEX_ARRAY_BINDS] = state.issued[GLStateCache::VERTEX_ARRAY];
+    current.counts[FrameWork::TEXTURE_BINDS] = state.issued[GLStateCache::TEXTURE]
+                                              + state.issued[GLStateCache::ACTIVE_TEXTURE];
+    current.counts[FrameWork::BUFFER_BINDS] = state.issued[GLStateCache::BUFFER_RANGE];
+    current.counts[FrameWork::UNIFORM_UPLOADS] = state.issued[GLStateCache::UNIFORM];
+
+    if (history.size() < windowSize) {
+        history.push_back(current);
+    } else {
+        history[next] = current;
+    }
+    next = (next + 1) % windowSize;
+    last = current;
+    lastState = state;
+    current = FrameWork();
+    frames++;
+}
+
+FrameWork RenderStats::minimum() const {
+    FrameWork result;
+    for (int c = 0; c < FrameWork::COUNTER_COUNT; ++c) {
+        for (size_t i = 0; i < history.size(); ++i) {
+            result.counts[c] = i == 0 ? history[i].counts[c] : std::min(result.counts[c], history[i].counts[c]);
+        }
+    }
+    return result;
+}
+
+FrameWork RenderStats::maximum() const {
+    FrameWork result;
+    for (size_t i = 0; i < history.size(); ++i) {
+        for (int c = 0; c < FrameWork::COUNTER_COUNT; ++c) {
+            result.counts[c] = std::max(result.counts[c], history[i].counts[c]);
+        }
+    }
+    return result;
+}
+
+void RenderStats::average(double out[FrameWork::COUNTER_COUNT]) const {
+    for (int c = 0; c < FrameWork::COUNTER_COUNT; ++c) {
+        double sum = 0.0;
+        for (size_t i = 0; i < history.size(); ++i) sum += (double)history[i].counts[c];
+        out[c] = history.empty() ? 0.0 : sum / history.size();
+    }
+}
+
+void RenderStats::printSummary(std::ostream& out) const {
+    FrameWork low = minimum();
+    FrameWork high = maximum();
+    double mean[FrameWork::COUNTER_COUNT];
+    average(mean);
+    out << "Render work over " << history.size() << " frames (min/avg/max):";
+    for (int c = 0; c < FrameWork::COUNTER_COUNT; ++c) {
+        out << (c ? ", " : " ") << COUNTER_NAMES[c] << " " << low.counts[c] << "/" << (unsigned long long)(mean[c] + 0.5)
+            << "/" << high.counts[c];
+    }
+    out << std::endl;
+}
+
+void RenderStats::writeCsvHeader(std::ostream& out) {
+    out << "frame";
+    for (int c = 0; c < FrameWork::COUNTER_COUNT; ++c) out << "," << COUNTER_NAMES[c];
+    out << "\n";
+}
+
+void RenderStats::writeCsvRow(std::ostream& out) const {
+    out << frames;
+    for (int c = 0; c < FrameWork::COUNTER_COUNT; ++c) out << "," << last.counts[c];
+    out << "\n";
+}
+
+RenderStats& renderStats() {
+    static RenderStats stats;
+    return stats;
+}
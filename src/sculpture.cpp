@@ -0,0 +1,167 @@
+#include "sculpture.h"
+#include "gl_state.h"
+#include "texture.h"
+#include <algorithm>
+#include <cmath>
+
+static const char* PLINTH_TEXTURE_PATH = "assets/textures/concrete_wall.jpg";
+static const char* KNOT_TEXTURE_PATH = "assets/textures/marble.jpeg";
+
+static const float PLINTH_HALF_WIDTH = 0.4f;
+static const float PLINTH_HEIGHT = 1.0f;
+static const float KNOT_SCALE = 0.23f;       // the (2, 3) knot spans about 3 of these either side
+static const float KNOT_TUBE_RADIUS = 0.09f;
+static const float KNOT_CENTER = PLINTH_HEIGHT + 0.8f;
+static const float TURN_RATE = 20.0f;        // degrees per second
+
+// Point on a (2, 3) torus knot in the XY plane, t in [0, 2 pi)
+static glm::vec3 knotPoint(float t) {
+    float r = 2.0f + std::cos(3.0f * t);
+    return glm::vec3(r * std::cos(2.0f * t), r * std::sin(2.0f * t), std::sin(3.0f * t)) * KNOT_SCALE;
+}
+
+static void buildKnot(StaticMeshBuilder& builder) {
+    const int SEGMENTS = 160;
+    const int SIDES = 12;
+    const float TWO_PI = 6.28318531f;
+    builder.beginSubMesh(0);
+
+    // Rings of the tube; the frame comes from the tangent and the z axis,
+    // which the knot's tangent never lines up with
+    std::vector<Vertex> rings((SEGMENTS + 1) * (SIDES + 1));
+    for (int i = 0; i <= SEGMENTS; ++i) {
+        float t = TWO_PI * i / SEGMENTS;
+        glm::vec3 center = knotPoint(t);
+        glm::vec3 tangent = glm::normalize(knotPoint(t + 1e-3f) - knotPoint(t - 1e-3f));
+        glm::vec3 side = glm::normalize(glm::cross(tangent, glm::vec3(0.0f, 0.0f, 1.0f)));
+        glm::vec3 up = glm::cross(side, tangent);
+        for (int j = 0; j <= SIDES; ++j) {
+            float angle = TWO_PI * j / SIDES;
+            glm::vec3 normal = side * std::cos(angle) + up * std::sin(angle);
+            rings[i * (SIDES + 1) + j] = Vertex(center + normal * KNOT_TUBE_RADIUS, normal,
+                                                glm::vec2(8.0f * i / SEGMENTS, (float)j / SIDES));
+        }
+    }
+    for (int i = 0; i < SEGMENTS; ++i) {
+        for (int j = 0; j < SIDES; ++j) {
+            builder.addQuad(rings[i * (SIDES + 1) + j], rings[(i + 1) * (SIDES + 1) + j],
+                            rings[(i + 1) * (SIDES + 1) + j + 1], rings[i * (SIDES + 1) + j + 1]);
+        }
+    }
+}
+
+// Four sides and a top, no bottom; origin at the centre of the base
+static void buildPlinth(StaticMeshBuilder& builder) {
+    float w = PLINTH_HALF_WIDTH;
+    float h = PLINTH_HEIGHT;
+    builder.beginSubMesh(0);
+    for (int face = 0; face < 4; ++face) {
+        // Outward normal turning a quarter at a time from +Z
+        glm::vec3 n = face == 0 ? glm::vec3(0.0f, 0.0f, 1.0f) : face == 1 ? glm::vec3(1.0f, 0.0f, 0.0f)
+                    : face == 2 ? glm::vec3(0.0f, 0.0f, -1.0f) : glm::vec3(-1.0f, 0.0f, 0.0f);
+        glm::vec3 right(n.z, 0.0f, -n.x);
+        glm::vec3 center = n * w;
+        builder.addQuad(Vertex(center - right * w, n, glm::vec2(0.0f, 0.0f)),
+                        Vertex(center + right * w, n, glm::vec2(2.0f * w, 0.0f)),
+                        Vertex(center + right * w + glm::vec3(0.0f, h, 0.0f), n, glm::vec2(2.0f * w, h)),
+                        Vertex(center - right * w + glm::vec3(0.0f, h, 0.0f), n, glm::vec2(0.0f, h)));
+    }
+    glm::vec3 up(0.0f, 1.0f, 0.0f);
+    builder.addQuad(Vertex(glm::vec3(-w, h,  w), up, glm::vec2(0.0f, 0.0f)),
+                    Vertex(glm::vec3( w, h,  w), up, glm::vec2(2.0f * w, 0.0f)),
+                    Vertex(glm::vec3( w, h, -w), up, glm::vec2(2.0f * w, 2.0f * w)),
+                    Vertex(glm::vec3(-w, h, -w), up, glm::vec2(0.0f, 2.0f * w)));
+}
+
+SculptureRenderer::SculptureRenderer() : plinthTexture(0), knotTexture(0) {}
+
+SculptureRenderer::~SculptureRenderer() {
+    GLuint textures[2] = { plinthTexture, knotTexture };
+    for (int i = 0; i < 2; ++i) {
+        if (!textures[i]) continue;
+        glState().forgetTexture(textures[i]);
+        glDeleteTextures(1, &textures[i]);
+    }
+}
+
+void SculptureRenderer::add(const glm::vec3& base, int cell) {
+    Sculpture sculpture;
+    sculpture.plinth.setPosition(base);
+    sculpture.knot.setPosition(base + glm::vec3(0.0f, KNOT_CENTER, 0.0f));
+    sculpture.cell = cell;
+    sculpture.phase = 47.0f * sculptures.size();
+    sculptures.push_back(sculpture);
+}
+
+void SculptureRenderer::build() {
+    if (sculptures.empty()) return;
+    StaticMeshBuilder plinth;
+    buildPlinth(plinth);
+    plinthMesh.upload(plinth);
+    StaticMeshBuilder knot;
+    buildKnot(knot);
+    knotMesh.upload(knot);
+    plinthTexture = loadTexture(PLINTH_TEXTURE_PATH);
+    knotTexture = loadTexture(KNOT_TEXTURE_PATH);
+    update(0.0f);
+}
+
+void SculptureRenderer::update(float time) {
+    for (size_t i = 0; i < sculptures.size(); ++i) {
+        float angle = std::fmod(sculptures[i].phase + TURN_RATE * time, 360.0f);
+        sculptures[i].knot.setRotation(glm::vec3(0.0f, angle, 0.0f));
+    }
+}
+
+void SculptureRenderer::getBounds(size_t index, glm::vec3& minCorner, glm::vec3& maxCorner) const {
+    // Any turn of the knot stays inside a cylinder of its outer radius
+    glm::vec3 base = sculptures[index].plinth.getPosition();
+    float radius = std::max(PLINTH_HALF_WIDTH, 3.0f * KNOT_SCALE + KNOT_TUBE_RADIUS);
+    minCorner = base - glm::vec3(radius, 0.0f, radius);
+    maxCorner = base + glm::vec3(radius, KNOT_CENTER + 3.0f * KNOT_SCALE + KNOT_TUBE_RADIUS, radius);
+}
+
+DrawCommand SculptureRenderer::command(const StaticMesh& mesh, GLuint texture, const Transform& transform,
+                                       Shader* shader) const {
+    const SubMesh& subMesh = mesh.getSubMeshes()[0];
+    DrawCommand cmd;
+    cmd.shader = shader;
+    cmd.vao = mesh.getVAO();
+    cmd.textureTarget = GL_TEXTURE_2D;
+    cmd.texture = texture;
+    cmd.transform = &transform;
+    cmd.mode = GL_TRIANGLES;
+    cmd.count = subMesh.indexCount;
+    cmd.indexType = mesh.getIndexType();
+    cmd.first = mesh.indexOffset(subMesh);
+    cmd.instanceCount = 0;
+    cmd.condition = 0;
+    cmd.depthShader = NULL;
+    cmd.depthVao = mesh.getDepthVAO();
+    return cmd;
+}
+
+void SculptureRenderer::submit(RenderQueue& queue, Shader& shader, const std::vector<uint32_t>& indices,
+                               const glm::mat4& view, const std::vector<GLuint>& conditions, Shader* depthShader) {
+    shader.setInt("texture1", 0);
+    for (size_t i = 0; i < indices.size(); ++i) {
+        const Sculpture& sculpture = sculptures[indices[i]];
+        float depth = -(view * glm::vec4(sculpture.knot.getPosition(), 1.0f)).z;
+        DrawCommand plinth = command(plinthMesh, plinthTexture, sculpture.plinth, &shader);
+        DrawCommand knot = command(knotMesh, knotTexture, sculpture.knot, &shader);
+        plinth.depthShader = knot.depthShader = depthShader;
+        if (sculpture.cell >= 0 && sculpture.cell < (int)conditions.size()) {
+            plinth.condition = knot.condition = conditions[sculpture.cell];
+        }
+        queue.submit(PASS_OPAQUE, plinth, depth);
+        queue.submit(PASS_OPAQUE, knot, depth);
+    }
+}
+
+void SculptureRenderer::addShadowCasters(const std::vector<uint32_t>& indices, std::vector<DrawCommand>& casters) const {
+    for (size_t i = 0; i < indices.size(); ++i) {
+        const Sculpture& sculpture = sculptures[indices[i]];
+        casters.push_back(command(plinthMesh, plinthTexture, sculpture.plinth, NULL));
+        casters.push_back(command(knotMesh, knotTexture, sculpture.knot, NULL));
+    }
+}
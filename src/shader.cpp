@@ -1,4 +1,6 @@
 #include "shader.h"
+#include "gl_state.h"
+#include "profiler.h"
 #include <iostream>
 #include <fstream>
 #include <sstream>
@@ -12,7 +14,51 @@ void checkOpenGLError(const std::string &message) {
     }
 }
 
-Shader::Shader(const char* vertexPath, const char* fragmentPath) {
+// Replaces #include "file" lines with that file's contents, resolved
+// relative to the including shader so stages can share lighting code
+std::string resolveIncludes(const std::string &source, const std::string &path, int depth = 0) {
+    std::string directory;
+    size_t slash = path.find_last_of("/\\");
+    if (slash != std::string::npos) {
+        directory = path.substr(0, slash + 1);
+    }
+
+    std::stringstream input(source);
+    std::stringstream output;
+    std::string line;
+    while (std::getline(input, line)) {
+        size_t directive = line.find("#include");
+        size_t open = line.find('"');
+        size_t close = line.rfind('"');
+        if (directive != std::string::npos && directive == line.find_first_not_of(" \t") &&
+            open != std::string::npos && close > open) {
+            std::string includePath = directory + line.substr(open + 1, close - open - 1);
+            std::ifstream includeFile(includePath.c_str());
+            if (!includeFile.is_open() || depth > 8) {
+                std::cerr << "ERROR::SHADER::INCLUDE_NOT_SUCCESFULLY_READ: " << includePath << std::endl;
+                continue;
+            }
+            std::stringstream includeStream;
+            includeStream << includeFile.rdbuf();
+            output << resolveIncludes(includeStream.str(), includePath, depth + 1) << "\n";
+        } else {
+            output << line << "\n";
+        }
+    }
+    return output.str();
+}
+
+// Puts extra #define lines right after #version, which must stay first
+static std::string insertDefines(const std::string &source, const char* defines) {
+    if (!defines) return source;
+    size_t version = source.find("#version");
+    size_t lineEnd = version == std::string::npos ? std::string::npos : source.find('\n', version);
+    if (lineEnd == std::string::npos) return defines + source;
+    return source.substr(0, lineEnd + 1) + defines + source.substr(lineEnd + 1);
+}
+
+Shader::Shader(const char* vertexPath, const char* fragmentPath, const char* defines) {
+    PROFILE_SCOPE("Shader::Shader");
     std::string vertexCode;
     std::string fragmentCode;
     std::ifstream vShaderFile;
@@ -23,23 +69,23 @@ Shader::Shader(const char* vertexPath, const char* fragmentPath) {
     if (!vShaderFile.is_open()) {
         std::cerr << "ERROR::SHADER::VERTEX::FILE_NOT_SUCCESFULLY_READ: " << vertexPath << std::endl;
     }
-    fShaderFile.open(fragmentPath);
-    if (!fShaderFile.is_open()) {
+    if (fragmentPath) fShaderFile.open(fragmentPath);
+    if (fragmentPath && !fShaderFile.is_open()) {
         std::cerr << "ERROR::SHADER::FRAGMENT::FILE_NOT_SUCCESFULLY_READ: " << fragmentPath << std::endl;
     }
 
     // Read file content into strings
     std::stringstream vShaderStream, fShaderStream;
     vShaderStream << vShaderFile.rdbuf();
-    fShaderStream << fShaderFile.rdbuf();
+    if (fragmentPath) fShaderStream << fShaderFile.rdbuf();
 
-    vertexCode = vShaderStream.str();
-    fragmentCode = fShaderStream.str();
+    vertexCode = insertDefines(resolveIncludes(vShaderStream.str(), vertexPath), defines);
+    if (fragmentPath) fragmentCode = insertDefines(resolveIncludes(fShaderStream.str(), fragmentPath), defines);
 
     const char* vShaderCode = vertexCode.c_str();
     const char* fShaderCode = fragmentCode.c_str();
 
-    GLuint vertex, fragment;
+    GLuint vertex, fragment = 0;
     GLint success;
     GLchar infoLog[512];
 
@@ -55,22 +101,24 @@ Shader::Shader(const char* vertexPath, const char* fragmentPath) {
         std::cout << "Vertex Shader Compiled Successfully!" << std::endl;
     }
 
-    // Compile fragment shader
-    fragment = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragment, 1, &fShaderCode, NULL);
-    glCompileShader(fragment);
-    glGetShaderiv(fragment, GL_COMPILE_STATUS, &success);
-    if (!success) {
-        glGetShaderInfoLog(fragment, 512, NULL, infoLog);
-        std::cerr << "ERROR::SHADER::FRAGMENT::COMPILATION_FAILED\n" << infoLog << std::endl;
-    } else {
-        std::cout << "Fragment Shader Compiled Successfully!" << std::endl;
+    // Compile fragment shader, unless this is a depth-only program
+    if (fragmentPath) {
+        fragment = glCreateShader(GL_FRAGMENT_SHADER);
+        glShaderSource(fragment, 1, &fShaderCode, NULL);
+        glCompileShader(fragment);
+        glGetShaderiv(fragment, GL_COMPILE_STATUS, &success);
+        if (!success) {
+            glGetShaderInfoLog(fragment, 512, NULL, infoLog);
+            std::cerr << "ERROR::SHADER::FRAGMENT::COMPILATION_FAILED\n" << infoLog << std::endl;
+        } else {
+            std::cout << "Fragment Shader Compiled Successfully!" << std::endl;
+        }
     }
 
     // Link shaders into a program
     ID = glCreateProgram();
     glAttachShader(ID, vertex);
-    glAttachShader(ID, fragment);
+    if (fragment) glAttachShader(ID, fragment);
     glLinkProgram(ID);
     glGetProgramiv(ID, GL_LINK_STATUS, &success);
     if (!success) {
@@ -82,33 +130,75 @@ Shader::Shader(const char* vertexPath, const char* fragmentPath) {
 
     // Clean up shaders after linking
     glDeleteShader(vertex);
-    glDeleteShader(fragment);
+    if (fragment) glDeleteShader(fragment);
+
+    GLuint objectBlock = glGetUniformBlockIndex(ID, "Object");
+    if (objectBlock != GL_INVALID_INDEX) glUniformBlockBinding(ID, objectBlock, OBJECT_BLOCK_BINDING);
 
     // Check for OpenGL errors after shader setup
     checkOpenGLError("Shader Compilation and Linking");
 }
 
+bool Shader::isLinked() const {
+    GLint success = 0;
+    glGetProgramiv(ID, GL_LINK_STATUS, &success);
+    return success == GL_TRUE;
+}
+
 void Shader::use() {
-    glUseProgram(ID);
-    checkOpenGLError("glUseProgram");
+    if (glState().useProgram(ID)) {
+        checkOpenGLError("glUseProgram");
+    }
+}
+
+GLint Shader::uniformLocation(const std::string &name) {
+    std::unordered_map<std::string, GLint>::iterator it = uniformLocations.find(name);
+    if (it != uniformLocations.end()) {
+        return it->second;
+    }
+    GLint location = glGetUniformLocation(ID, name.c_str());
+    uniformLocations[name] = location;
+    return location;
+}
+
+void Shader::setMat3(const std::string &name, const glm::mat3 &mat) {
+    if (glState().uniformMatrix3fv(ID, uniformLocation(name), &mat[0][0])) {
+        checkOpenGLError("setMat3");
+    }
 }
 
 void Shader::setMat4(const std::string &name, const glm::mat4 &mat) {
-    glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
-    checkOpenGLError("setMat4");
+    if (glState().uniformMatrix4fv(ID, uniformLocation(name), &mat[0][0])) {
+        checkOpenGLError("setMat4");
+    }
+}
+
+void Shader::setVec2(const std::string &name, const glm::vec2 &value) {
+    if (glState().uniform2fv(ID, uniformLocation(name), &value[0])) {
+        checkOpenGLError("setVec2");
+    }
 }
 
 void Shader::setVec3(const std::string &name, const glm::vec3 &value) {
-    glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
-    checkOpenGLError("setVec3");
+    if (glState().uniform3fv(ID, uniformLocation(name), &value[0])) {
+        checkOpenGLError("setVec3");
+    }
+}
+
+void Shader::setVec4(const std::string &name, const glm::vec4 &value) {
+    if (glState().uniform4fv(ID, uniformLocation(name), &value[0])) {
+        checkOpenGLError("setVec4");
+    }
 }
 
 void Shader::setFloat(const std::string &name, float value) {
-    glUniform1f(glGetUniformLocation(ID, name.c_str()), value);
-    checkOpenGLError("setFloat");
+    if (glState().uniform1f(ID, uniformLocation(name), value)) {
+        checkOpenGLError("setFloat");
+    }
 }
 
 void Shader::setInt(const std::string &name, int value) {
-    glUniform1f(glGetUniformLocation(ID, name.c_str()), value);
-    checkOpenGLError("setInt");
+    if (glState().uniform1i(ID, uniformLocation(name), value)) {
+        checkOpenGLError("setInt");
+    }
 }
@@ -0,0 +1,142 @@
+#include "shadow_map.h"
+#include "gl_state.h"
+#include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+ShadowMap::ShadowMap(int mapSize)
+    : size(mapSize), boundsMin(-10.0f), boundsMax(10.0f), lightDirection(0.0f, -1.0f, 0.0f),
+      lightSpace(1.0f), texelSize(0.0f), staticDirty(true), composited(false), staticRenderCount(0) {
+    for (int i = 0; i < MAP_COUNT; ++i) {
+        textures[i] = 0;
+        framebuffers[i] = 0;
+    }
+}
+
+ShadowMap::~ShadowMap() {
+    for (int i = 0; i < MAP_COUNT; ++i) glState().forgetTexture(textures[i]);
+    if (framebuffers[0]) {
+        glDeleteFramebuffers(MAP_COUNT, framebuffers);
+        glDeleteTextures(MAP_COUNT, textures);
+    }
+}
+
+void ShadowMap::init() {
+    depthProgram.reset(new Shader("shaders/shadow_vs.glsl", "shaders/shadow_fs.glsl"));
+    instancedDepthProgram.reset(new Shader("shaders/shadow_instanced_vs.glsl", "shaders/shadow_fs.glsl"));
+
+    glGenTextures(MAP_COUNT, textures);
+    glGenFramebuffers(MAP_COUNT, framebuffers);
+    const float border[4] = { 1.0f, 1.0f, 1.0f, 1.0f }; // outside the map is lit
+    for (int i = 0; i < MAP_COUNT; ++i) {
+        glState().bindTexture(GL_TEXTURE_2D, textures[i]);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24, size, size, 0, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, NULL);
+        // Linear filtering on a comparison sampler gives each tap 2x2 PCF for free
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+        glTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, border);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffers[i]);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, textures[i], 0);
+        glDrawBuffer(GL_NONE);
+        glReadBuffer(GL_NONE);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+            std::cerr << "Shadow map framebuffer is incomplete" << std::endl;
+        }
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, glState().defaultFramebuffer());
+    std::cout << "Shadow map: " << size << "x" << size << ", cached static pass" << std::endl;
+}
+
+void ShadowMap::setSceneBounds(const glm::vec3& minCorner, const glm::vec3& maxCorner) {
+    if (minCorner == boundsMin && maxCorner == boundsMax) return;
+    boundsMin = minCorner;
+    boundsMax = maxCorner;
+    updateLightSpace();
+}
+
+void ShadowMap::setLightDirection(const glm::vec3& direction) {
+    glm::vec3 normalized = glm::normalize(direction);
+    if (normalized == lightDirection) return;
+    lightDirection = normalized;
+    updateLightSpace();
+}
+
+void ShadowMap::updateLightSpace() {
+    // Looking down the light at the bounds, with an orthographic box fitted to their corners
+    glm::vec3 center = (boundsMin + boundsMax) * 0.5f;
+    float radius = glm::length(boundsMax - boundsMin) * 0.5f;
+    glm::vec3 up = std::abs(lightDirection.y) > 0.99f ? glm::vec3(0.0f, 0.0f, -1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+    glm::mat4 lightView = glm::lookAt(center - lightDirection * radius, center, up);
+
+    glm::vec3 lo(1e30f), hi(-1e30f);
+    for (int corner = 0; corner < 8; ++corner) {
+        glm::vec3 p((corner & 1) ? boundsMax.x : boundsMin.x, (corner & 2) ? boundsMax.y : boundsMin.y,
+                    (corner & 4) ? boundsMax.z : boundsMin.z);
+        glm::vec3 q(lightView * glm::vec4(p, 1.0f));
+        lo = glm::min(lo, q);
+        hi = glm::max(hi, q);
+    }
+    lightSpace = glm::ortho(lo.x, hi.x, lo.y, hi.y, -hi.z, -lo.z) * lightView;
+    texelSize = std::max(hi.x - lo.x, hi.y - lo.y) / size;
+    staticDirty = true;
+}
+
+void ShadowMap::beginPass(int map) {
+    glGetIntegerv(GL_VIEWPORT, savedViewport);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffers[map]);
+    glViewport(0, 0, size, size);
+    // Slope-scaled offset keeps lit surfaces from shadowing themselves
+    glEnable(GL_POLYGON_OFFSET_FILL);
+    glPolygonOffset(2.0f, 4.0f);
+    depthProgram->setMat4("lightSpace", lightSpace);
+    instancedDepthProgram->setMat4("lightSpace", lightSpace);
+}
+
+void ShadowMap::endPass() {
+    glDisable(GL_POLYGON_OFFSET_FILL);
+    glBindFramebuffer(GL_FRAMEBUFFER, glState().defaultFramebuffer());
+    glViewport(savedViewport[0], savedViewport[1], savedViewport[2], savedViewport[3]);
+}
+
+void ShadowMap::beginStatic() {
+    beginPass(STATIC_MAP);
+    glClear(GL_DEPTH_BUFFER_BIT);
+}
+
+void ShadowMap::endStatic() {
+    endPass();
+    staticDirty = false;
+    staticRenderCount++;
+}
+
+void ShadowMap::beginDynamic() {
+    // Start from the cached static depth instead of redrawing the scene
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffers[STATIC_MAP]);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, framebuffers[COMPOSITE_MAP]);
+    glBlitFramebuffer(0, 0, size, size, 0, 0, size, size, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+    beginPass(COMPOSITE_MAP);
+}
+
+void ShadowMap::endDynamic() {
+    endPass();
+    composited = true;
+}
+
+void ShadowMap::apply(Shader& shader, bool enabled) const {
+    // The sampler always points at its own unit: a shadow and a plain sampler sharing unit 0 fail to draw
+    shader.setInt("shadowMap", SHADOW_UNIT);
+    shader.setInt("staticShadowMap", STATIC_SHADOW_UNIT);
+    shader.setInt("useShadows", enabled && isReady() ? 1 : 0);
+    shader.setInt("useDynamicShadows", composited ? 1 : 0);
+    if (!enabled || !isReady()) return;
+    glState().bindTextureUnit(SHADOW_UNIT, GL_TEXTURE_2D, textures[composited ? COMPOSITE_MAP : STATIC_MAP]);
+    if (composited) glState().bindTextureUnit(STATIC_SHADOW_UNIT, GL_TEXTURE_2D, textures[STATIC_MAP]);
+    shader.setMat4("lightSpace", lightSpace);
+    shader.setFloat("shadowNormalOffset", 1.5f * texelSize);
+}
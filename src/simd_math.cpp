@@ -0,0 +1,52 @@
+#include "simd_math.h"
+
+#if defined(__SSE__) || defined(_M_X64)
+#include <xmmintrin.h>
+
+static inline __m128 cross3(__m128 a, __m128 b) {
+    __m128 aYzx = _mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 0, 2, 1));
+    __m128 bYzx = _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 0, 2, 1));
+    __m128 c = _mm_sub_ps(_mm_mul_ps(a, bYzx), _mm_mul_ps(aYzx, b));
+    return _mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 0, 2, 1));
+}
+
+static inline __m128 dot3(__m128 a, __m128 b) {
+    __m128 m = _mm_mul_ps(a, b);
+    __m128 y = _mm_shuffle_ps(m, m, _MM_SHUFFLE(1, 1, 1, 1));
+    __m128 z = _mm_shuffle_ps(m, m, _MM_SHUFFLE(2, 2, 2, 2));
+    __m128 x = _mm_shuffle_ps(m, m, _MM_SHUFFLE(0, 0, 0, 0));
+    return _mm_add_ps(_mm_add_ps(x, y), z); // dot product splatted across all lanes
+}
+
+glm::mat3 computeNormalMatrix(const glm::mat4& model) {
+    __m128 c0 = _mm_loadu_ps(&model[0][0]);
+    __m128 c1 = _mm_loadu_ps(&model[1][0]);
+    __m128 c2 = _mm_loadu_ps(&model[2][0]);
+
+    __m128 r0 = cross3(c1, c2);
+    __m128 r1 = cross3(c2, c0);
+    __m128 r2 = cross3(c0, c1);
+    __m128 invDet = _mm_div_ps(_mm_set1_ps(1.0f), dot3(c0, r0));
+
+    float out[3][4];
+    _mm_storeu_ps(out[0], _mm_mul_ps(r0, invDet));
+    _mm_storeu_ps(out[1], _mm_mul_ps(r1, invDet));
+    _mm_storeu_ps(out[2], _mm_mul_ps(r2, invDet));
+
+    return glm::mat3(glm::vec3(out[0][0], out[0][1], out[0][2]),
+                     glm::vec3(out[1][0], out[1][1], out[1][2]),
+                     glm::vec3(out[2][0], out[2][1], out[2][2]));
+}
+
+#else
+
+glm::mat3 computeNormalMatrix(const glm::mat4& model) {
+    glm::vec3 c0(model[0]), c1(model[1]), c2(model[2]);
+    glm::vec3 r0 = glm::cross(c1, c2);
+    glm::vec3 r1 = glm::cross(c2, c0);
+    glm::vec3 r2 = glm::cross(c0, c1);
+    float invDet = 1.0f / glm::dot(c0, r0);
+    return glm::mat3(r0 * invDet, r1 * invDet, r2 * invDet);
+}
+
+#endif
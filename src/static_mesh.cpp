@@ -0,0 +1,143 @@
+#include "static_mesh.h"
+#include "gl_state.h"
+#include "render_stats.h"
+#include <cstring>
+#include <iostream>
+
+size_t StaticMeshBuilder::VertexHash::operator()(const Vertex& v) const {
+    // FNV-1a over the raw vertex bytes
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(&v);
+    size_t hash = 2166136261u;
+    for (size_t i = 0; i < sizeof(Vertex); ++i) {
+        hash = (hash ^ bytes[i]) * 16777619u;
+    }
+    return hash;
+}
+
+bool StaticMeshBuilder::VertexEqual::operator()(const Vertex& a, const Vertex& b) const {
+    return std::memcmp(&a, &b, sizeof(Vertex)) == 0;
+}
+
+int StaticMeshBuilder::beginSubMesh(int materialId) {
+    SubMesh subMesh;
+    subMesh.firstIndex = (GLuint)indices.size();
+    subMesh.indexCount = 0;
+    subMesh.materialId = materialId;
+    subMesh.boundsMin = glm::vec3(1e30f);
+    subMesh.boundsMax = glm::vec3(-1e30f);
+    subMeshes.push_back(subMesh);
+    return (int)subMeshes.size() - 1;
+}
+
+GLuint StaticMeshBuilder::addVertex(const Vertex& v) {
+    std::unordered_map<Vertex, GLuint, VertexHash, VertexEqual>::iterator it = lookup.find(v);
+    if (it != lookup.end()) {
+        return it->second;
+    }
+    GLuint index = (GLuint)vertices.size();
+    vertices.push_back(v);
+    lookup[v] = index;
+    return index;
+}
+
+void StaticMeshBuilder::addTriangle(const Vertex& a, const Vertex& b, const Vertex& c) {
+    if (subMeshes.empty()) beginSubMesh(0);
+    indices.push_back(addVertex(a));
+    indices.push_back(addVertex(b));
+    indices.push_back(addVertex(c));
+    SubMesh& subMesh = subMeshes.back();
+    subMesh.indexCount += 3;
+    subMesh.boundsMin = glm::min(subMesh.boundsMin, glm::min(a.position, glm::min(b.position, c.position)));
+    subMesh.boundsMax = glm::max(subMesh.boundsMax, glm::max(a.position, glm::max(b.position, c.position)));
+}
+
+void StaticMeshBuilder::addQuad(const Vertex& a, const Vertex& b, const Vertex& c, const Vertex& d) {
+    addTriangle(a, b, c);
+    addTriangle(a, c, d);
+}
+
+void StaticMeshBuilder::setGeometry(const std::vector<Vertex>& newVertices, const std::vector<GLuint>& newIndices) {
+    vertices = newVertices;
+    indices = newIndices;
+    lookup.clear();
+    for (size_t i = 0; i < vertices.size(); ++i) {
+        lookup[vertices[i]] = (GLuint)i;
+    }
+}
+
+StaticMesh::StaticMesh() : VAO(0), VBO(0), EBO(0), depthVAO(0), positionVBO(0), indexType(GL_UNSIGNED_INT) {}
+
+StaticMesh::~StaticMesh() {
+    release();
+}
+
+void StaticMesh::upload(const StaticMeshBuilder& builder) {
+    release();
+
+    const std::vector<Vertex>& vertices = builder.getVertices();
+    const std::vector<GLuint>& indices = builder.getIndices();
+    subMeshes = builder.getSubMeshes();
+    if (vertices.empty() || indices.empty()) return;
+
+    glGenVertexArrays(1, &VAO);
+    glGenBuffers(1, &VBO);
+    glGenBuffers(1, &EBO);
+
+    glState().bindVertexArray(VAO);
+
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);
+    renderStats().countBufferUpload(vertices.size() * sizeof(Vertex));
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+    if (vertices.size() <= 65536) {
+        std::vector<unsigned short> shortIndices(indices.begin(), indices.end());
+        indexType = GL_UNSIGNED_SHORT;
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, shortIndices.size() * sizeof(unsigned short), &shortIndices[0], GL_STATIC_DRAW);
+        renderStats().countBufferUpload(shortIndices.size() * sizeof(unsigned short));
+    } else {
+        indexType = GL_UNSIGNED_INT;
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint), &indices[0], GL_STATIC_DRAW);
+        renderStats().countBufferUpload(indices.size() * sizeof(GLuint));
+    }
+
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, position));
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, normal));
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, texCoords));
+    glEnableVertexAttribArray(2);
+    glVertexAttribPointer(12, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, lightmapUV));
+    glEnableVertexAttribArray(12);
+
+    std::vector<glm::vec3> positions(vertices.size());
+    for (size_t i = 0; i < vertices.size(); ++i) positions[i] = vertices[i].position;
+    glGenVertexArrays(1, &depthVAO);
+    glGenBuffers(1, &positionVBO);
+    glState().bindVertexArray(depthVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, positionVBO);
+    glBufferData(GL_ARRAY_BUFFER, positions.size() * sizeof(glm::vec3), &positions[0], GL_STATIC_DRAW);
+    renderStats().countBufferUpload(positions.size() * sizeof(glm::vec3));
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (void*)0);
+    glEnableVertexAttribArray(0);
+
+    std::cout << "Static mesh: " << vertices.size() << " vertices, " << indices.size() << " indices, "
+              << subMeshes.size() << " submeshes ("
+              << vertices.size() * (sizeof(Vertex) + sizeof(glm::vec3)) + indices.size() * getIndexSize()
+              << " bytes)" << std::endl;
+}
+
+void StaticMesh::release() {
+    if (VAO) {
+        glState().forgetVertexArray(VAO);
+        glDeleteVertexArrays(1, &VAO);
+        glDeleteBuffers(1, &VBO);
+        glDeleteBuffers(1, &EBO);
+        glState().forgetVertexArray(depthVAO);
+        glDeleteVertexArrays(1, &depthVAO);
+        glDeleteBuffers(1, &positionVBO);
+    }
+    VAO = VBO = EBO = depthVAO = positionVBO = 0;
+    subMeshes.clear();
+}
@@ -1,12 +1,18 @@
 #define STB_IMAGE_IMPLEMENTATION  
 #include "stb_image.h"
 #include "texture.h"
+#include "gl_state.h"
+#include "profiler.h"
+#include "render_stats.h"
 #include <iostream>
+#include <vector>
+#include <algorithm>
 
 GLuint loadTexture(const std::string& path) {
+    PROFILE_FUNCTION();
     GLuint textureID;
     glGenTextures(1, &textureID);
-    glBindTexture(GL_TEXTURE_2D, textureID);
+    glState().bindTexture(GL_TEXTURE_2D, textureID);
 
     int width, height, nrChannels;
     unsigned char* data = stbi_load(path.c_str(), &width, &height, &nrChannels, 0);
@@ -17,6 +23,7 @@ GLuint loadTexture(const std::string& path) {
 
         // Load the texture data with proper format and handle sRGB textures
         glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, format, GL_UNSIGNED_BYTE, data);
+        renderStats().countTextureUpload((size_t)width * height * nrChannels);
         glGenerateMipmap(GL_TEXTURE_2D);
 
         // Free image data after uploading to OpenGL
@@ -34,3 +41,98 @@ GLuint loadTexture(const std::string& path) {
 
     return textureID;
 }
+
+
+// Box filter when shrinking, bilinear when enlarging
+static void resizeImage(const unsigned char* src, int srcWidth, int srcHeight,
+                        unsigned char* dst, int dstWidth, int dstHeight, int channels) {
+    float scaleX = (float)srcWidth / dstWidth;
+    float scaleY = (float)srcHeight / dstHeight;
+    bool shrinking = scaleX >= 1.0f && scaleY >= 1.0f;
+
+    for (int y = 0; y < dstHeight; ++y) {
+        for (int x = 0; x < dstWidth; ++x) {
+            unsigned char* out = dst + (y * dstWidth + x) * channels;
+            if (shrinking) {
+                int x0 = (int)(x * scaleX), x1 = std::max(x0 + 1, (int)((x + 1) * scaleX));
+                int y0 = (int)(y * scaleY), y1 = std::max(y0 + 1, (int)((y + 1) * scaleY));
+                x1 = std::min(x1, srcWidth);
+                y1 = std::min(y1, srcHeight);
+                for (int c = 0; c < channels; ++c) {
+                    unsigned int sum = 0;
+                    for (int sy = y0; sy < y1; ++sy) {
+                        for (int sx = x0; sx < x1; ++sx) {
+                            sum += src[(sy * srcWidth + sx) * channels + c];
+                        }
+                    }
+                    out[c] = (unsigned char)(sum / ((x1 - x0) * (y1 - y0)));
+                }
+            } else {
+                float fx = std::max(0.0f, (x + 0.5f) * scaleX - 0.5f);
+                float fy = std::max(0.0f, (y + 0.5f) * scaleY - 0.5f);
+                int x0 = std::min((int)fx, srcWidth - 1), x1 = std::min(x0 + 1, srcWidth - 1);
+                int y0 = std::min((int)fy, srcHeight - 1), y1 = std::min(y0 + 1, srcHeight - 1);
+                float tx = fx - x0, ty = fy - y0;
+                for (int c = 0; c < channels; ++c) {
+                    float top = src[(y0 * srcWidth + x0) * channels + c] * (1.0f - tx) + src[(y0 * srcWidth + x1) * channels + c] * tx;
+                    float bottom = src[(y1 * srcWidth + x0) * channels + c] * (1.0f - tx) + src[(y1 * srcWidth + x1) * channels + c] * tx;
+                    out[c] = (unsigned char)(top * (1.0f - ty) + bottom * ty + 0.5f);
+                }
+            }
+        }
+    }
+}
+
+GLuint createTextureArray(int width, int height, int layers) {
+    GLuint textureID;
+    glGenTextures(1, &textureID);
+    glState().bindTexture(GL_TEXTURE_2D_ARRAY, textureID);
+
+    glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_SRGB8_ALPHA8, width, height, layers, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+    return textureID;
+}
+
+bool loadTextureLayer(GLuint textureArray, int layer, const std::string &path, int width, int height) {
+    PROFILE_FUNCTION();
+    int srcWidth, srcHeight, nrChannels;
+    unsigned char* data = stbi_load(path.c_str(), &srcWidth, &srcHeight, &nrChannels, 4);
+    if (!data) {
+        std::cerr << "Failed to load texture at: " << path << std::endl;
+        return false;
+    }
+
+    std::vector<unsigned char> resized;
+    const unsigned char* pixels = data;
+    if (srcWidth != width || srcHeight != height) {
+        resized.resize((size_t)width * height * 4);
+        resizeImage(data, srcWidth, srcHeight, &resized[0], width, height, 4);
+        pixels = &resized[0];
+    }
+
+    glState().bindTexture(GL_TEXTURE_2D_ARRAY, textureArray);
+    glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, layer, width, height, 1, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+    renderStats().countTextureUpload((size_t)width * height * 4);
+
+    stbi_image_free(data);
+    return true;
+}
+
+GLuint createTextureArrayFromLevel(GLuint source, int level, int width, int height, int layers) {
+    // Read back on the CPU; runs once at load, and works on GL 3.3 without glCopyImageSubData
+    std::vector<unsigned char> pixels((size_t)width * height * layers * 4);
+    glState().bindTexture(GL_TEXTURE_2D_ARRAY, source);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glGetTexImage(GL_TEXTURE_2D_ARRAY, level, GL_RGBA, GL_UNSIGNED_BYTE, &pixels[0]);
+
+    GLuint textureID = createTextureArray(width, height, layers);
+    glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, 0, width, height, layers, GL_RGBA, GL_UNSIGNED_BYTE, &pixels[0]);
+    renderStats().countTextureUpload(pixels.size());
+    glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+    return textureID;
+}
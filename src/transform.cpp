@@ -0,0 +1,47 @@
+#include "transform.h"
+#include "simd_math.h"
+#include <glm/gtc/matrix_transform.hpp>
+
+Transform::Transform()
+    : position(0.0f), rotation(0.0f), scale(1.0f), model(1.0f), normal(1.0f), dirty(true) {}
+
+Transform::Transform(const glm::vec3& startPos)
+    : position(startPos), rotation(0.0f), scale(1.0f), model(1.0f), normal(1.0f), dirty(true) {}
+
+void Transform::setPosition(const glm::vec3& newPosition) {
+    if (newPosition == position) return;
+    position = newPosition;
+    dirty = true;
+}
+
+void Transform::setRotation(const glm::vec3& eulerDegrees) {
+    if (eulerDegrees == rotation) return;
+    rotation = eulerDegrees;
+    dirty = true;
+}
+
+void Transform::setScale(const glm::vec3& newScale) {
+    if (newScale == scale) return;
+    scale = newScale;
+    dirty = true;
+}
+
+const glm::mat4& Transform::getModelMatrix() const {
+    if (dirty) update();
+    return model;
+}
+
+const glm::mat3& Transform::getNormalMatrix() const {
+    if (dirty) update();
+    return normal;
+}
+
+void Transform::update() const {
+    model = glm::translate(glm::mat4(1.0f), position);
+    if (rotation.y != 0.0f) model = glm::rotate(model, glm::radians(rotation.y), glm::vec3(0.0f, 1.0f, 0.0f));
+    if (rotation.x != 0.0f) model = glm::rotate(model, glm::radians(rotation.x), glm::vec3(1.0f, 0.0f, 0.0f));
+    if (rotation.z != 0.0f) model = glm::rotate(model, glm::radians(rotation.z), glm::vec3(0.0f, 0.0f, 1.0f));
+    model = glm::scale(model, scale);
+    normal = computeNormalMatrix(model);
+    dirty = false;
+}
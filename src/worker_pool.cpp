@@ -0,0 +1,76 @@
+#include "worker_pool.h"
+#include "profiler.h"
+#include <algorithm>
+
+WorkerPool::WorkerPool(unsigned int workers)
+    : job(NULL), jobCount(0), chunkSize(1), nextIndex(0), generation(0), running(0), stopping(false) {
+    if (workers == 0) {
+        unsigned int hardware = std::thread::hardware_concurrency();
+        workers = hardware > 1 ? hardware - 1 : 0;
+    }
+    for (unsigned int i = 0; i < workers; ++i) {
+        threads.push_back(std::thread(&WorkerPool::workerLoop, this));
+    }
+}
+
+WorkerPool::~WorkerPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (size_t i = 0; i < threads.size(); ++i) threads[i].join();
+}
+
+void WorkerPool::parallelFor(size_t count, const std::function<void(size_t, size_t)>& fn) {
+    if (count == 0) return;
+    if (threads.empty() || count == 1) {
+        fn(0, count);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        job = &fn;
+        jobCount = count;
+        // A few chunks per thread so uneven pieces still balance out
+        chunkSize = std::max<size_t>(1, count / (4 * threadCount()));
+        nextIndex.store(0);
+        running = (unsigned int)threads.size();
+        generation++;
+    }
+    wake.notify_all();
+
+    runChunks();
+
+    std::unique_lock<std::mutex> lock(mutex);
+    finished.wait(lock, [this] { return running == 0; });
+    job = NULL;
+}
+
+void WorkerPool::workerLoop() {
+    Profiler::setThreadName("worker");
+    unsigned int seen = 0;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [this, seen] { return stopping || generation != seen; });
+            if (stopping) return;
+            seen = generation;
+        }
+
+        runChunks();
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (--running == 0) finished.notify_one();
+    }
+}
+
+void WorkerPool::runChunks() {
+    for (;;) {
+        size_t begin = nextIndex.fetch_add(chunkSize);
+        if (begin >= jobCount) return;
+        PROFILE_SCOPE("parallelFor chunk");
+        (*job)(begin, std::min(begin + chunkSize, jobCount));
+    }
+}